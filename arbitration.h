@@ -0,0 +1,513 @@
+#ifndef ARBITRATION_H
+#define ARBITRATION_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include "philo_common.h"
+#include "futex_handoff.h"
+#include "chopstick_pairs.h"
+#include "resource_graph.h"
+#include "shared_memory.h"
+#include "philo_random.h"
+
+// Who gets to eat, as a policy behind one interface. The host program runs
+// the think/wait/eat state machine and calls into the policy at four points:
+//   on_tick     at every dispatch: must the philosopher keep thinking?
+//   on_request  when it gets hungry and on every waiting pass after that
+//   on_release  after eating, to put its chopsticks down
+//   on_abandon  when a policy with timeouts gives up waiting
+// Every policy keeps chopsticks[].owner up to date, so the status view,
+// handoff latency and futex waits work the same whichever one is active.
+// Philosophers need the chopsticks listed in their row of a ResourceGraph
+// (resource_graph.h): two on the classic ring, any number elsewhere.
+
+// Chopstick cell, one per cache line so a CAS never invalidates a neighbour's
+typedef struct {
+    _Alignas(CACHE_LINE_SIZE) atomic_int owner;  // 0: free, otherwise philosopher ID + 1
+    atomic_int waiters;                          // Threads blocked on owner in futex_wait()
+    _Atomic long long released_ns;               // Time of the last release
+    atomic_int dirty;                            // Chandy-Misra: eaten with since its holder received it
+    pthread_mutex_t lock;                        // Chandy-Misra: serialises handovers
+} Chopstick;
+
+typedef enum {
+    ARBITRATION_GRANTED,  // Holds all its chopsticks and may eat
+    ARBITRATION_WAIT,     // Call on_request again later
+    ARBITRATION_REFUSED,  // Not hungry after all: go back to thinking
+} ArbitrationResult;
+
+struct Arbiter;
+
+typedef struct {
+    const char* name;
+    const char* description;
+    int uses_timeout;  // Waiters give up after MAX_WAIT_TIME and call on_abandon()
+    int (*on_tick)(struct Arbiter* arbiter, int philosopher);
+    // first is set on the request that starts a hungry period. *contended
+    // gets the chopstick worth blocking on while the answer is WAIT, or -1.
+    ArbitrationResult (*on_request)(struct Arbiter* arbiter, int philosopher, int first, int* contended);
+    void (*on_release)(struct Arbiter* arbiter, int philosopher);
+    void (*on_abandon)(struct Arbiter* arbiter, int philosopher);
+} ArbitrationPolicy;
+
+// Bounded-retry acquisition counters, one cache line per philosopher and
+// written only by the thread running it
+typedef struct {
+    _Alignas(CACHE_LINE_SIZE) long long acquisitions;
+    long long requests;     // multi_acquire() calls; the ones that fail are retried later
+    long long attempts;     // Passes over the sorted row
+    long long aborts;       // Passes that met a busy chopstick and rolled back
+    long long rolled_back;  // Chopsticks put down again by those aborts
+} AcquireStats;
+
+#define ACQUIRE_MAX_RETRIES 8         // Passes per on_request before waiting like everyone else
+#define ACQUIRE_BACKOFF_MIN_SPINS 16  // First backoff, doubled after every abort
+#define ACQUIRE_BACKOFF_MAX_SPINS 4096
+
+// Arbitrator state every philosopher writes, kept apart so process mode can
+// put it in the shared segment along with the chopsticks
+typedef struct {
+    _Alignas(CACHE_LINE_SIZE) pthread_mutex_t waiter_lock;  // Waiter: the one arbitrator every request goes through
+    atomic_llong next_ticket;                               // Ticket: last ticket handed out
+} ArbiterCentral;
+
+typedef struct Arbiter {
+    const ArbitrationPolicy* policy;
+    const ResourceGraph* graph;
+    Chopstick* chopsticks;  // One per graph resource
+
+    // Invoke-count fairness reads meal counts through the host
+    int (*meals)(int philosopher);
+    int (*lowest_meals)(void);
+    ChopstickPairs* pairs;  // -a pair: claim both chopsticks with one CAS
+    int pair_mode;
+
+    ArbiterCentral* central;      // Waiter lock and ticket dispenser
+    atomic_llong* tickets;        // Ticket: each philosopher's ticket, 0 when not hungry
+    AcquireStats* acquire_stats;  // Backoff: per philosopher
+} Arbiter;
+
+static inline int chopstick_take(Arbiter* arbiter, int index, int philosopher) {
+    int expected = 0;
+    return atomic_compare_exchange_strong(&arbiter->chopsticks[index].owner, &expected, philosopher + 1);
+}
+
+// Chopstick handoff: a release wakes the one neighbour blocked on that chopstick
+static inline void chopstick_put_down(Arbiter* arbiter, int index) {
+    Chopstick* chopstick = &arbiter->chopsticks[index];
+    atomic_store(&chopstick->released_ns, monotonic_ns());
+    atomic_store(&chopstick->owner, 0);
+    if (atomic_load(&chopstick->waiters) > 0) {
+        futex_wake(&chopstick->owner, 1);
+    }
+}
+
+static inline int chopstick_held_by(Arbiter* arbiter, int index, int philosopher) {
+    return atomic_load(&arbiter->chopsticks[index].owner) == philosopher + 1;
+}
+
+// Put down every chopstick after eating
+static inline void release_all(Arbiter* arbiter, int philosopher) {
+    const int* row = resource_graph_row(arbiter->graph, philosopher);
+    for (int i = 0; i < resource_graph_degree(arbiter->graph, philosopher); i++) {
+        chopstick_put_down(arbiter, row[i]);
+    }
+}
+
+// Put down whatever part of the row this philosopher holds
+static inline void release_held(Arbiter* arbiter, int philosopher) {
+    const int* row = resource_graph_row(arbiter->graph, philosopher);
+    for (int i = 0; i < resource_graph_degree(arbiter->graph, philosopher); i++) {
+        if (chopstick_held_by(arbiter, row[i], philosopher)) {
+            chopstick_put_down(arbiter, row[i]);
+        }
+    }
+}
+
+// All-or-nothing acquisition of a whole row with bounded retries. Each pass
+// CASes the chopsticks in ascending order; at the first busy one it puts
+// back what it took (so it never holds some while waiting for others) and
+// backs off for a random, doubling number of spins, leaving early if the
+// chopstick frees up. Returns 1 holding every chopstick, or 0 after
+// max_retries passes with *contended set to the last one found busy.
+static inline int multi_acquire(Arbiter* arbiter, int philosopher, int max_retries, int* contended) {
+    const int* ordered = resource_graph_ordered_row(arbiter->graph, philosopher);
+    int degree = resource_graph_degree(arbiter->graph, philosopher);
+    AcquireStats* stats = &arbiter->acquire_stats[philosopher];
+    int limit = ACQUIRE_BACKOFF_MIN_SPINS;
+
+    stats->requests++;
+    for (int pass = 0; pass < max_retries; pass++) {
+        stats->attempts++;
+        int taken = 0;
+        while (taken < degree && chopstick_take(arbiter, ordered[taken], philosopher)) {
+            taken++;
+        }
+        if (taken == degree) {
+            stats->acquisitions++;
+            *contended = -1;
+            return 1;
+        }
+        *contended = ordered[taken];
+        stats->aborts++;
+        stats->rolled_back += taken;
+        while (--taken >= 0) {
+            chopstick_put_down(arbiter, ordered[taken]);
+        }
+        if (pass + 1 == max_retries) {
+            break;
+        }
+        int spins = limit / 2 + (int)random_below(limit / 2 + 1);
+        for (int i = 0; i < spins && atomic_load(&arbiter->chopsticks[*contended].owner) != 0; i++) {
+        }
+        limit = limit * 2 < ACQUIRE_BACKOFF_MAX_SPINS ? limit * 2 : ACQUIRE_BACKOFF_MAX_SPINS;
+    }
+    return 0;
+}
+
+static inline int never_must_think(Arbiter* arbiter, int philosopher) {
+    (void)arbiter;
+    (void)philosopher;
+    return 0;
+}
+
+// Fairness by invoke count (the original project_with_frame.c rules): take
+// the last chopstick of the row (the right one on a ring) when hungry, poll
+// for the others in row order, give up after MAX_WAIT_TIME, and think
+// instead of eating while more than two meals ahead of the lowest count.
+static inline int fairness_on_tick(Arbiter* arbiter, int philosopher) {
+    return arbiter->meals(philosopher) > arbiter->lowest_meals() + 2;
+}
+
+static inline ArbitrationResult fairness_on_request(Arbiter* arbiter, int philosopher, int first, int* contended) {
+    const int* row = resource_graph_row(arbiter->graph, philosopher);
+    int degree = resource_graph_degree(arbiter->graph, philosopher);
+    *contended = -1;
+
+    if (arbiter->pair_mode) {
+        // Announce hunger without holding anything, then take both at once
+        if (first) {
+            return ARBITRATION_WAIT;
+        }
+        if (chopstick_pair_try_acquire(arbiter->pairs, row[0], row[1])) {
+            atomic_store(&arbiter->chopsticks[row[0]].owner, philosopher + 1);
+            atomic_store(&arbiter->chopsticks[row[1]].owner, philosopher + 1);
+            return ARBITRATION_GRANTED;
+        }
+        // Nothing is held here, so blocking cannot form a hold-and-wait cycle
+        *contended = atomic_load(&arbiter->chopsticks[row[0]].owner) != 0 ? row[0] : row[1];
+        return ARBITRATION_WAIT;
+    }
+
+    if (first) {
+        return chopstick_take(arbiter, row[degree - 1], philosopher) ? ARBITRATION_WAIT : ARBITRATION_REFUSED;
+    }
+    for (int i = 0; i < degree - 1; i++) {
+        if (chopstick_held_by(arbiter, row[i], philosopher)) {
+            continue;
+        }
+        if (atomic_load(&arbiter->chopsticks[row[i]].owner) != 0 || !chopstick_take(arbiter, row[i], philosopher)) {
+            *contended = row[i];
+            return ARBITRATION_WAIT;
+        }
+    }
+    return ARBITRATION_GRANTED;
+}
+
+static inline void fairness_on_release(Arbiter* arbiter, int philosopher) {
+    if (!arbiter->pair_mode) {
+        release_all(arbiter, philosopher);
+        return;
+    }
+    // The bitmap decides who gets them; owner[] mirrors it for everyone else.
+    // Clear owner[] before freeing the pair, as the next holder sets its own,
+    // and wake waiters once the pair can actually be taken.
+    const int* row = resource_graph_row(arbiter->graph, philosopher);
+    for (int i = 0; i < 2; i++) {
+        atomic_store(&arbiter->chopsticks[row[i]].released_ns, monotonic_ns());
+        atomic_store(&arbiter->chopsticks[row[i]].owner, 0);
+    }
+    chopstick_pair_release(arbiter->pairs, row[0], row[1]);
+    for (int i = 0; i < 2; i++) {
+        if (atomic_load(&arbiter->chopsticks[row[i]].waiters) > 0) {
+            futex_wake(&arbiter->chopsticks[row[i]].owner, 1);
+        }
+    }
+}
+
+static inline void fairness_on_abandon(Arbiter* arbiter, int philosopher) {
+    if (!arbiter->pair_mode) {
+        release_held(arbiter, philosopher);
+    }
+}
+
+// Resource hierarchy: always take chopsticks in ascending number. Everyone
+// waits only for a higher number than any it holds, so no wait-for cycle
+// can close.
+static inline ArbitrationResult hierarchy_on_request(Arbiter* arbiter, int philosopher, int first, int* contended) {
+    (void)first;
+    const int* ordered = resource_graph_ordered_row(arbiter->graph, philosopher);
+    for (int i = 0; i < resource_graph_degree(arbiter->graph, philosopher); i++) {
+        if (!chopstick_held_by(arbiter, ordered[i], philosopher) && !chopstick_take(arbiter, ordered[i], philosopher)) {
+            *contended = ordered[i];
+            return ARBITRATION_WAIT;
+        }
+    }
+    *contended = -1;
+    return ARBITRATION_GRANTED;
+}
+
+// Waiter: a single arbitrator hands out all of a philosopher's chopsticks
+// together or none, so nobody ever holds some while waiting for others
+static inline ArbitrationResult waiter_on_request(Arbiter* arbiter, int philosopher, int first, int* contended) {
+    (void)first;
+    const int* row = resource_graph_row(arbiter->graph, philosopher);
+    int degree = resource_graph_degree(arbiter->graph, philosopher);
+
+    pthread_mutex_lock(&arbiter->central->waiter_lock);
+    *contended = -1;
+    for (int i = 0; i < degree && *contended < 0; i++) {
+        if (atomic_load(&arbiter->chopsticks[row[i]].owner) != 0) {
+            *contended = row[i];
+        }
+    }
+    if (*contended < 0) {
+        for (int i = 0; i < degree; i++) {
+            atomic_store(&arbiter->chopsticks[row[i]].owner, philosopher + 1);
+        }
+    }
+    pthread_mutex_unlock(&arbiter->central->waiter_lock);
+    return *contended < 0 ? ARBITRATION_GRANTED : ARBITRATION_WAIT;
+}
+
+static inline void waiter_on_release(Arbiter* arbiter, int philosopher) {
+    pthread_mutex_lock(&arbiter->central->waiter_lock);
+    release_all(arbiter, philosopher);
+    pthread_mutex_unlock(&arbiter->central->waiter_lock);
+}
+
+// Ticket: a hungry philosopher draws a number from one global counter and
+// never overtakes a hungry neighbour (anyone sharing a chopstick) holding a
+// smaller one. The smallest ticket at the table can always proceed, and
+// tickets are served in order around each chopstick, so nobody starves.
+static inline ArbitrationResult ticket_on_request(Arbiter* arbiter, int philosopher, int first, int* contended) {
+    const ResourceGraph* graph = arbiter->graph;
+    if (first) {
+        atomic_store(&arbiter->tickets[philosopher], atomic_fetch_add(&arbiter->central->next_ticket, 1) + 1);
+    }
+    long long ticket = atomic_load(&arbiter->tickets[philosopher]);
+    const int* ordered = resource_graph_ordered_row(graph, philosopher);
+    int degree = resource_graph_degree(graph, philosopher);
+
+    for (int i = 0; i < degree; i++) {
+        for (int s = graph->sharer_offsets[ordered[i]]; s < graph->sharer_offsets[ordered[i] + 1]; s++) {
+            long long other = atomic_load(&arbiter->tickets[graph->sharers[s]]);
+            if (graph->sharers[s] != philosopher && other != 0 && other < ticket) {
+                *contended = ordered[i];
+                return ARBITRATION_WAIT;
+            }
+        }
+    }
+
+    // Ahead of every neighbour; a chopstick can still be busy with a meal
+    // that started before this ticket was drawn
+    for (int i = 0; i < degree; i++) {
+        if (!chopstick_take(arbiter, ordered[i], philosopher)) {
+            *contended = ordered[i];
+            while (--i >= 0) {
+                chopstick_put_down(arbiter, ordered[i]);
+            }
+            return ARBITRATION_WAIT;
+        }
+    }
+    atomic_store(&arbiter->tickets[philosopher], 0);
+    *contended = -1;
+    return ARBITRATION_GRANTED;
+}
+
+// Chandy-Misra hygienic chopsticks. Every chopstick always has a holder and
+// starts dirty with the lowest-numbered philosopher sharing it. A hungry
+// philosopher may take a chopstick only if it is dirty, and cleans it on
+// the way; a clean chopstick stays where it is until its holder has eaten
+// with it. Chopsticks are clean while their holder eats, so "dirty" also
+// means "not in use". Requests are made by the requester itself under the
+// chopsticks' locks, taken in ascending order, rather than by message;
+// project_chandy_misra.c passes messages.
+static inline ArbitrationResult chandy_misra_on_request(Arbiter* arbiter, int philosopher, int first, int* contended) {
+    (void)first;
+    const int* ordered = resource_graph_ordered_row(arbiter->graph, philosopher);
+    int degree = resource_graph_degree(arbiter->graph, philosopher);
+
+    for (int i = 0; i < degree; i++) {
+        pthread_mutex_lock(&arbiter->chopsticks[ordered[i]].lock);
+    }
+    *contended = -1;
+    for (int i = 0; i < degree; i++) {
+        Chopstick* chopstick = &arbiter->chopsticks[ordered[i]];
+        if (atomic_load(&chopstick->owner) == philosopher + 1) {
+            continue;
+        }
+        if (atomic_load(&chopstick->dirty)) {
+            atomic_store(&chopstick->dirty, 0);
+            atomic_store(&chopstick->owner, philosopher + 1);
+        } else {
+            *contended = ordered[i];
+        }
+    }
+    if (*contended < 0) {
+        // Chopsticks kept since the last meal are still dirty; nobody may take them now
+        for (int i = 0; i < degree; i++) {
+            atomic_store(&arbiter->chopsticks[ordered[i]].dirty, 0);
+        }
+    }
+    for (int i = degree - 1; i >= 0; i--) {
+        pthread_mutex_unlock(&arbiter->chopsticks[ordered[i]].lock);
+    }
+    return *contended < 0 ? ARBITRATION_GRANTED : ARBITRATION_WAIT;
+}
+
+// Keep every chopstick, now dirty, and wake a neighbour waiting for one
+static inline void chandy_misra_on_release(Arbiter* arbiter, int philosopher) {
+    const int* row = resource_graph_row(arbiter->graph, philosopher);
+    for (int i = 0; i < resource_graph_degree(arbiter->graph, philosopher); i++) {
+        Chopstick* chopstick = &arbiter->chopsticks[row[i]];
+        pthread_mutex_lock(&chopstick->lock);
+        atomic_store(&chopstick->released_ns, monotonic_ns());
+        atomic_store(&chopstick->dirty, 1);
+        pthread_mutex_unlock(&chopstick->lock);
+        if (atomic_load(&chopstick->waiters) > 0) {
+            futex_wake(&chopstick->dirty, 1);
+        }
+    }
+}
+
+// Backoff: bounded-retry all-or-nothing acquisition (multi_acquire()).
+// Deadlock-free since nothing is held between passes, but not
+// starvation-free: a philosopher can keep losing the race.
+static inline ArbitrationResult backoff_on_request(Arbiter* arbiter, int philosopher, int first, int* contended) {
+    (void)first;
+    return multi_acquire(arbiter, philosopher, ACQUIRE_MAX_RETRIES, contended) ? ARBITRATION_GRANTED
+                                                                                : ARBITRATION_WAIT;
+}
+
+static const ArbitrationPolicy arbitration_policies[] = {
+    {"fairness", "invoke-count fairness with a MAX_WAIT_TIME timeout (default)", 1,
+     fairness_on_tick, fairness_on_request, fairness_on_release, fairness_on_abandon},
+    {"hierarchy", "resource hierarchy: lower-numbered chopsticks first", 0,
+     never_must_think, hierarchy_on_request, release_all, NULL},
+    {"waiter", "one arbitrator grants all chopsticks or none", 0,
+     never_must_think, waiter_on_request, waiter_on_release, NULL},
+    {"ticket", "global tickets; never overtake a hungrier neighbour", 0,
+     never_must_think, ticket_on_request, release_all, NULL},
+    {"chandy-misra", "hygienic dirty/clean chopsticks", 0,
+     never_must_think, chandy_misra_on_request, chandy_misra_on_release, NULL},
+    {"backoff", "all-or-nothing sorted acquisition with bounded retries and backoff", 0,
+     never_must_think, backoff_on_request, release_all, NULL},
+};
+static inline int is_chandy_misra(const ArbitrationPolicy* policy) {
+    return policy->on_request == chandy_misra_on_request;
+}
+
+// Block until the contended chopstick may have changed hands, for at most
+// timeout_ns. Returns -1 without blocking when there is nothing to wait
+// for, such as a free chopstick a neighbour with an earlier ticket is
+// about to take; the caller polls instead.
+static inline int arbiter_block(Arbiter* arbiter, int index, long long timeout_ns) {
+    Chopstick* chopstick = &arbiter->chopsticks[index];
+    atomic_int* word = &chopstick->owner;
+    int value = atomic_load(word);
+    if (is_chandy_misra(arbiter->policy)) {
+        // Hygienic chopsticks never become free, they become dirty
+        word = &chopstick->dirty;
+        value = atomic_load(word);
+        if (value != 0) {
+            return -1;
+        }
+    } else if (value == 0) {
+        return -1;
+    }
+    atomic_fetch_add(&chopstick->waiters, 1);
+    futex_wait(word, value, timeout_ns);
+    atomic_fetch_sub(&chopstick->waiters, 1);
+    return 0;
+}
+
+#define NUM_ARBITRATION_POLICIES (int)(sizeof(arbitration_policies) / sizeof(arbitration_policies[0]))
+
+static inline const ArbitrationPolicy* find_arbitration_policy(const char* name) {
+    for (int i = 0; i < NUM_ARBITRATION_POLICIES; i++) {
+        if (strcmp(arbitration_policies[i].name, name) == 0) {
+            return &arbitration_policies[i];
+        }
+    }
+    fprintf(stderr, "Unknown arbitration policy: %s (choose from", name);
+    for (int i = 0; i < NUM_ARBITRATION_POLICIES; i++) {
+        fprintf(stderr, " %s", arbitration_policies[i].name);
+    }
+    fprintf(stderr, ")\n");
+    return NULL;
+}
+
+static inline void arbiter_init(Arbiter* arbiter, const ArbitrationPolicy* policy, const ResourceGraph* graph,
+                                Chopstick* chopsticks, int (*meals)(int), int (*lowest_meals)(void),
+                                ChopstickPairs* pairs, int pair_mode) {
+    arbiter->policy = policy;
+    arbiter->graph = graph;
+    arbiter->chopsticks = chopsticks;
+    arbiter->meals = meals;
+    arbiter->lowest_meals = lowest_meals;
+    arbiter->pairs = pairs;
+    arbiter->pair_mode = pair_mode;
+    arbiter->central = shared_alloc(1, sizeof(ArbiterCentral));
+    shared_mutex_init(&arbiter->central->waiter_lock);
+    atomic_init(&arbiter->central->next_ticket, 0);
+    arbiter->tickets = shared_alloc(graph->num_processes, sizeof(atomic_llong));
+    arbiter->acquire_stats = shared_alloc(graph->num_processes, sizeof(AcquireStats));
+
+    for (int r = 0; r < graph->num_resources; r++) {
+        shared_mutex_init(&chopsticks[r].lock);
+        atomic_init(&chopsticks[r].dirty, 1);
+        atomic_init(&chopsticks[r].owner, 0);
+        if (is_chandy_misra(policy) && graph->sharer_offsets[r] < graph->sharer_offsets[r + 1]) {
+            // Sharers are listed in ascending order; the lowest starts with it
+            atomic_init(&chopsticks[r].owner, graph->sharers[graph->sharer_offsets[r]] + 1);
+        }
+    }
+}
+
+// Totals of the bounded-retry counters; prints nothing for policies that do not use them
+static inline void arbiter_print_acquire_stats(Arbiter* arbiter) {
+    AcquireStats total = {0};
+    for (int p = 0; p < arbiter->graph->num_processes; p++) {
+        total.acquisitions += arbiter->acquire_stats[p].acquisitions;
+        total.requests += arbiter->acquire_stats[p].requests;
+        total.attempts += arbiter->acquire_stats[p].attempts;
+        total.aborts += arbiter->acquire_stats[p].aborts;
+        total.rolled_back += arbiter->acquire_stats[p].rolled_back;
+    }
+    if (total.attempts == 0) {
+        return;
+    }
+    printf("Multi-acquire: %lld acquisitions, %.2f retries per acquisition, %lld passes (%.1f%% aborted), "
+           "%.2f chopsticks rolled back per abort\n",
+           total.acquisitions,
+           total.acquisitions > 0 ? (double)(total.requests - total.acquisitions) / total.acquisitions : 0.0,
+           total.attempts, 100.0 * total.aborts / total.attempts,
+           total.aborts > 0 ? (double)total.rolled_back / total.aborts : 0.0);
+}
+
+static inline void arbiter_destroy(Arbiter* arbiter) {
+    for (int r = 0; r < arbiter->graph->num_resources; r++) {
+        pthread_mutex_destroy(&arbiter->chopsticks[r].lock);
+    }
+    pthread_mutex_destroy(&arbiter->central->waiter_lock);
+    shared_free(arbiter->central);
+    shared_free(arbiter->tickets);
+    shared_free(arbiter->acquire_stats);
+}
+
+#endif // ARBITRATION_H
@@ -0,0 +1,27 @@
+#!/bin/bash
+# Throughput against worst-case starvation in project_with_starvation.c for
+# several aging thresholds (-A, 0 = no aging).
+#
+#   N=5 DURATION=3600 AGING="0 2 5 10 20 40" FLAGS="-V" ./bench_aging.sh
+set -e
+
+N=${N:-5}
+DURATION=${DURATION:-3600}
+AGING=${AGING:-"0 2 5 10 20 40"}
+FLAGS=${FLAGS:--V}
+
+cd "$(dirname "$0")"
+BUILD=$(mktemp -d)
+trap 'rm -rf "$BUILD"' EXIT
+gcc -O2 -o "$BUILD/starvation" project_with_starvation.c -pthread
+
+printf "N=%s, %s s per run, flags: %s\n\n" "$N" "$DURATION" "$FLAGS"
+printf "%8s %12s %16s %10s %12s\n" "aging s" "meals/sec" "longest gap s" "Jain" "wait p99 us"
+for aging in $AGING; do
+    "$BUILD/starvation" -n "$N" -d "$DURATION" -A "$aging" $FLAGS -l "$BUILD/events.log" > "$BUILD/out.txt"
+    meals=$(sed -n 's/^Total meals: .*(\([0-9.]*\) meals\/sec).*/\1/p' "$BUILD/out.txt")
+    gap=$(sed -n 's/^Starvation: longest without eating \([0-9.]*\) s.*/\1/p' "$BUILD/out.txt")
+    jain=$(sed -n 's/^Fairness (Jain): \([0-9.]*\),.*/\1/p' "$BUILD/out.txt")
+    p99=$(sed -n 's/^Wait to eat: .*p99 \([0-9.]*\) us,.*/\1/p' "$BUILD/out.txt")
+    printf "%8s %12s %16s %10s %12s\n" "$aging" "$meals" "$gap" "$jain" "$p99"
+done
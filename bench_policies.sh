@@ -0,0 +1,43 @@
+#!/bin/bash
+# Run the same workload against every policy and collect one results file.
+#
+#   N=5 DURATION=600 FLAGS="-V" RESULTS=results.csv ./bench_policies.sh
+#   MEALS=1000 FLAGS="-V -a pair" RESULTS=results.json ./bench_policies.sh
+#   PROGRAMS=project_with_frame ARBITRATION="waiter ticket" ./bench_policies.sh
+#
+# DURATION gives a fixed-duration run and MEALS a fixed-meal run; with both
+# set, whichever limit is reached first ends it. Rows are appended, so
+# successive runs of the script build up a history to compare against.
+# project_with_frame runs once per arbitration policy in ARBITRATION.
+set -e
+
+N=${N:-5}
+DURATION=${DURATION:-600}
+MEALS=${MEALS:-0}
+FLAGS=${FLAGS:--V}
+RESULTS=${RESULTS:-results.csv}
+PROGRAMS=${PROGRAMS:-"project_1_c project_with_frame project_with_starvation project_with_deadlock project_chandy_misra"}
+ARBITRATION=${ARBITRATION:-"fairness hierarchy waiter ticket chandy-misra backoff"}
+
+cd "$(dirname "$0")"
+BUILD=$(mktemp -d)
+trap 'rm -rf "$BUILD"' EXIT
+
+for program in $PROGRAMS; do
+    gcc -O2 -o "$BUILD/$program" "$program.c" -pthread
+    policies="-"
+    if [ "$program" = project_with_frame ]; then
+        policies=$ARBITRATION
+    fi
+    for policy in $policies; do
+        arbitration=""
+        if [ "$policy" != - ]; then
+            arbitration="-P $policy"
+            echo "$program -P $policy"
+        fi
+        "$BUILD/$program" -n "$N" -d "$DURATION" -m "$MEALS" $FLAGS $arbitration -l "$BUILD/events.log" \
+            -o "$RESULTS" | sed -n '/^Total meals/,$p'
+        echo
+    done
+done
+echo "Results appended to $RESULTS"
@@ -0,0 +1,142 @@
+#ifndef BENCH_REPORT_H
+#define BENCH_REPORT_H
+
+#include <stdio.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <sys/resource.h>
+
+#include "philo_common.h"
+#include "sim_clock.h"
+#include "latency_histogram.h"
+
+// Benchmark measurements shared by all variants: how long philosophers wait
+// before eating (latency_histogram.h), how evenly meals are spread and what
+// the run cost in CPU time. Each run can append one row to a CSV or JSON-lines results file.
+
+// Jain's fairness index over meal counts: 1 when everyone ate equally often,
+// 1/n when one philosopher had every meal
+typedef struct {
+    double sum;
+    double sum_squares;
+    int count;
+} FairnessIndex;
+
+static inline void fairness_add(FairnessIndex* fairness, int meals) {
+    fairness->sum += meals;
+    fairness->sum_squares += (double)meals * meals;
+    fairness->count++;
+}
+
+static inline double fairness_jain(const FairnessIndex* fairness) {
+    if (fairness->sum_squares == 0) {
+        return 1.0;
+    }
+    return fairness->sum * fairness->sum / (fairness->count * fairness->sum_squares);
+}
+
+// Fixed-meal workload: the philosopher finishing the target meal stops the run
+typedef struct {
+    long long target;  // 0: no meal limit
+    atomic_llong meals;
+    atomic_int* running;
+} MealTarget;
+
+static inline void meal_target_init(MealTarget* meal_target, long long target, atomic_int* running) {
+    meal_target->target = target;
+    atomic_init(&meal_target->meals, 0);
+    meal_target->running = running;
+}
+
+static inline void meal_target_count(MealTarget* meal_target) {
+    if (meal_target->target > 0 && atomic_fetch_add(&meal_target->meals, 1) + 1 == meal_target->target) {
+        atomic_store(meal_target->running, 0);
+        clock_interrupt();
+    }
+}
+
+// CPU time of the philosopher processes (-F), taken once they have all been
+// waited for; RUSAGE_CHILDREN does not include children still running
+static double philosopher_processes_cpu_seconds;
+
+static inline double rusage_cpu_seconds(int who) {
+    struct rusage usage;
+    getrusage(who, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+static inline double process_cpu_seconds(void) {
+    return rusage_cpu_seconds(RUSAGE_SELF) + philosopher_processes_cpu_seconds;
+}
+
+static inline const char* runtime_name(const PhiloOptions* options) {
+    if (options->processes) {
+        return "processes";
+    }
+    if (options->workers == 0) {
+        return "threads";
+    }
+    return options->work_stealing ? "steal" : "pool";
+}
+
+// Print the wait, fairness and CPU summary and append it to options->results_path.
+// Files ending in .json or .jsonl get one JSON object per line, anything else CSV.
+static inline void bench_report(const PhiloOptions* options, const char* policy, int blocking,
+                                long long total_meals, LatencyHistogram* waits, double fairness, long long end_ns) {
+    double simulated = (double)end_ns / NS_PER_SEC;
+    double real = (double)clock_real_elapsed_ns() / NS_PER_SEC;
+    double cpu = process_cpu_seconds();
+    double meals_per_sec = simulated > 0 ? total_meals / simulated : 0.0;
+    double p50 = latency_percentile(waits, 0.5) / 1000.0;
+    double p99 = latency_percentile(waits, 0.99) / 1000.0;
+    double p999 = latency_percentile(waits, 0.999) / 1000.0;
+    double max = atomic_load(&waits->max_ns) / 1000.0;
+    long long count = latency_count(waits);
+    long long timeouts = atomic_load(&waits->timeouts);
+
+    printf("Wait to eat: %lld waits (%lld timed out), p50 %.1f us, p99 %.1f us, p99.9 %.1f us, max %.1f us\n",
+           count, timeouts, p50, p99, p999, max);
+    if (philosopher_processes_cpu_seconds > 0) {
+        printf("Fairness (Jain): %.4f, CPU time: %.2f s (%.2f s in philosopher processes)\n", fairness, cpu,
+               philosopher_processes_cpu_seconds);
+    } else {
+        printf("Fairness (Jain): %.4f, CPU time: %.2f s\n", fairness, cpu);
+    }
+
+    if (options->results_path == NULL) {
+        return;
+    }
+    FILE* results = fopen(options->results_path, "a");
+    if (results == NULL) {
+        perror(options->results_path);
+        return;
+    }
+    const char* extension = strrchr(options->results_path, '.');
+    const char* time_mode = options->virtual_time ? "virtual" : options->time_scale != 1.0 ? "scaled" : "real";
+    const char* acquire = options->acquire_pairs ? "pair" : "single";
+    if (extension != NULL && (strcmp(extension, ".json") == 0 || strcmp(extension, ".jsonl") == 0)) {
+        fprintf(results,
+                "{\"policy\": \"%s\", \"philosophers\": %d, \"runtime\": \"%s\", \"workers\": %d, "
+                "\"blocking\": %d, \"acquire\": \"%s\", \"time\": \"%s\", \"simulated_s\": %.3f, "
+                "\"real_s\": %.3f, \"meals\": %lld, \"meals_per_s\": %.3f, \"waits\": %lld, \"timeouts\": %lld, "
+                "\"wait_p50_us\": %.1f, \"wait_p99_us\": %.1f, \"wait_p999_us\": %.1f, "
+                "\"wait_max_us\": %.1f, \"jain\": %.4f, \"cpu_s\": %.3f}\n",
+                policy, options->num_philosophers, runtime_name(options), options->workers, blocking, acquire,
+                time_mode, simulated, real, total_meals, meals_per_sec, count, timeouts, p50, p99, p999, max,
+                fairness, cpu);
+    } else {
+        fseek(results, 0, SEEK_END);
+        if (ftell(results) == 0) {
+            fprintf(results, "policy,philosophers,runtime,workers,blocking,acquire,time,simulated_s,real_s,"
+                             "meals,meals_per_s,waits,timeouts,wait_p50_us,wait_p99_us,wait_p999_us,wait_max_us,"
+                             "jain,cpu_s\n");
+        }
+        fprintf(results, "%s,%d,%s,%d,%d,%s,%s,%.3f,%.3f,%lld,%.3f,%lld,%lld,%.1f,%.1f,%.1f,%.1f,%.4f,%.3f\n",
+                policy, options->num_philosophers, runtime_name(options), options->workers, blocking, acquire,
+                time_mode, simulated, real, total_meals, meals_per_sec, count, timeouts, p50, p99, p999, max,
+                fairness, cpu);
+    }
+    fclose(results);
+}
+
+#endif // BENCH_REPORT_H
@@ -0,0 +1,47 @@
+#!/bin/bash
+# Contention benchmark for philosophers needing k chopsticks each: a random
+# k-regular resource graph (-T regular:K) per k, run once per policy.
+#
+#   N=64 DURATION=3600 K="2 4 8" ./bench_resources.sh
+#   POLICIES="backoff waiter" FLAGS="-s 1000" DURATION=20000 ./bench_resources.sh
+#
+# Acquisitions are meals, per simulated and per real second. Retries,
+# aborted passes and rollbacks come from the backoff policy's bounded-retry
+# counters; the other policies show "-" there. With RESULTS set, rows are
+# also appended to that file as in bench_policies.sh.
+set -e
+
+N=${N:-64}
+DURATION=${DURATION:-3600}
+K=${K:-"2 4 8"}
+POLICIES=${POLICIES:-"backoff hierarchy waiter"}
+FLAGS=${FLAGS:--V}
+SEED=${SEED:-1}
+
+cd "$(dirname "$0")"
+BUILD=$(mktemp -d)
+trap 'rm -rf "$BUILD"' EXIT
+gcc -O2 -o "$BUILD/project_with_frame" project_with_frame.c -pthread
+
+printf "N=%s, %s simulated s per run, flags: %s\n\n" "$N" "$DURATION" "$FLAGS"
+printf "%-3s %-10s %12s %12s %12s %10s %10s\n" "k" "policy" "acq/sec" "acq/real s" "retries/acq" \
+       "aborted" "rollback"
+
+for k in $K; do
+    for policy in $POLICIES; do
+        results=""
+        if [ -n "$RESULTS" ]; then
+            results="-o $RESULTS"
+        fi
+        "$BUILD/project_with_frame" -n "$N" -T "regular:$k:$SEED" -P "$policy" -d "$DURATION" $FLAGS \
+            -l "$BUILD/events.log" $results > "$BUILD/out.txt" 2> /dev/null
+        rate=$(sed -n 's/^Total meals: .*(\([0-9.]*\) meals\/sec).*/\1/p' "$BUILD/out.txt")
+        real_rate=$(sed -n 's/^Total meals: .*s real (\([0-9.]*\) meals\/sec real).*/\1/p' "$BUILD/out.txt")
+        retries=$(sed -n 's/^Multi-acquire: .*, \([0-9.]*\) retries per acquisition.*/\1/p' "$BUILD/out.txt")
+        aborted=$(sed -n 's/^Multi-acquire: .*passes (\([0-9.]*%\) aborted).*/\1/p' "$BUILD/out.txt")
+        rollback=$(sed -n 's/^Multi-acquire: .*, \([0-9.]*\) chopsticks rolled back.*/\1/p' "$BUILD/out.txt")
+
+        printf "%-3s %-10s %12s %12s %12s %10s %10s\n" "$k" "$policy" "${rate:--}" "${real_rate:--}" \
+               "${retries:--}" "${aborted:--}" "${rollback:--}"
+    done
+done
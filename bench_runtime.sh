@@ -0,0 +1,49 @@
+#!/bin/bash
+# Compare the ways of running philosophers: one thread each, the static
+# worker pool (-w), the work-stealing runtime (-W) and, for
+# project_with_frame, one process each over shared memory (-F).
+#
+#   N=10000 DURATION=30 WORKERS=0 ./bench_runtime.sh
+#
+# WORKERS=0 means one worker per online CPU. Each run writes its event log to
+# a scratch file so terminal output does not skew the numbers.
+set -e
+
+N=${N:-10000}
+DURATION=${DURATION:-30}
+WORKERS=${WORKERS:-0}
+PROGRAMS=${PROGRAMS:-"project_1_c project_with_frame project_with_starvation project_with_deadlock project_chandy_misra"}
+
+cd "$(dirname "$0")"
+BUILD=$(mktemp -d)
+trap 'rm -rf "$BUILD"' EXIT
+
+printf "N=%s, %s s per run, %s CPUs\n\n" "$N" "$DURATION" "$(getconf _NPROCESSORS_ONLN)"
+printf "%-24s %-9s %12s %14s %10s %10s\n" "program" "runtime" "meals/sec" "handoff mean" "CPU s" "stolen"
+
+for program in $PROGRAMS; do
+    gcc -O2 -o "$BUILD/$program" "$program.c" -pthread
+    runtimes="threads pool steal"
+    if [ "$program" = project_with_frame ]; then
+        runtimes="$runtimes processes"
+    fi
+    for runtime in $runtimes; do
+        case $runtime in
+            threads) flags="" ;;
+            pool) flags="-w $WORKERS" ;;
+            steal) flags="-W $WORKERS" ;;
+            processes) flags="-F" ;;
+        esac
+
+        TIMEFORMAT="%U %S"
+        cpu=$( { time "$BUILD/$program" -n "$N" -d "$DURATION" $flags -l "$BUILD/events.log" \
+                    > "$BUILD/out.txt" 2> /dev/null; } 2>&1 )
+        cpu_seconds=$(echo "$cpu" | awk '{ printf "%.2f", $1 + $2 }')
+        meals=$(sed -n 's/^Total meals: .*(\([0-9.]*\) meals\/sec).*/\1/p' "$BUILD/out.txt")
+        handoff=$(sed -n 's/^Acquisition handoffs.*mean \([0-9.]* [mu]*s\).*/\1/p' "$BUILD/out.txt")
+        stolen=$(sed -n 's/^Work stealing: .*(\(.*\))$/\1/p' "$BUILD/out.txt")
+
+        printf "%-24s %-9s %12s %14s %10s %10s\n" "$program" "$runtime" "${meals:--}" "${handoff:--}" \
+               "$cpu_seconds" "${stolen:--}"
+    done
+done
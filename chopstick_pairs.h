@@ -0,0 +1,92 @@
+#ifndef CHOPSTICK_PAIRS_H
+#define CHOPSTICK_PAIRS_H
+
+#include <stdatomic.h>
+
+#include "philo_common.h"
+#include "shared_memory.h"
+
+// Chopsticks are packed as bits, CHOPSTICK_GROUP to a cache-line sized word.
+// A philosopher's left and right chopsticks are adjacent bits, so unless the
+// pair straddles a group boundary both are claimed with a single 64-bit CAS.
+// Smaller groups mean fewer unrelated philosophers contending on one word.
+#define CHOPSTICK_GROUP 16
+
+typedef struct {
+    _Alignas(CACHE_LINE_SIZE) _Atomic unsigned long long bits;  // 1: chopstick taken
+} ChopstickGroup;
+
+typedef struct {
+    ChopstickGroup* groups;
+    int num_chopsticks;
+} ChopstickPairs;
+
+static inline void chopstick_pairs_init(ChopstickPairs* pairs, int num_chopsticks) {
+    int num_groups = (num_chopsticks + CHOPSTICK_GROUP - 1) / CHOPSTICK_GROUP;
+    pairs->groups = shared_alloc(num_groups, sizeof(ChopstickGroup));
+    pairs->num_chopsticks = num_chopsticks;
+    for (int i = 0; i < num_groups; i++) {
+        atomic_init(&pairs->groups[i].bits, 0);
+    }
+}
+
+static inline void chopstick_pairs_destroy(ChopstickPairs* pairs) {
+    shared_free(pairs->groups);
+}
+
+static inline unsigned long long chopstick_bit(int index) {
+    return 1ULL << (index % CHOPSTICK_GROUP);
+}
+
+// Claim a single chopstick; returns 1 if it was free
+static inline int chopstick_claim_one(ChopstickPairs* pairs, int index) {
+    unsigned long long bit = chopstick_bit(index);
+    return (atomic_fetch_or(&pairs->groups[index / CHOPSTICK_GROUP].bits, bit) & bit) == 0;
+}
+
+static inline void chopstick_release_one(ChopstickPairs* pairs, int index) {
+    atomic_fetch_and(&pairs->groups[index / CHOPSTICK_GROUP].bits, ~chopstick_bit(index));
+}
+
+// Claim both chopsticks or neither. Never blocks and never leaves a partial
+// hold behind: a pair straddling two groups is taken in group order and the
+// first claim is rolled back if the second chopstick is busy.
+static inline int chopstick_pair_try_acquire(ChopstickPairs* pairs, int left, int right) {
+    int left_group = left / CHOPSTICK_GROUP;
+    int right_group = right / CHOPSTICK_GROUP;
+
+    if (left_group == right_group) {
+        _Atomic unsigned long long* word = &pairs->groups[left_group].bits;
+        unsigned long long mask = chopstick_bit(left) | chopstick_bit(right);
+        unsigned long long old = atomic_load(word);
+        while ((old & mask) == 0) {
+            if (atomic_compare_exchange_weak(word, &old, old | mask)) {
+                return 1;
+            }
+        }
+        return 0;
+    }
+
+    int first = left_group < right_group ? left : right;
+    int second = first == left ? right : left;
+    if (!chopstick_claim_one(pairs, first)) {
+        return 0;
+    }
+    if (!chopstick_claim_one(pairs, second)) {
+        chopstick_release_one(pairs, first);
+        return 0;
+    }
+    return 1;
+}
+
+static inline void chopstick_pair_release(ChopstickPairs* pairs, int left, int right) {
+    int left_group = left / CHOPSTICK_GROUP;
+    if (left_group == right / CHOPSTICK_GROUP) {
+        atomic_fetch_and(&pairs->groups[left_group].bits, ~(chopstick_bit(left) | chopstick_bit(right)));
+    } else {
+        chopstick_release_one(pairs, left);
+        chopstick_release_one(pairs, right);
+    }
+}
+
+#endif // CHOPSTICK_PAIRS_H
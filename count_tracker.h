@@ -0,0 +1,80 @@
+#ifndef COUNT_TRACKER_H
+#define COUNT_TRACKER_H
+
+#include <stdatomic.h>
+
+#include "philo_common.h"
+
+// Number of distinct invoke counts above the floor tracked exactly. The
+// fairness rules keep most runs within a few meals of the lowest count;
+// wider spreads fall back to a scan, which hands the floor back to the tracker.
+#define COUNT_WINDOW 64
+
+typedef struct {
+    _Alignas(CACHE_LINE_SIZE) atomic_int philosophers;  // How many sit at this count
+} CountBucket;
+
+// Histogram of invoke counts over a sliding window starting at the minimum.
+// eat() moves one philosopher from bucket c to c + 1; whoever empties the
+// floor bucket advances the floor, so readers get the minimum with one load.
+// Buckets are indexed by count % COUNT_WINDOW, so while the counts span more
+// than the window one bucket holds two counts and the floor can lag behind.
+typedef struct {
+    _Alignas(CACHE_LINE_SIZE) atomic_int floor;
+    atomic_int highest;  // Highest count reached; highest - floor is the spread
+    CountBucket buckets[COUNT_WINDOW];
+} CountTracker;
+
+static inline void count_tracker_init(CountTracker* tracker, int num_philosophers) {
+    atomic_init(&tracker->floor, 0);
+    atomic_init(&tracker->highest, 0);
+    for (int i = 0; i < COUNT_WINDOW; i++) {
+        atomic_init(&tracker->buckets[i].philosophers, 0);
+    }
+    atomic_init(&tracker->buckets[0].philosophers, num_philosophers);
+}
+
+// Record that one philosopher's count went from old_count to old_count + 1
+static inline void count_tracker_increment(CountTracker* tracker, int old_count) {
+    int new_count = old_count + 1;
+    int highest = atomic_load(&tracker->highest);
+    while (new_count > highest && !atomic_compare_exchange_weak(&tracker->highest, &highest, new_count)) {
+    }
+
+    // Enter the new bucket before leaving the old one so the floor never
+    // passes a philosopher that is still in flight
+    atomic_fetch_add(&tracker->buckets[new_count % COUNT_WINDOW].philosophers, 1);
+    if (atomic_fetch_sub(&tracker->buckets[old_count % COUNT_WINDOW].philosophers, 1) == 1) {
+        int expected = old_count;
+        atomic_compare_exchange_strong(&tracker->floor, &expected, new_count);
+    }
+}
+
+// Lowest invoke count in O(1), or -1 when the caller has to fall back to a scan
+static inline int count_tracker_lowest(CountTracker* tracker) {
+    // Counts never drop, so nobody can come back to an empty floor bucket:
+    // the floor may always move past it. This catches up a floor that lagged
+    // while a bucket held two counts.
+    int floor = atomic_load(&tracker->floor);
+    while (floor < atomic_load(&tracker->highest) &&
+           atomic_load(&tracker->buckets[floor % COUNT_WINDOW].philosophers) == 0) {
+        if (atomic_compare_exchange_strong(&tracker->floor, &floor, floor + 1)) {
+            floor++;
+        }
+    }
+    if (atomic_load(&tracker->highest) - floor >= COUNT_WINDOW) {
+        return -1;  // The floor bucket may hold a higher count too
+    }
+    return floor;
+}
+
+// Hand back the minimum a fallback scan found. Counts never drop, so it is
+// still a lower bound and the floor can jump to it; once the spread fits the
+// window again, count_tracker_lowest() is exact without scanning.
+static inline void count_tracker_raise_floor(CountTracker* tracker, int lowest) {
+    int floor = atomic_load(&tracker->floor);
+    while (lowest > floor && !atomic_compare_exchange_weak(&tracker->floor, &floor, lowest)) {
+    }
+}
+
+#endif // COUNT_TRACKER_H
@@ -0,0 +1,791 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+
+#include "philo_common.h"
+#include "philo_random.h"
+#include "futex_handoff.h"
+#include "count_tracker.h"
+
+// Single-threaded discrete-event version of the four simulations. Every
+// philosopher has exactly one pending event: the point where its thread would
+// next wake up (end of a think/eat sleep, the next poll of the wait loop or
+// the next execute_task() call). Events are kept in an indexed min-heap on
+// (time, sequence), so runs are deterministic for a given seed and only cost
+// O(log N) per transition no matter how many philosophers there are.
+
+#define MAX_WAIT_TIME 6
+#define MAX_WAIT_NS (MAX_WAIT_TIME * NS_PER_SEC)
+#define POLL_INTERVAL_NS (50 * NS_PER_MS)  // usleep(50000) in the threaded loops
+#define DES_MAX_PHILOSOPHERS 100000000
+#define DEFAULT_DURATION_SECONDS 3600
+#define NEVER LLONG_MAX
+
+typedef enum {
+    POLICY_MANAGER,     // project_1_c.c
+    POLICY_FRAME,       // project_with_frame.c
+    POLICY_STARVATION,  // project_with_starvation.c
+    POLICY_DEADLOCK,    // project_with_deadlock.c
+} Policy;
+
+static const char* const policy_names[] = {
+    [POLICY_MANAGER] = "manager",
+    [POLICY_FRAME] = "frame",
+    [POLICY_STARVATION] = "starvation",
+    [POLICY_DEADLOCK] = "deadlock",
+};
+
+enum {
+    EVENT_EATING,
+    EVENT_THINKING,
+    EVENT_WAITING,
+    EVENT_WAITED_TOO_LONG,
+};
+
+static const char* const event_formats[] = {
+    [EVENT_EATING] = "Philosopher %d is eating.\n",
+    [EVENT_THINKING] = "Philosopher %d is thinking.\n",
+    [EVENT_WAITING] = "Philosopher %d is waiting.\n",
+    [EVENT_WAITED_TOO_LONG] = "Philosopher %d waited too long and returned to thinking.\n",
+};
+
+#define NOT_PARKED -1
+#define PARKED_ON_MEALS -2  // project_1_c.c -b: sleeping on eating_seq
+
+typedef struct {
+    int state;  // 1: thinking, 2: waiting, 3: eating
+    int philosopher_id;
+    int invoke_count;
+    int must_think;
+    long long wait_start;
+    TaskPhase phase;
+    int try_after_think;  // think() is followed by try_to_wait()
+    int parked_on;        // -b: chopstick index or PARKED_ON_MEALS, else NOT_PARKED
+
+    long long next_ns;         // Pending event, mirrored in its heap entry
+    unsigned long long order;
+    int heap_index;
+} Philosopher;
+
+typedef struct {
+    Policy policy;
+    int num_philosophers;
+    long long duration_seconds;  // Simulated
+    long long max_steps;         // 0: no limit
+    unsigned int seed;
+    const char* distributions;  // Think/eat durations (NULL: uniform)
+    int acquire_pairs;
+    int blocking;
+    int verbose;
+} SimOptions;
+
+// Simulation state; single-threaded, so plain ints throughout
+SimOptions options;
+int num_philosophers;
+Philosopher* philosophers;
+int* chopstick_owner;  // 0: free, otherwise philosopher ID + 1
+CountTracker meal_counts;
+long long now_ns = 0;
+unsigned long long next_order = 0;
+long long loop_delay_ns = POLL_INTERVAL_NS;
+
+typedef struct {
+    long long time_ns;
+    unsigned long long order;  // FIFO among events at the same time
+    int philosopher_id;
+} EventEntry;
+
+EventEntry* event_heap;  // Min-heap on (time_ns, order), one entry per philosopher
+int event_heap_size = 0;
+
+// project_1_c.c manager state
+typedef struct {
+    unsigned long long* keys;
+    int* ids;
+    int size;
+} ThinkerHeap;
+
+ThinkerHeap thinkers;
+int waiting_count = 0;
+int eating_count = 0;
+int* meal_waiters;  // -b: philosophers parked on PARKED_ON_MEALS
+int num_meal_waiters = 0;
+
+// Statistics
+long long total_steps = 0;
+long long total_transitions = 0;
+long long total_timeouts = 0;
+int stuck_waiting = 0;  // Waiting while holding the right chopstick (deadlock policy)
+
+// Utility functions
+int get_random(int min, int max) {
+    int result = 0, low_num = 0, hi_num = 0;
+    if (min < max) {
+        low_num = min;
+        hi_num = max + 1;
+    } else {
+        low_num = max + 1;
+        hi_num = min;
+    }
+    result = (int)random_below(hi_num - low_num) + low_num;
+    return result;
+}
+
+void log_sim_event(Philosopher* philosopher, int type) {
+    if (options.verbose) {
+        printf("[%12.3f] ", (double)now_ns / NS_PER_SEC);
+        printf(event_formats[type], philosopher->philosopher_id);
+    }
+}
+
+void set_state(Philosopher* philosopher, int state) {
+    if (philosopher->state != state) {
+        eating_count += (state == 3) - (philosopher->state == 3);
+        philosopher->state = state;
+        total_transitions++;
+    }
+}
+
+int get_lowest_count() {
+    int tracked = count_tracker_lowest(&meal_counts);
+    if (tracked >= 0) {
+        return tracked;
+    }
+
+    int lowest = philosophers[0].invoke_count;
+    for (int i = 1; i < num_philosophers; i++) {
+        if (philosophers[i].invoke_count < lowest) {
+            lowest = philosophers[i].invoke_count;
+        }
+    }
+    return lowest;
+}
+
+void count_meal(Philosopher* philosopher) {
+    count_tracker_increment(&meal_counts, philosopher->invoke_count++);
+}
+
+// Event queue: an indexed binary heap so a philosopher's pending event can
+// be moved earlier when it is woken by a release. Keys are stored inline so
+// sifting never touches the philosopher table.
+int event_before(const EventEntry* a, const EventEntry* b) {
+    return a->time_ns < b->time_ns || (a->time_ns == b->time_ns && a->order < b->order);
+}
+
+void event_heap_place(int index, EventEntry entry) {
+    event_heap[index] = entry;
+    philosophers[entry.philosopher_id].heap_index = index;
+}
+
+void event_heap_sift_up(int index) {
+    EventEntry entry = event_heap[index];
+    while (index > 0 && event_before(&entry, &event_heap[(index - 1) / 2])) {
+        event_heap_place(index, event_heap[(index - 1) / 2]);
+        index = (index - 1) / 2;
+    }
+    event_heap_place(index, entry);
+}
+
+void event_heap_sift_down(int index) {
+    EventEntry entry = event_heap[index];
+    while (2 * index + 1 < event_heap_size) {
+        int child = 2 * index + 1;
+        if (child + 1 < event_heap_size && event_before(&event_heap[child + 1], &event_heap[child])) {
+            child++;
+        }
+        if (!event_before(&event_heap[child], &entry)) {
+            break;
+        }
+        event_heap_place(index, event_heap[child]);
+        index = child;
+    }
+    event_heap_place(index, entry);
+}
+
+// Set a philosopher's next event. The philosopher being stepped stays at the
+// top of the heap with its old key, which is smaller than any key created
+// during the step, and the engine re-sifts it afterwards.
+void schedule(Philosopher* philosopher, long long delay_ns) {
+    EventEntry* entry = &event_heap[philosopher->heap_index];
+    long long previous = entry->time_ns;
+    philosopher->next_ns = delay_ns == NEVER ? NEVER : now_ns + delay_ns;
+    philosopher->order = next_order++;
+    if (philosopher->heap_index > 0) {
+        entry->time_ns = philosopher->next_ns;
+        entry->order = philosopher->order;
+        if (philosopher->next_ns < previous) {
+            event_heap_sift_up(philosopher->heap_index);
+        } else {
+            event_heap_sift_down(philosopher->heap_index);
+        }
+    }
+}
+
+void sleep_until_phase(Philosopher* philosopher, TaskPhase phase, long long delay_ns) {
+    philosopher->phase = phase;
+    schedule(philosopher, delay_ns);
+}
+
+// execute_task() returned: the thread loop sleeps 50 ms (none with -b)
+void finish_task(Philosopher* philosopher) {
+    sleep_until_phase(philosopher, PHASE_DISPATCH, loop_delay_ns);
+}
+
+void park(Philosopher* philosopher, int resource, TaskPhase phase, long long timeout_ns) {
+    philosopher->parked_on = resource;
+    sleep_until_phase(philosopher, phase, timeout_ns);
+}
+
+void unpark(Philosopher* philosopher) {
+    philosopher->parked_on = NOT_PARKED;
+    schedule(philosopher, 0);
+}
+
+// Chopsticks. Chopstick c is the right one of philosopher c and the left one
+// of philosopher c + 1, so those are the only two that can be parked on it.
+int left_chopstick(Philosopher* philosopher) {
+    return (philosopher->philosopher_id - 1 + num_philosophers) % num_philosophers;
+}
+
+int right_chopstick(Philosopher* philosopher) {
+    return philosopher->philosopher_id;
+}
+
+int try_take_chopstick(Philosopher* philosopher, int index) {
+    if (chopstick_owner[index] != 0) {
+        return 0;
+    }
+    chopstick_owner[index] = philosopher->philosopher_id + 1;
+    return 1;
+}
+
+void release_chopstick(int index) {
+    chopstick_owner[index] = 0;
+    Philosopher* candidates[2] = {&philosophers[index], &philosophers[(index + 1) % num_philosophers]};
+    for (int i = 0; i < 2; i++) {
+        if (candidates[i]->parked_on == index) {
+            unpark(candidates[i]);
+        }
+    }
+}
+
+// Pair mode: nobody holds one chopstick while waiting for the other
+int try_take_pair(Philosopher* philosopher) {
+    int left = left_chopstick(philosopher);
+    int right = right_chopstick(philosopher);
+    if (chopstick_owner[left] != 0 || chopstick_owner[right] != 0) {
+        return 0;
+    }
+    chopstick_owner[left] = chopstick_owner[right] = philosopher->philosopher_id + 1;
+    return 1;
+}
+
+void release_pair(Philosopher* philosopher) {
+    release_chopstick(left_chopstick(philosopher));
+    release_chopstick(right_chopstick(philosopher));
+}
+
+// ---------------------------------------------------------------------------
+// project_1_c.c: a manager keeps at most two philosophers waiting, promoting
+// the thinkers with the lowest invoke count
+
+void thinker_heap_push(int philosopher_id) {
+    unsigned long long key = ((unsigned long long)philosophers[philosopher_id].invoke_count << 32) |
+                             random_next32();
+    int i = thinkers.size++;
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (thinkers.keys[parent] <= key) {
+            break;
+        }
+        thinkers.keys[i] = thinkers.keys[parent];
+        thinkers.ids[i] = thinkers.ids[parent];
+        i = parent;
+    }
+    thinkers.keys[i] = key;
+    thinkers.ids[i] = philosopher_id;
+}
+
+int thinker_heap_pop() {
+    int top = thinkers.ids[0];
+    unsigned long long key = thinkers.keys[--thinkers.size];
+    int id = thinkers.ids[thinkers.size];
+    int i = 0;
+    while (2 * i + 1 < thinkers.size) {
+        int child = 2 * i + 1;
+        if (child + 1 < thinkers.size && thinkers.keys[child + 1] < thinkers.keys[child]) {
+            child++;
+        }
+        if (key <= thinkers.keys[child]) {
+            break;
+        }
+        thinkers.keys[i] = thinkers.keys[child];
+        thinkers.ids[i] = thinkers.ids[child];
+        i = child;
+    }
+    thinkers.keys[i] = key;
+    thinkers.ids[i] = id;
+    return top;
+}
+
+void become_waiting(Philosopher* philosopher) {
+    set_state(philosopher, 2);
+    philosopher->wait_start = now_ns;
+    waiting_count++;
+}
+
+// The manager thread reacts instantly to every signal of manager_cond
+void run_manager() {
+    int lowest = get_lowest_count();
+    while (waiting_count < 2 && thinkers.size > 0 && (int)(thinkers.keys[0] >> 32) == lowest) {
+        become_waiting(&philosophers[thinker_heap_pop()]);
+    }
+}
+
+void become_thinking(Philosopher* philosopher) {
+    if (philosopher->state == 2) {
+        waiting_count--;
+    }
+    set_state(philosopher, 1);
+    thinker_heap_push(philosopher->philosopher_id);
+    run_manager();
+}
+
+void become_eating(Philosopher* philosopher) {
+    waiting_count--;
+    set_state(philosopher, 3);
+    run_manager();
+}
+
+void forget_meal_waiter(Philosopher* philosopher) {
+    for (int i = 0; i < num_meal_waiters; i++) {
+        if (meal_waiters[i] == philosopher->philosopher_id) {
+            meal_waiters[i] = meal_waiters[--num_meal_waiters];
+            break;
+        }
+    }
+    philosopher->parked_on = NOT_PARKED;
+}
+
+void announce_finished_eating() {
+    while (num_meal_waiters > 0) {
+        unpark(&philosophers[meal_waiters[--num_meal_waiters]]);
+    }
+}
+
+void manager_wait(Philosopher* philosopher) {
+    long long waited_ns = now_ns - philosopher->wait_start;
+    if (waited_ns >= MAX_WAIT_NS) {
+        log_sim_event(philosopher, EVENT_WAITED_TOO_LONG);
+        total_timeouts++;
+        become_thinking(philosopher);
+        finish_task(philosopher);
+        return;
+    }
+
+    log_sim_event(philosopher, EVENT_WAITING);
+
+    int prev_state = philosophers[(philosopher->philosopher_id - 1 + num_philosophers) % num_philosophers].state;
+    int next_state = philosophers[(philosopher->philosopher_id + 1) % num_philosophers].state;
+    int has_priority = philosopher->invoke_count == get_lowest_count() || waited_ns >= MAX_WAIT_NS / 2;
+    if (has_priority && prev_state != 3 && next_state != 3 &&
+        (eating_count == 0 || philosopher->must_think == 0)) {
+        become_eating(philosopher);
+        finish_task(philosopher);
+    } else if (options.blocking) {
+        // Sleep on eating_seq until someone stops eating or a deadline passes
+        long long deadline_ns = waited_ns < MAX_WAIT_NS / 2 ? MAX_WAIT_NS / 2 : MAX_WAIT_NS;
+        meal_waiters[num_meal_waiters++] = philosopher->philosopher_id;
+        park(philosopher, PARKED_ON_MEALS, PHASE_DISPATCH, deadline_ns - waited_ns);
+    } else {
+        finish_task(philosopher);
+    }
+}
+
+void manager_step(Philosopher* philosopher) {
+    switch (philosopher->phase) {
+        case PHASE_DISPATCH:
+            if (philosopher->parked_on != NOT_PARKED) {
+                forget_meal_waiter(philosopher);  // The futex wait timed out
+            }
+            if (philosopher->must_think && philosopher->state != 2) {
+                log_sim_event(philosopher, EVENT_THINKING);
+                sleep_until_phase(philosopher, PHASE_THOUGHT, random_think_ns(1, 5));
+            } else if (philosopher->state == 2) {
+                manager_wait(philosopher);
+            } else if (philosopher->state == 3) {
+                log_sim_event(philosopher, EVENT_EATING);
+                sleep_until_phase(philosopher, PHASE_ATE, random_eat_ns(1, 4));
+            } else {
+                log_sim_event(philosopher, EVENT_THINKING);
+                sleep_until_phase(philosopher, PHASE_THOUGHT, random_think_ns(1, 5));
+            }
+            break;
+        case PHASE_THOUGHT:
+            if (philosopher->must_think && philosopher->invoke_count <= get_lowest_count() + 1) {
+                philosopher->must_think = 0;
+            }
+            finish_task(philosopher);
+            break;
+        case PHASE_ATE:
+            count_meal(philosopher);
+            if (philosopher->invoke_count > get_lowest_count() + 1) {
+                philosopher->must_think = 1;
+            }
+            become_thinking(philosopher);
+            announce_finished_eating();
+            finish_task(philosopher);
+            break;
+        case PHASE_WAITING:
+            break;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Chopstick variants: think, grab the right chopstick (try_to_wait), poll for
+// the left one (wait), eat, release
+
+void try_to_wait(Philosopher* philosopher) {
+    if (options.acquire_pairs) {
+        set_state(philosopher, 2);
+    } else if (try_take_chopstick(philosopher, right_chopstick(philosopher))) {
+        set_state(philosopher, 2);
+        stuck_waiting++;
+    }
+}
+
+// One pass of wait()'s retry loop; returns 1 when wait() is over
+int wait_pass(Philosopher* philosopher) {
+    int has_timeout = options.policy != POLICY_DEADLOCK;
+    if (has_timeout && now_ns - philosopher->wait_start > MAX_WAIT_NS) {
+        if (!options.acquire_pairs) {
+            release_chopstick(right_chopstick(philosopher));
+            stuck_waiting--;
+        }
+        set_state(philosopher, 1);
+        log_sim_event(philosopher, EVENT_WAITED_TOO_LONG);
+        total_timeouts++;
+        return 1;
+    }
+
+    int left = left_chopstick(philosopher);
+    int contended;
+    if (options.acquire_pairs) {
+        if (try_take_pair(philosopher)) {
+            set_state(philosopher, 3);
+            return 1;
+        }
+        contended = chopstick_owner[left] != 0 ? left : right_chopstick(philosopher);
+    } else {
+        if (try_take_chopstick(philosopher, left)) {
+            stuck_waiting--;
+            set_state(philosopher, 3);
+            return 1;
+        }
+        contended = left;
+    }
+
+    if (options.blocking) {
+        long long timeout_ns = has_timeout ? philosopher->wait_start + MAX_WAIT_NS + 1 - now_ns : NEVER;
+        park(philosopher, contended, PHASE_WAITING, timeout_ns);
+    } else {
+        sleep_until_phase(philosopher, PHASE_WAITING, POLL_INTERVAL_NS);
+    }
+    return 0;
+}
+
+void chopstick_eat_done(Philosopher* philosopher) {
+    count_meal(philosopher);
+    if (options.policy == POLICY_FRAME && philosopher->invoke_count > get_lowest_count() + 2) {
+        philosopher->must_think = 1;
+    }
+
+    if (options.policy == POLICY_STARVATION) {
+        // Keeps the right chopstick and goes straight back to waiting
+        set_state(philosopher, 2);
+        if (options.acquire_pairs) {
+            release_pair(philosopher);
+        } else {
+            release_chopstick(left_chopstick(philosopher));
+            stuck_waiting++;
+        }
+        return;
+    }
+
+    set_state(philosopher, 1);
+    if (options.acquire_pairs) {
+        release_pair(philosopher);
+    } else {
+        release_chopstick(left_chopstick(philosopher));
+        release_chopstick(right_chopstick(philosopher));
+    }
+}
+
+void chopstick_step(Philosopher* philosopher) {
+    switch (philosopher->phase) {
+        case PHASE_DISPATCH:
+            if (options.policy == POLICY_FRAME) {
+                philosopher->must_think = philosopher->invoke_count > get_lowest_count() + 2;
+            }
+            if (philosopher->must_think && philosopher->state != 2) {
+                // Forced thinking, without trying for a chopstick afterwards
+                philosopher->try_after_think = 0;
+                log_sim_event(philosopher, EVENT_THINKING);
+                sleep_until_phase(philosopher, PHASE_THOUGHT, random_think_ns(2, 5));
+            } else if (philosopher->state == 2) {
+                philosopher->wait_start = now_ns;
+                if (wait_pass(philosopher)) {
+                    finish_task(philosopher);
+                }
+            } else if (philosopher->state == 3) {
+                log_sim_event(philosopher, EVENT_EATING);
+                sleep_until_phase(philosopher, PHASE_ATE, random_eat_ns(1, 4));
+            } else {
+                philosopher->try_after_think = 1;
+                log_sim_event(philosopher, EVENT_THINKING);
+                sleep_until_phase(philosopher, PHASE_THOUGHT, random_think_ns(2, 5));
+            }
+            break;
+        case PHASE_THOUGHT:
+            if (philosopher->try_after_think) {
+                try_to_wait(philosopher);
+            }
+            finish_task(philosopher);
+            break;
+        case PHASE_ATE:
+            chopstick_eat_done(philosopher);
+            finish_task(philosopher);
+            break;
+        case PHASE_WAITING:
+            if (philosopher->parked_on != NOT_PARKED) {
+                philosopher->parked_on = NOT_PARKED;  // Timed out rather than woken
+            }
+            if (wait_pass(philosopher)) {
+                finish_task(philosopher);
+            }
+            break;
+    }
+}
+
+// ---------------------------------------------------------------------------
+
+void usage(const char* program) {
+    fprintf(stderr, "Usage: %s [-p policy] [-n num_philosophers] [-d seconds] [-e steps] [-r seed] "
+                    "[-a single|pair] [-b] [-v] [-D distribution]\n", program);
+    fprintf(stderr, "  -p <policy>  manager (project_1_c.c), frame, starvation or deadlock (default frame)\n");
+    fprintf(stderr, "  -n <count>   number of philosophers (2-%d, default %d)\n",
+            DES_MAX_PHILOSOPHERS, DEFAULT_NUM_PHILOSOPHERS);
+    fprintf(stderr, "  -d <seconds> simulated time to run (default %d)\n", DEFAULT_DURATION_SECONDS);
+    fprintf(stderr, "  -e <steps>   stop after this many events (default: no limit)\n");
+    fprintf(stderr, "  -r <seed>    random seed; equal seeds give identical runs (default 1)\n");
+    fprintf(stderr, "  -a <mode>    chopstick acquisition: single (default) or pair\n");
+    fprintf(stderr, "  -b           waiters sleep until a release instead of polling every 50 ms\n");
+    fprintf(stderr, "  -v           print every event with its simulated timestamp\n");
+    fprintf(stderr, "  -D <dist>    think/eat durations: uniform (default), exponential or bimodal,\n");
+    fprintf(stderr, "               one for both or <think>:<eat>\n");
+}
+
+void parse_sim_options(int argc, char* argv[]) {
+    options.policy = POLICY_FRAME;
+    options.num_philosophers = DEFAULT_NUM_PHILOSOPHERS;
+    options.duration_seconds = DEFAULT_DURATION_SECONDS;
+    options.max_steps = 0;
+    options.seed = 1;
+    options.distributions = NULL;
+    options.acquire_pairs = 0;
+    options.blocking = 0;
+    options.verbose = 0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "p:n:d:e:r:a:bvD:h")) != -1) {
+        switch (opt) {
+            case 'p': {
+                int found = 0;
+                for (int i = 0; i < (int)(sizeof(policy_names) / sizeof(policy_names[0])); i++) {
+                    if (strcmp(optarg, policy_names[i]) == 0) {
+                        options.policy = (Policy)i;
+                        found = 1;
+                    }
+                }
+                if (!found) {
+                    fprintf(stderr, "Unknown policy: %s\n", optarg);
+                    exit(1);
+                }
+                break;
+            }
+            case 'n':
+                options.num_philosophers = atoi(optarg);
+                break;
+            case 'd':
+                options.duration_seconds = atoll(optarg);
+                break;
+            case 'e':
+                options.max_steps = atoll(optarg);
+                break;
+            case 'r':
+                options.seed = (unsigned int)strtoul(optarg, NULL, 10);
+                break;
+            case 'a':
+                if (strcmp(optarg, "pair") == 0) {
+                    options.acquire_pairs = 1;
+                } else if (strcmp(optarg, "single") != 0) {
+                    fprintf(stderr, "Unknown acquisition mode: %s\n", optarg);
+                    exit(1);
+                }
+                break;
+            case 'b':
+                options.blocking = 1;
+                break;
+            case 'v':
+                options.verbose = 1;
+                break;
+            case 'D':
+                options.distributions = optarg;
+                break;
+            case 'h':
+            default:
+                usage(argv[0]);
+                exit(opt == 'h' ? 0 : 1);
+        }
+    }
+
+    if (options.num_philosophers < 2 || options.num_philosophers > DES_MAX_PHILOSOPHERS) {
+        fprintf(stderr, "Number of philosophers must be between 2 and %d\n", DES_MAX_PHILOSOPHERS);
+        exit(1);
+    }
+    if (options.policy == POLICY_MANAGER && options.acquire_pairs) {
+        fprintf(stderr, "-a applies to the chopstick policies only\n");
+        exit(1);
+    }
+}
+
+void init_simulation() {
+    num_philosophers = options.num_philosophers;
+    philosophers = calloc(num_philosophers, sizeof(Philosopher));
+    chopstick_owner = calloc(num_philosophers, sizeof(int));
+    event_heap = malloc(num_philosophers * sizeof(EventEntry));
+    if (philosophers == NULL || chopstick_owner == NULL || event_heap == NULL) {
+        perror("malloc");
+        exit(1);
+    }
+    if (random_init(options.seed, options.distributions) != 0) {
+        exit(1);
+    }
+    count_tracker_init(&meal_counts, num_philosophers);
+    loop_delay_ns = options.blocking ? 0 : POLL_INTERVAL_NS;
+
+    // Every thread starts at the top of its loop at time zero, in ID order
+    for (int i = 0; i < num_philosophers; i++) {
+        philosophers[i].state = 1;
+        philosophers[i].philosopher_id = i;
+        philosophers[i].phase = PHASE_DISPATCH;
+        philosophers[i].parked_on = NOT_PARKED;
+        philosophers[i].next_ns = 0;
+        philosophers[i].order = next_order++;
+        event_heap_place(i, (EventEntry){0, philosophers[i].order, i});
+    }
+    event_heap_size = num_philosophers;
+
+    if (options.policy == POLICY_MANAGER) {
+        thinkers.keys = malloc(num_philosophers * sizeof(unsigned long long));
+        thinkers.ids = malloc(num_philosophers * sizeof(int));
+        meal_waiters = malloc(num_philosophers * sizeof(int));
+        int first = get_random(0, num_philosophers - 1);
+        become_waiting(&philosophers[first]);
+        for (int i = 0; i < num_philosophers; i++) {
+            if (i != first) {
+                thinker_heap_push(i);
+            }
+        }
+        run_manager();
+    }
+}
+
+// Run events in time order until the duration or step budget is used up.
+// Returns 1 if the simulation reached a deadlock.
+int run_simulation() {
+    long long end_ns = options.duration_seconds * NS_PER_SEC;
+    while (options.max_steps == 0 || total_steps < options.max_steps) {
+        Philosopher* philosopher = &philosophers[event_heap[0].philosopher_id];
+        if (philosopher->next_ns > end_ns) {
+            // Nothing left to run before the end: either time is up or every
+            // philosopher is parked forever
+            now_ns = philosopher->next_ns == NEVER ? now_ns : end_ns;
+            return philosopher->next_ns == NEVER;
+        }
+        now_ns = philosopher->next_ns;
+        total_steps++;
+
+        if (options.policy == POLICY_MANAGER) {
+            manager_step(philosopher);
+        } else {
+            chopstick_step(philosopher);
+        }
+        event_heap[0].time_ns = philosopher->next_ns;
+        event_heap[0].order = philosopher->order;
+        event_heap_sift_down(0);
+
+        // Everyone holds a right chopstick and waits for a left one
+        if (options.policy == POLICY_DEADLOCK && stuck_waiting == num_philosophers) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void print_summary(int deadlocked, double real_seconds) {
+    int shown = num_philosophers < STATUS_DISPLAY_LIMIT ? num_philosophers : STATUS_DISPLAY_LIMIT;
+    long long total_meals = 0;
+    int fewest = philosophers[0].invoke_count;
+    int most = philosophers[0].invoke_count;
+    for (int i = 0; i < num_philosophers; i++) {
+        total_meals += philosophers[i].invoke_count;
+        fewest = philosophers[i].invoke_count < fewest ? philosophers[i].invoke_count : fewest;
+        most = philosophers[i].invoke_count > most ? philosophers[i].invoke_count : most;
+    }
+
+    printf("\nFinal Status:\n");
+    for (int i = 0; i < shown; i++) {
+        printf("Philosopher %d - State: %d, Invoke count: %d, Must think: %d\n",
+               i, philosophers[i].state, philosophers[i].invoke_count, philosophers[i].must_think);
+    }
+    if (shown < num_philosophers) {
+        printf("... %d more philosophers\n", num_philosophers - shown);
+    }
+
+    double simulated = (double)now_ns / NS_PER_SEC;
+    if (deadlocked) {
+        printf("\nDeadlock at %.3f s: every philosopher holds one chopstick and waits for another\n", simulated);
+    }
+    printf("\nPolicy: %s, philosophers: %d, seed: %u, durations: think %s, eat %s\n", policy_names[options.policy],
+           num_philosophers, options.seed, duration_distribution_names[random_config.think],
+           duration_distribution_names[random_config.eat]);
+    printf("Total meals: %lld in %.1f s simulated (%.2f meals/sec), per philosopher %d-%d\n",
+           total_meals, simulated, simulated > 0 ? total_meals / simulated : 0.0, fewest, most);
+    printf("Events: %lld, transitions: %lld, timeouts: %lld in %.2f s real (%.0f events/sec)\n",
+           total_steps, total_transitions, total_timeouts, real_seconds,
+           real_seconds > 0 ? total_steps / real_seconds : 0.0);
+}
+
+int main(int argc, char* argv[]) {
+    parse_sim_options(argc, argv);
+    init_simulation();
+
+    long long start_ns = monotonic_ns();
+    int deadlocked = run_simulation();
+    double real_seconds = (double)(monotonic_ns() - start_ns) / NS_PER_SEC;
+
+    print_summary(deadlocked, real_seconds);
+
+    free(philosophers);
+    free(chopstick_owner);
+    free(event_heap);
+    if (options.policy == POLICY_MANAGER) {
+        free(thinkers.keys);
+        free(thinkers.ids);
+        free(meal_waiters);
+    }
+    return 0;
+}
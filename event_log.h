@@ -0,0 +1,233 @@
+#ifndef EVENT_LOG_H
+#define EVENT_LOG_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+
+#include "philo_common.h"
+#include "futex_handoff.h"
+#include "shared_memory.h"
+
+// Power of two; a philosopher produces a few events per second and the
+// writer drains every few milliseconds, so a small ring is plenty
+#define EVENT_RING_SIZE 128
+#define EVENT_WRITE_BUFFER_SIZE (256 * 1024)
+#define EVENT_MAP_CHUNK (16 * 1024 * 1024)
+#define EVENT_BATCH_SIZE 65536  // Records sorted and formatted together
+#define EVENT_DRAIN_INTERVAL_US 5000
+
+// Binary record produced by the workers; formatting happens on the writer
+typedef struct {
+    long long timestamp_ns;
+    int source;  // Ring index, normally the philosopher ID
+    int type;    // Index into the program's format table
+    int arg;     // Optional second value passed to the format string
+} EventRecord;
+
+// Single-producer single-consumer ring: only its owner thread appends
+typedef struct {
+    _Alignas(CACHE_LINE_SIZE) atomic_uint head;  // Next slot the producer writes
+    _Alignas(CACHE_LINE_SIZE) atomic_uint tail;  // Next slot the writer reads
+    atomic_uint dropped;                         // Records lost because the ring was full
+    EventRecord records[EVENT_RING_SIZE];
+} EventRing;
+
+typedef struct {
+    EventRing* rings;  // In the shared segment in process mode, drained by the parent
+    int num_rings;
+    const char* const* formats;  // printf formats taking (source, arg)
+
+    // Output: either a file descriptor written in large batches or a
+    // memory-mapped file that grows in EVENT_MAP_CHUNK steps
+    int fd;
+    int mapped;
+    char* map;
+    size_t map_capacity;
+    size_t map_used;
+
+    char* buffer;
+    size_t buffer_used;
+    EventRecord* batch;
+    pthread_t writer;
+    atomic_int stop;
+} EventLog;
+
+static inline void log_event_arg(EventLog* log, int source, int type, int arg) {
+    EventRing* ring = &log->rings[source];
+    unsigned int head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    unsigned int tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    if (head - tail == EVENT_RING_SIZE) {
+        // Never block a worker on I/O; count the loss instead
+        atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+        return;
+    }
+    EventRecord* record = &ring->records[head & (EVENT_RING_SIZE - 1)];
+    record->timestamp_ns = monotonic_ns();
+    record->source = source;
+    record->type = type;
+    record->arg = arg;
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+static inline void log_event(EventLog* log, int source, int type) {
+    log_event_arg(log, source, type, 0);
+}
+
+static inline void event_log_output(EventLog* log, const char* data, size_t length) {
+    if (!log->mapped) {
+        while (length > 0) {
+            ssize_t written = write(log->fd, data, length);
+            if (written <= 0) {
+                return;
+            }
+            data += written;
+            length -= written;
+        }
+        return;
+    }
+
+    if (log->map_used + length > log->map_capacity) {
+        size_t new_capacity = log->map_capacity + EVENT_MAP_CHUNK;
+        if (ftruncate(log->fd, new_capacity) != 0) {
+            return;
+        }
+        char* grown = mremap(log->map, log->map_capacity, new_capacity, MREMAP_MAYMOVE);
+        if (grown == MAP_FAILED) {
+            return;
+        }
+        log->map = grown;
+        log->map_capacity = new_capacity;
+    }
+    memcpy(log->map + log->map_used, data, length);
+    log->map_used += length;
+}
+
+static inline void event_log_flush(EventLog* log) {
+    if (log->buffer_used > 0) {
+        event_log_output(log, log->buffer, log->buffer_used);
+        log->buffer_used = 0;
+    }
+}
+
+static inline int compare_event_records(const void* a, const void* b) {
+    long long left = ((const EventRecord*)a)->timestamp_ns;
+    long long right = ((const EventRecord*)b)->timestamp_ns;
+    return (left > right) - (left < right);
+}
+
+static inline void event_log_format_batch(EventLog* log, int count) {
+    qsort(log->batch, count, sizeof(EventRecord), compare_event_records);
+    for (int i = 0; i < count; i++) {
+        if (EVENT_WRITE_BUFFER_SIZE - log->buffer_used < 256) {
+            event_log_flush(log);
+        }
+        int length = snprintf(log->buffer + log->buffer_used, EVENT_WRITE_BUFFER_SIZE - log->buffer_used,
+                              log->formats[log->batch[i].type], log->batch[i].source, log->batch[i].arg);
+        if (length > 0) {
+            log->buffer_used += length;
+        }
+    }
+}
+
+// Move everything currently in the rings into the output, oldest first
+// within each batch
+static inline int event_log_drain(EventLog* log) {
+    int total = 0;
+    int count = 0;
+    for (int i = 0; i < log->num_rings; i++) {
+        EventRing* ring = &log->rings[i];
+        unsigned int tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+        unsigned int head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        while (tail != head) {
+            if (count == EVENT_BATCH_SIZE) {
+                event_log_format_batch(log, count);
+                total += count;
+                count = 0;
+            }
+            log->batch[count++] = ring->records[tail & (EVENT_RING_SIZE - 1)];
+            tail++;
+        }
+        atomic_store_explicit(&ring->tail, tail, memory_order_release);
+    }
+
+    event_log_format_batch(log, count);
+    event_log_flush(log);
+    return total + count;
+}
+
+static inline void* event_log_writer(void* arg) {
+    EventLog* log = (EventLog*)arg;
+    while (!atomic_load(&log->stop)) {
+        if (event_log_drain(log) == 0) {
+            usleep(EVENT_DRAIN_INTERVAL_US);
+        }
+    }
+    event_log_drain(log);
+    return NULL;
+}
+
+// Start the writer thread. With a path the log goes to a memory-mapped file,
+// otherwise to stdout. Returns 0 on success.
+static inline int event_log_start(EventLog* log, int num_rings, const char* const* formats, const char* path) {
+    log->rings = shared_alloc(num_rings, sizeof(EventRing));
+    log->num_rings = num_rings;
+    log->formats = formats;
+    log->buffer = malloc(EVENT_WRITE_BUFFER_SIZE);
+    log->buffer_used = 0;
+    log->batch = malloc(EVENT_BATCH_SIZE * sizeof(EventRecord));
+    log->mapped = 0;
+    log->fd = STDOUT_FILENO;
+    atomic_init(&log->stop, 0);
+
+    if (path != NULL) {
+        log->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (log->fd < 0 || ftruncate(log->fd, EVENT_MAP_CHUNK) != 0) {
+            perror(path);
+            return -1;
+        }
+        log->map = mmap(NULL, EVENT_MAP_CHUNK, PROT_READ | PROT_WRITE, MAP_SHARED, log->fd, 0);
+        if (log->map == MAP_FAILED) {
+            perror("mmap");
+            return -1;
+        }
+        log->mapped = 1;
+        log->map_capacity = EVENT_MAP_CHUNK;
+        log->map_used = 0;
+    }
+
+    fflush(stdout);  // Anything printed with stdio so far goes out first
+    return pthread_create(&log->writer, NULL, event_log_writer, log);
+}
+
+// Stop the writer after a final drain and report lost records
+static inline void event_log_stop(EventLog* log) {
+    atomic_store(&log->stop, 1);
+    pthread_join(log->writer, NULL);
+
+    unsigned long dropped = 0;
+    for (int i = 0; i < log->num_rings; i++) {
+        dropped += atomic_load(&log->rings[i].dropped);
+    }
+    if (dropped > 0) {
+        fprintf(stderr, "Event log dropped %lu events\n", dropped);
+    }
+
+    if (log->mapped) {
+        munmap(log->map, log->map_capacity);
+        if (ftruncate(log->fd, log->map_used) != 0) {
+            perror("ftruncate");
+        }
+        close(log->fd);
+    }
+    free(log->batch);
+    free(log->buffer);
+    shared_free(log->rings);
+}
+
+#endif // EVENT_LOG_H
@@ -0,0 +1,88 @@
+#ifndef FUTEX_HANDOFF_H
+#define FUTEX_HANDOFF_H
+
+#include <stdio.h>
+#include <stdatomic.h>
+#include <limits.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#define NS_PER_SEC 1000000000LL
+#define NS_PER_MS 1000000LL
+
+static inline long long monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * NS_PER_SEC + ts.tv_nsec;
+}
+
+// FUTEX_PRIVATE_FLAG lets the kernel key a futex on the address alone,
+// which is only right while every waiter is a thread of this process.
+// Process mode (shared_memory.h) clears it for futexes in the shared segment.
+static int futex_private_flag = FUTEX_PRIVATE_FLAG;
+
+static inline void futex_share_between_processes(void) {
+    futex_private_flag = 0;
+}
+
+// Sleep until *word != expected, a wake-up arrives or timeout_ns passes.
+// A negative timeout blocks without limit. Returns 0 when woken or when the
+// word already changed, ETIMEDOUT when the timeout elapsed.
+static inline int futex_wait(atomic_int* word, int expected, long long timeout_ns) {
+    struct timespec timeout;
+    struct timespec* timeout_ptr = NULL;
+    if (timeout_ns >= 0) {
+        timeout.tv_sec = timeout_ns / NS_PER_SEC;
+        timeout.tv_nsec = timeout_ns % NS_PER_SEC;
+        timeout_ptr = &timeout;
+    }
+    if (syscall(SYS_futex, (int*)word, FUTEX_WAIT | futex_private_flag, expected, timeout_ptr, NULL, 0) == -1) {
+        return errno == ETIMEDOUT ? ETIMEDOUT : 0;
+    }
+    return 0;
+}
+
+static inline void futex_wake(atomic_int* word, int count) {
+    syscall(SYS_futex, (int*)word, FUTEX_WAKE | futex_private_flag, count, NULL, NULL, 0);
+}
+
+// Latency from a chopstick being released to a blocked waiter taking it
+typedef struct {
+    long long count;
+    long long total_ns;
+    long long max_ns;
+} HandoffStats;
+
+static inline void handoff_stats_record(HandoffStats* stats, long long latency_ns) {
+    if (latency_ns < 0) {
+        latency_ns = 0;
+    }
+    stats->count++;
+    stats->total_ns += latency_ns;
+    if (latency_ns > stats->max_ns) {
+        stats->max_ns = latency_ns;
+    }
+}
+
+static inline void handoff_stats_merge(HandoffStats* into, const HandoffStats* from) {
+    into->count += from->count;
+    into->total_ns += from->total_ns;
+    if (from->max_ns > into->max_ns) {
+        into->max_ns = from->max_ns;
+    }
+}
+
+static inline void print_handoff_stats(const HandoffStats* stats, int blocking) {
+    printf("Acquisition handoffs (%s): %lld", blocking ? "futex" : "polling", stats->count);
+    if (stats->count > 0) {
+        printf(", mean %.1f us, max %.1f us",
+               (double)stats->total_ns / stats->count / 1000.0,
+               (double)stats->max_ns / 1000.0);
+    }
+    printf("\n");
+}
+
+#endif // FUTEX_HANDOFF_H
@@ -0,0 +1,138 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <stdio.h>
+#include <stdatomic.h>
+
+#define LATENCY_SUB_BUCKET_BITS 4
+#define LATENCY_SUB_BUCKETS (1 << LATENCY_SUB_BUCKET_BITS)
+#define LATENCY_MAX_EXPONENT 37  // Waits of 2^38 ns (~275 s) and more share the last bucket
+#define LATENCY_BUCKETS (LATENCY_SUB_BUCKETS * (LATENCY_MAX_EXPONENT - LATENCY_SUB_BUCKET_BITS + 2))
+
+// HDR-style log-linear histogram of waits in simulated ns: exact below 16 ns,
+// then 16 buckets per power of two, so every bucket is within 1/16 of its
+// values. One philosopher writes it and the status thread reads it while the
+// run goes on: the single writer bumps counters with relaxed load/store pairs
+// (no locked instructions), readers see each counter whole and merge copies.
+typedef struct {
+    atomic_uint counts[LATENCY_BUCKETS];
+    atomic_llong max_ns;
+    atomic_llong timeouts;  // Waits that ended in a timeout instead of eating
+} LatencyHistogram;
+
+static inline int latency_bucket(long long value_ns) {
+    if (value_ns < LATENCY_SUB_BUCKETS) {
+        return value_ns < 0 ? 0 : (int)value_ns;
+    }
+    int exponent = 63 - __builtin_clzll((unsigned long long)value_ns);
+    if (exponent > LATENCY_MAX_EXPONENT) {
+        return LATENCY_BUCKETS - 1;
+    }
+    int shift = exponent - LATENCY_SUB_BUCKET_BITS;
+    return LATENCY_SUB_BUCKETS * (shift + 1) + (int)(value_ns >> shift) - LATENCY_SUB_BUCKETS;
+}
+
+// Largest value that falls into the bucket
+static inline long long latency_bucket_limit(int bucket) {
+    if (bucket < LATENCY_SUB_BUCKETS) {
+        return bucket;
+    }
+    int group = bucket / LATENCY_SUB_BUCKETS;
+    long long sub_bucket = bucket % LATENCY_SUB_BUCKETS;
+    return ((LATENCY_SUB_BUCKETS + sub_bucket + 1) << (group - 1)) - 1;
+}
+
+// Owner thread only
+static inline void latency_record(LatencyHistogram* histogram, long long value_ns, int timed_out) {
+    if (value_ns < 0) {
+        value_ns = 0;
+    }
+    atomic_uint* counter = &histogram->counts[latency_bucket(value_ns)];
+    atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + 1, memory_order_relaxed);
+    if (value_ns > atomic_load_explicit(&histogram->max_ns, memory_order_relaxed)) {
+        atomic_store_explicit(&histogram->max_ns, value_ns, memory_order_relaxed);
+    }
+    if (timed_out) {
+        atomic_store_explicit(&histogram->timeouts,
+                              atomic_load_explicit(&histogram->timeouts, memory_order_relaxed) + 1,
+                              memory_order_relaxed);
+    }
+}
+
+// Add a live histogram into a private one. Safe while the owner records;
+// the copy may then miss the latest few waits.
+static inline void latency_merge(LatencyHistogram* into, LatencyHistogram* from) {
+    for (int bucket = 0; bucket < LATENCY_BUCKETS; bucket++) {
+        unsigned int count = atomic_load_explicit(&from->counts[bucket], memory_order_relaxed);
+        if (count != 0) {
+            atomic_store_explicit(&into->counts[bucket],
+                                  atomic_load_explicit(&into->counts[bucket], memory_order_relaxed) + count,
+                                  memory_order_relaxed);
+        }
+    }
+    long long max_ns = atomic_load_explicit(&from->max_ns, memory_order_relaxed);
+    if (max_ns > atomic_load_explicit(&into->max_ns, memory_order_relaxed)) {
+        atomic_store_explicit(&into->max_ns, max_ns, memory_order_relaxed);
+    }
+    atomic_store_explicit(&into->timeouts,
+                          atomic_load_explicit(&into->timeouts, memory_order_relaxed) +
+                              atomic_load_explicit(&from->timeouts, memory_order_relaxed),
+                          memory_order_relaxed);
+}
+
+static inline long long latency_count(LatencyHistogram* histogram) {
+    long long count = 0;
+    for (int bucket = 0; bucket < LATENCY_BUCKETS; bucket++) {
+        count += atomic_load_explicit(&histogram->counts[bucket], memory_order_relaxed);
+    }
+    return count;
+}
+
+// Value at quantile (0-1), reported as the upper edge of its bucket
+static inline long long latency_percentile(LatencyHistogram* histogram, double quantile) {
+    long long count = latency_count(histogram);
+    long long max_ns = atomic_load_explicit(&histogram->max_ns, memory_order_relaxed);
+    if (count == 0) {
+        return 0;
+    }
+    long long rank = (long long)(quantile * count + 0.999999);
+    if (rank < 1) {
+        rank = 1;
+    }
+    long long seen = 0;
+    for (int bucket = 0; bucket < LATENCY_BUCKETS; bucket++) {
+        seen += atomic_load_explicit(&histogram->counts[bucket], memory_order_relaxed);
+        if (seen >= rank) {
+            long long limit = latency_bucket_limit(bucket);
+            return limit < max_ns ? limit : max_ns;
+        }
+    }
+    return max_ns;
+}
+
+// Short human-readable duration for the status table, e.g. "840us" or "5.2s"
+static inline void latency_format(char* buffer, size_t size, long long value_ns) {
+    if (value_ns < 1000) {
+        snprintf(buffer, size, "%dns", (int)value_ns);
+    } else if (value_ns < 1000000) {
+        snprintf(buffer, size, "%dus", (int)(value_ns / 1000));
+    } else if (value_ns < 1000000000) {
+        snprintf(buffer, size, "%dms", (int)(value_ns / 1000000));
+    } else {
+        snprintf(buffer, size, "%.1fs", value_ns / 1e9);
+    }
+}
+
+// One status line summarising a histogram
+static inline void latency_print_summary(FILE* out, const char* label, LatencyHistogram* histogram) {
+    char p50[16], p99[16], p999[16], max[16];
+    latency_format(p50, sizeof(p50), latency_percentile(histogram, 0.5));
+    latency_format(p99, sizeof(p99), latency_percentile(histogram, 0.99));
+    latency_format(p999, sizeof(p999), latency_percentile(histogram, 0.999));
+    latency_format(max, sizeof(max), atomic_load_explicit(&histogram->max_ns, memory_order_relaxed));
+    fprintf(out, "%s: %lld waits (%lld timed out), p50 %s, p99 %s, p99.9 %s, max %s\n", label,
+            latency_count(histogram), atomic_load_explicit(&histogram->timeouts, memory_order_relaxed),
+            p50, p99, p999, max);
+}
+
+#endif // LATENCY_HISTOGRAM_H
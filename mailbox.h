@@ -0,0 +1,89 @@
+#ifndef MAILBOX_H
+#define MAILBOX_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+
+#include "philo_common.h"
+#include "futex_handoff.h"
+
+// Power of two. Each shared chopstick has one chopstick token and one
+// request token, so at most two messages cross an edge in one direction
+// before the receiver reads them.
+#define MAILBOX_SIZE 4
+
+typedef enum {
+    MESSAGE_REQUEST,    // Request token: the sender wants the chopstick
+    MESSAGE_CHOPSTICK,  // Chopstick token, always sent clean
+} MessageType;
+
+typedef struct {
+    int type;
+    long long sent_ns;  // monotonic_ns() at send, for handoff latency
+} Message;
+
+// Single-producer single-consumer ring from one neighbour to its owner
+typedef struct {
+    _Alignas(CACHE_LINE_SIZE) atomic_uint head;  // Next slot the neighbour writes
+    _Alignas(CACHE_LINE_SIZE) atomic_uint tail;  // Next slot the owner reads
+    Message messages[MAILBOX_SIZE];
+} Mailbox;
+
+// Lets a blocked owner sleep until either neighbour sends something
+typedef struct {
+    _Alignas(CACHE_LINE_SIZE) atomic_int rings;  // Bumped by every send
+    atomic_int sleeping;                         // Owner is (about to be) in futex_wait()
+} Doorbell;
+
+static inline void mailbox_send(Mailbox* mailbox, Doorbell* doorbell, int type) {
+    unsigned int head = atomic_load_explicit(&mailbox->head, memory_order_relaxed);
+    unsigned int tail = atomic_load_explicit(&mailbox->tail, memory_order_acquire);
+    if (head - tail == MAILBOX_SIZE) {
+        // Only possible if a token was duplicated, which is a protocol bug
+        fprintf(stderr, "Mailbox overflow: more tokens in flight than the protocol allows\n");
+        abort();
+    }
+    Message* message = &mailbox->messages[head & (MAILBOX_SIZE - 1)];
+    message->type = type;
+    message->sent_ns = monotonic_ns();
+    atomic_store_explicit(&mailbox->head, head + 1, memory_order_release);
+
+    atomic_fetch_add(&doorbell->rings, 1);
+    if (atomic_load(&doorbell->sleeping)) {
+        futex_wake(&doorbell->rings, 1);
+    }
+}
+
+static inline int mailbox_receive(Mailbox* mailbox, Message* message) {
+    unsigned int tail = atomic_load_explicit(&mailbox->tail, memory_order_relaxed);
+    if (tail == atomic_load_explicit(&mailbox->head, memory_order_acquire)) {
+        return 0;
+    }
+    *message = mailbox->messages[tail & (MAILBOX_SIZE - 1)];
+    atomic_store_explicit(&mailbox->tail, tail + 1, memory_order_release);
+    return 1;
+}
+
+static inline int mailbox_empty(Mailbox* mailbox) {
+    return atomic_load_explicit(&mailbox->tail, memory_order_relaxed) ==
+           atomic_load_explicit(&mailbox->head, memory_order_acquire);
+}
+
+// Owner only: sleep until a message arrives in any of the mailboxes or
+// timeout_ns (real time) passes
+static inline void doorbell_wait(Doorbell* doorbell, Mailbox* mailboxes, int num_mailboxes, long long timeout_ns) {
+    atomic_store(&doorbell->sleeping, 1);
+    int rings = atomic_load(&doorbell->rings);
+    int empty = 1;
+    for (int i = 0; i < num_mailboxes; i++) {
+        empty = empty && mailbox_empty(&mailboxes[i]);
+    }
+    // A send after the load above changes rings, so futex_wait() returns at once
+    if (empty) {
+        futex_wait(&doorbell->rings, rings, timeout_ns);
+    }
+    atomic_store(&doorbell->sleeping, 0);
+}
+
+#endif // MAILBOX_H
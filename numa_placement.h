@@ -0,0 +1,217 @@
+#ifndef NUMA_PLACEMENT_H
+#define NUMA_PLACEMENT_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include "philo_common.h"
+
+// NUMA placement for -N. Neighbours on the ring share chopsticks, so the
+// ring is cut into one contiguous segment per node: each segment's slice of
+// the per-philosopher arrays is bound to that node's memory and the threads
+// stepping it run on that node's CPUs. Only the two chopsticks at each
+// segment boundary are shared across nodes.
+//
+// Nodes come from /sys/devices/system/node, memory policy is set with the
+// raw mbind() system call, so there is no libnuma dependency. Without sysfs
+// node information everything is one node and -N only pins threads.
+
+#define NUMA_MAX_NODES 64      // Nodes with CPUs that get a segment
+#define NUMA_MAX_NODE_ID 1024  // Node numbers scanned in sysfs and bits in an mbind() mask
+#define NUMA_MPOL_BIND 2  // MPOL_BIND from <linux/mempolicy.h>
+
+typedef struct {
+    int enabled;
+    int num_nodes;  // Nodes with CPUs; memory-only nodes get no segment
+    int node_ids[NUMA_MAX_NODES];
+    cpu_set_t node_cpus[NUMA_MAX_NODES];
+    int num_philosophers;
+    int bind_failed;  // mbind() refused (no NUMA support, or not permitted)
+} NumaPlacement;
+
+static NumaPlacement numa_placement;
+
+// Parse a sysfs cpulist such as "0-3,8-11" into a CPU set
+static inline int numa_parse_cpulist(const char* list, cpu_set_t* set) {
+    CPU_ZERO(set);
+    int count = 0;
+    while (*list != '\0' && *list != '\n') {
+        char* end;
+        long first = strtol(list, &end, 10);
+        long last = first;
+        if (end == list) {
+            break;
+        }
+        if (*end == '-') {
+            list = end + 1;
+            last = strtol(list, &end, 10);
+        }
+        for (long cpu = first; cpu <= last && cpu < CPU_SETSIZE; cpu++) {
+            CPU_SET(cpu, set);
+            count++;
+        }
+        list = *end == ',' ? end + 1 : end;
+    }
+    return count;
+}
+
+static inline void numa_placement_init(int num_philosophers, int enabled) {
+    NumaPlacement* placement = &numa_placement;
+    placement->enabled = enabled;
+    placement->num_nodes = 0;
+    placement->num_philosophers = num_philosophers;
+    placement->bind_failed = 0;
+    if (!enabled) {
+        return;
+    }
+
+    for (int node = 0; node < NUMA_MAX_NODE_ID && placement->num_nodes < NUMA_MAX_NODES; node++) {
+        char path[64];
+        char list[4096];
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+        FILE* file = fopen(path, "r");
+        if (file == NULL) {
+            continue;
+        }
+        int read = fgets(list, sizeof(list), file) != NULL;
+        fclose(file);
+        if (read && numa_parse_cpulist(list, &placement->node_cpus[placement->num_nodes]) > 0) {
+            placement->node_ids[placement->num_nodes++] = node;
+        }
+    }
+    if (placement->num_nodes == 0) {
+        placement->node_ids[0] = 0;
+        sched_getaffinity(0, sizeof(cpu_set_t), &placement->node_cpus[0]);
+        placement->num_nodes = 1;
+    }
+    // Every node needs at least one philosopher
+    if (placement->num_nodes > num_philosophers) {
+        placement->num_nodes = num_philosophers;
+    }
+}
+
+// Segment k covers philosophers [numa_segment_start(k), numa_segment_start(k + 1))
+static inline int numa_segment_start(int node) {
+    return (int)((long long)node * numa_placement.num_philosophers / numa_placement.num_nodes);
+}
+
+static inline int numa_node_of(int philosopher) {
+    if (!numa_placement.enabled) {
+        return 0;
+    }
+    // Largest node whose segment starts at or before the philosopher
+    return (int)(((long long)(philosopher + 1) * numa_placement.num_nodes - 1) / numa_placement.num_philosophers);
+}
+
+// Zeroed array of count elements, indexed by philosopher, with each node's
+// segment in that node's memory. Elements are declared with
+// _Alignas(CACHE_LINE_SIZE) as for alloc_cache_aligned(). A page that
+// straddles a segment boundary stays with the earlier segment.
+static inline void* numa_alloc_ring(size_t count, size_t element_size) {
+    if (!numa_placement.enabled) {
+        return alloc_cache_aligned(count, element_size);
+    }
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t bytes = (count * element_size + page - 1) / page * page;
+    char* memory = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        perror("mmap");
+        exit(1);
+    }
+
+    // Bind before anything touches the pages, so first touch lands on the node
+    for (int node = 0; node < numa_placement.num_nodes && numa_placement.num_nodes > 1; node++) {
+        size_t first = (numa_segment_start(node) * element_size + page - 1) / page * page;
+        size_t last = node + 1 == numa_placement.num_nodes
+                          ? bytes
+                          : (numa_segment_start(node + 1) * element_size + page - 1) / page * page;
+        if (last <= first) {
+            continue;
+        }
+        unsigned long mask[NUMA_MAX_NODE_ID / (8 * sizeof(unsigned long))] = {0};
+        int id = numa_placement.node_ids[node];
+        mask[id / (8 * sizeof(unsigned long))] |= 1UL << (id % (8 * sizeof(unsigned long)));
+        if (syscall(SYS_mbind, memory + first, last - first, NUMA_MPOL_BIND, mask,
+                    sizeof(mask) * 8, 0) != 0 && !numa_placement.bind_failed) {
+            numa_placement.bind_failed = 1;
+            fprintf(stderr, "NUMA: mbind failed (%s); memory stays where the kernel puts it\n", strerror(errno));
+        }
+    }
+    memset(memory, 0, count * element_size);
+    return memory;
+}
+
+static inline void numa_free_ring(void* memory, size_t count, size_t element_size) {
+    if (!numa_placement.enabled) {
+        free(memory);
+        return;
+    }
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    munmap(memory, (count * element_size + page - 1) / page * page);
+}
+
+// Thread per philosopher: let the scheduler move it only within its node
+static inline void numa_set_thread_attr(pthread_attr_t* attr, int philosopher) {
+    if (numa_placement.enabled) {
+        pthread_attr_setaffinity_np(attr, sizeof(cpu_set_t), &numa_placement.node_cpus[numa_node_of(philosopher)]);
+    }
+}
+
+// Pool workers step contiguous blocks of philosophers; worker w's block
+// starts at philosopher w * N / W and the worker lives on that node
+static inline int numa_worker_first_task(int worker, int num_workers) {
+    return (int)((long long)worker * numa_placement.num_philosophers / num_workers);
+}
+
+// Worker whose block holds the task
+static inline int numa_task_worker(int task, int num_workers) {
+    return (int)(((long long)(task + 1) * num_workers - 1) / numa_placement.num_philosophers);
+}
+
+static inline int numa_worker_node(int worker, int num_workers) {
+    return numa_node_of(numa_worker_first_task(worker, num_workers));
+}
+
+// Pin the calling worker to its node, or with one_cpu to a single CPU of
+// the node picked round robin among the node's workers
+static inline void numa_pin_worker(int worker, int num_workers, int one_cpu) {
+    int node = numa_worker_node(worker, num_workers);
+    cpu_set_t set = numa_placement.node_cpus[node];
+    if (one_cpu) {
+        int first_worker = worker;
+        while (first_worker > 0 && numa_worker_node(first_worker - 1, num_workers) == node) {
+            first_worker--;
+        }
+        int slot = (worker - first_worker) % CPU_COUNT(&set);
+        CPU_ZERO(&set);
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if (CPU_ISSET(cpu, &numa_placement.node_cpus[node]) && slot-- == 0) {
+                CPU_SET(cpu, &set);
+                break;
+            }
+        }
+    }
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+static inline void numa_print_placement(void) {
+    if (!numa_placement.enabled) {
+        return;
+    }
+    printf("NUMA placement: %d node%s", numa_placement.num_nodes, numa_placement.num_nodes == 1 ? "" : "s");
+    for (int node = 0; node < numa_placement.num_nodes && node < 8; node++) {
+        int end = node + 1 == numa_placement.num_nodes ? numa_placement.num_philosophers : numa_segment_start(node + 1);
+        printf("%s node %d: P%d-P%d (%d CPUs)", node == 0 ? "," : ";", numa_placement.node_ids[node],
+               numa_segment_start(node), end - 1, CPU_COUNT(&numa_placement.node_cpus[node]));
+    }
+    printf("%s\n", numa_placement.num_nodes > 8 ? "; ..." : "");
+}
+
+#endif // NUMA_PLACEMENT_H
@@ -0,0 +1,230 @@
+#ifndef PHILO_COMMON_H
+#define PHILO_COMMON_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+
+#define DEFAULT_NUM_PHILOSOPHERS 5
+#define MAX_NUM_PHILOSOPHERS 100000
+#define CACHE_LINE_SIZE 64
+#define PHILOSOPHER_STACK_SIZE (256 * 1024)  // Thousands of threads must fit in memory
+#define STATUS_DISPLAY_LIMIT 16              // Columns/rows shown by print_status
+
+// Where a philosopher's execute_task() resumes. Each phase ends where the
+// thread-per-philosopher loop used to sleep, so the same state machine can
+// run on its own thread, on a worker pool or in the discrete-event engine.
+typedef enum {
+    PHASE_DISPATCH,  // Top of execute_task()
+    PHASE_THOUGHT,   // think() finished sleeping
+    PHASE_ATE,       // eat() finished sleeping
+    PHASE_WAITING,   // Next pass of the wait() retry loop
+} TaskPhase;
+
+// Command line options shared by all simulation variants
+typedef struct {
+    int num_philosophers;
+    int blocking;          // Block on futexes instead of polling with usleep()
+    int duration_seconds;  // Stop after this many seconds (0: run until Ctrl+C)
+    int acquire_pairs;     // Claim both chopsticks in one atomic step
+    const char* log_path;  // Memory-mapped event log file (NULL: stdout)
+    double time_scale;     // Simulated seconds per real second
+    int virtual_time;      // Discrete-event clock that skips idle time
+    int workers;           // Pool threads running the philosophers (0: one thread each)
+    int work_stealing;     // Workers steal runnable philosophers from each other
+    long long meal_target;     // Stop after this many meals in total (0: no limit)
+    const char* results_path;  // Append benchmark results here (NULL: print only)
+    int break_deadlocks;       // Deadlock monitor forces a release when it finds a cycle
+    double aging_seconds;      // Hunger before neighbours start yielding (0: no aging)
+    const char* arbitration;   // Arbitration policy name (NULL: the program's own rules)
+    int numa;                  // Place ring segments and their threads on NUMA nodes
+    const char* topology;      // Resource graph spec (NULL: the ring)
+    unsigned long long seed;   // Random seed (default: the current time)
+    const char* distributions; // Think/eat duration distributions (NULL: uniform)
+    const char* schedule;      // record:FILE or replay:FILE (NULL: neither)
+    const char* trace_path;    // Binary state trace for trace_analyze (NULL: none)
+    int processes;             // One forked process per philosopher, sharing memory
+} PhiloOptions;
+
+static inline void print_usage(const char* program) {
+    fprintf(stderr, "Usage: %s [-n num_philosophers] [-b] [-d seconds] [-a single|pair] [-l log_file] [-s scale] [-V] [-w|-W workers]\n"
+                    "       [-m meals] [-o results.csv|results.json] [-R] [-A seconds] [-P policy] [-N] [-T topology]\n"
+                    "       [-r seed] [-D distribution] [-S record|replay:file] [-t trace_file] [-F]\n", program);
+    fprintf(stderr, "  -n <count>   number of philosophers (2-%d, default %d)\n",
+            MAX_NUM_PHILOSOPHERS, DEFAULT_NUM_PHILOSOPHERS);
+    fprintf(stderr, "  -b           block waiters on a futex instead of polling every 50 ms\n");
+    fprintf(stderr, "  -d <seconds> stop the simulation after the given time\n");
+    fprintf(stderr, "  -a <mode>    chopstick acquisition: single (right then left, default)\n");
+    fprintf(stderr, "               or pair (both at once, no partial holds)\n");
+    fprintf(stderr, "  -l <file>    write the event log to a memory-mapped file instead of stdout\n");
+    fprintf(stderr, "  -s <scale>   run simulated time this many times faster than real time\n");
+    fprintf(stderr, "  -V           virtual time: jump over idle periods (implies polling)\n");
+    fprintf(stderr, "  -w <count>   run philosophers as tasks on this many worker threads\n");
+    fprintf(stderr, "               (0: one per CPU; default: one thread per philosopher)\n");
+    fprintf(stderr, "  -W <count>   like -w, with pinned work-stealing workers and timer wheels\n");
+    fprintf(stderr, "  -m <meals>   stop once the philosophers have eaten this many meals in total\n");
+    fprintf(stderr, "  -o <file>    append benchmark results as CSV, or JSON lines for .json/.jsonl\n");
+    fprintf(stderr, "  -R           break detected deadlocks by making one philosopher in the cycle\n");
+    fprintf(stderr, "               release its chopstick (project_with_deadlock only)\n");
+    fprintf(stderr, "  -A <seconds> age philosophers that have not eaten for this long so their\n");
+    fprintf(stderr, "               neighbours yield to them (project_with_starvation only)\n");
+    fprintf(stderr, "  -P <policy>  arbitration policy: fairness (default), hierarchy, waiter, ticket,\n");
+    fprintf(stderr, "               chandy-misra or backoff (project_with_frame only)\n");
+    fprintf(stderr, "  -N           split the ring into one segment per NUMA node, keep each segment's\n");
+    fprintf(stderr, "               memory on its node and pin the threads that run it there\n");
+    fprintf(stderr, "  -T <spec>    who shares which chopsticks: ring (default), grid:RxC, torus:RxC,\n");
+    fprintf(stderr, "               regular:K[:seed] or file:path (project_with_frame only)\n");
+    fprintf(stderr, "  -r <seed>    seed the per-thread random generators (default: the current time)\n");
+    fprintf(stderr, "  -D <dist>    think/eat durations: uniform (default), exponential or bimodal,\n");
+    fprintf(stderr, "               one for both or <think>:<eat>\n");
+    fprintf(stderr, "  -S <mode:file> record:FILE logs the schedule, replay:FILE reruns it step by step\n");
+    fprintf(stderr, "               and reports the first divergence (project_with_starvation only)\n");
+    fprintf(stderr, "  -t <file>    write a binary trace of states and chopsticks for trace_analyze\n");
+    fprintf(stderr, "               (project_1_c, project_with_deadlock, project_with_starvation)\n");
+    fprintf(stderr, "  -F           run every philosopher as a forked process, with the chopsticks and\n");
+    fprintf(stderr, "               state table in POSIX shared memory (project_with_frame only)\n");
+}
+
+static inline void parse_options(int argc, char* argv[], PhiloOptions* options) {
+    options->num_philosophers = DEFAULT_NUM_PHILOSOPHERS;
+    options->blocking = 0;
+    options->duration_seconds = 0;
+    options->acquire_pairs = 0;
+    options->log_path = NULL;
+    options->time_scale = 1.0;
+    options->virtual_time = 0;
+    options->workers = 0;
+    options->work_stealing = 0;
+    options->meal_target = 0;
+    options->results_path = NULL;
+    options->break_deadlocks = 0;
+    options->aging_seconds = 0;
+    options->arbitration = NULL;
+    options->numa = 0;
+    options->topology = NULL;
+    options->seed = (unsigned long long)time(NULL);
+    options->distributions = NULL;
+    options->schedule = NULL;
+    options->trace_path = NULL;
+    options->processes = 0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:bd:a:l:s:Vw:W:m:o:RA:P:NT:r:D:S:t:Fh")) != -1) {
+        switch (opt) {
+            case 'n':
+                options->num_philosophers = atoi(optarg);
+                break;
+            case 'b':
+                options->blocking = 1;
+                break;
+            case 'd':
+                options->duration_seconds = atoi(optarg);
+                break;
+            case 'a':
+                if (strcmp(optarg, "pair") == 0) {
+                    options->acquire_pairs = 1;
+                } else if (strcmp(optarg, "single") != 0) {
+                    fprintf(stderr, "Unknown acquisition mode: %s\n", optarg);
+                    exit(1);
+                }
+                break;
+            case 'l':
+                options->log_path = optarg;
+                break;
+            case 's':
+                options->time_scale = atof(optarg);
+                if (options->time_scale <= 0) {
+                    fprintf(stderr, "Time scale must be positive\n");
+                    exit(1);
+                }
+                break;
+            case 'V':
+                options->virtual_time = 1;
+                break;
+            case 'w':
+            case 'W':
+                options->work_stealing = opt == 'W';
+                options->workers = atoi(optarg);
+                if (options->workers <= 0) {
+                    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+                    options->workers = cpus > 0 ? (int)cpus : 1;
+                }
+                break;
+            case 'm':
+                options->meal_target = atoll(optarg);
+                break;
+            case 'o':
+                options->results_path = optarg;
+                break;
+            case 'R':
+                options->break_deadlocks = 1;
+                break;
+            case 'A':
+                options->aging_seconds = atof(optarg);
+                if (options->aging_seconds < 0) {
+                    fprintf(stderr, "Aging threshold must not be negative\n");
+                    exit(1);
+                }
+                break;
+            case 'P':
+                options->arbitration = optarg;
+                break;
+            case 'N':
+                options->numa = 1;
+                break;
+            case 'T':
+                options->topology = optarg;
+                break;
+            case 'r':
+                options->seed = strtoull(optarg, NULL, 10);
+                break;
+            case 'D':
+                options->distributions = optarg;
+                break;
+            case 'S':
+                options->schedule = optarg;
+                break;
+            case 't':
+                options->trace_path = optarg;
+                break;
+            case 'F':
+                options->processes = 1;
+                break;
+            case 'h':
+            default:
+                print_usage(argv[0]);
+                exit(opt == 'h' ? 0 : 1);
+        }
+    }
+
+    if (options->num_philosophers < 2 || options->num_philosophers > MAX_NUM_PHILOSOPHERS) {
+        fprintf(stderr, "Number of philosophers must be between 2 and %d\n", MAX_NUM_PHILOSOPHERS);
+        exit(1);
+    }
+}
+
+// Allocate a zeroed array whose elements start on their own cache line.
+// Element types are declared with _Alignas(CACHE_LINE_SIZE) so sizeof() is
+// already a multiple of the line size and neighbours never share a line.
+static inline void* alloc_cache_aligned(size_t count, size_t element_size) {
+    size_t bytes = count * element_size;
+    bytes = (bytes + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+    void* memory = aligned_alloc(CACHE_LINE_SIZE, bytes);
+    if (memory == NULL) {
+        perror("aligned_alloc");
+        exit(1);
+    }
+    memset(memory, 0, bytes);
+    return memory;
+}
+
+// Small stacks so one thread per philosopher scales to thousands of threads
+static inline void init_philosopher_thread_attr(pthread_attr_t* attr) {
+    pthread_attr_init(attr);
+    pthread_attr_setstacksize(attr, PHILOSOPHER_STACK_SIZE);
+}
+
+#endif // PHILO_COMMON_H
@@ -0,0 +1,214 @@
+#ifndef PHILO_RANDOM_H
+#define PHILO_RANDOM_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#include "philo_common.h"
+#include "futex_handoff.h"
+
+// Random numbers for think/eat durations and tie-breaking. rand() keeps one
+// global state behind a lock that every philosopher thread contends on, so
+// each thread gets its own xoshiro256** generator instead, seeded on first
+// use from the run seed and a per-thread stream number through splitmix64.
+// A single-threaded program (des_simulator.c) thus gets one stream and is
+// fully determined by its seed.
+//
+// Durations follow one of three distributions, all with the same mean as
+// the historical uniform one so runs stay comparable:
+//   uniform      whole seconds in [min, max], as get_random() always gave
+//   exponential  memoryless, mean (min + max) / 2
+//   bimodal      min or max seconds with equal odds
+
+typedef enum {
+    DURATION_UNIFORM,
+    DURATION_EXPONENTIAL,
+    DURATION_BIMODAL,
+} DurationDistribution;
+
+static const char* const duration_distribution_names[] = {
+    [DURATION_UNIFORM] = "uniform",
+    [DURATION_EXPONENTIAL] = "exponential",
+    [DURATION_BIMODAL] = "bimodal",
+};
+
+typedef struct {
+    uint64_t seed;
+    atomic_uint next_stream;  // Handed to threads as they draw their first number
+    DurationDistribution think;
+    DurationDistribution eat;
+} RandomConfig;
+
+typedef struct {
+    uint64_t s[4];
+    int seeded;
+} RandomState;
+
+// Stream for one-off draws outside the philosopher threads, such as
+// building a random topology; threads are numbered from 0 and never get it
+#define RANDOM_SETUP_STREAM 0xffffffffu
+
+static RandomConfig random_config = {.seed = 1};
+static _Thread_local RandomState thread_random;
+
+static inline uint64_t splitmix64(uint64_t* x) {
+    uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+static inline uint64_t rotl64(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+static inline void random_state_seed(RandomState* state, uint64_t seed, uint32_t stream) {
+    uint64_t x = seed ^ ((uint64_t)stream << 32);
+    for (int i = 0; i < 4; i++) {
+        state->s[i] = splitmix64(&x);
+    }
+    state->seeded = 1;
+}
+
+static inline uint64_t random_state_next64(RandomState* state) {
+    uint64_t* s = state->s;
+    uint64_t result = rotl64(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl64(s[3], 45);
+    return result;
+}
+
+// The calling thread's generator, seeded on first use
+static inline RandomState* random_thread_state(void) {
+    RandomState* state = &thread_random;
+    if (!state->seeded) {
+        random_state_seed(state, random_config.seed, atomic_fetch_add(&random_config.next_stream, 1));
+    }
+    return state;
+}
+
+static inline uint64_t random_next64(void) {
+    return random_state_next64(random_thread_state());
+}
+
+// A forked process starts with a copy of its parent's stream counter, so
+// siblings would all draw the same numbers. Give each its own stream;
+// the calling thread seeds from it on its next draw.
+static inline void random_fork_stream(unsigned int stream) {
+    atomic_store(&random_config.next_stream, stream);
+    thread_random.seeded = 0;
+}
+
+static inline uint32_t random_next32(void) {
+    return (uint32_t)(random_next64() >> 32);
+}
+
+// Uniform in [0, bound) without the bias of %: multiply into 64 bits and
+// reject the few low halves that would favour small results (Lemire)
+static inline uint32_t random_state_below(RandomState* state, uint32_t bound) {
+    uint64_t product = (random_state_next64(state) >> 32) * bound;
+    uint32_t low = (uint32_t)product;
+    if (low < bound) {
+        uint32_t threshold = -bound % bound;
+        while (low < threshold) {
+            product = (random_state_next64(state) >> 32) * bound;
+            low = (uint32_t)product;
+        }
+    }
+    return (uint32_t)(product >> 32);
+}
+
+static inline uint32_t random_below(uint32_t bound) {
+    return random_state_below(random_thread_state(), bound);
+}
+
+// Uniform in (0, 1]
+static inline double random_unit(void) {
+    return ((random_next64() >> 11) + 1) * 0x1.0p-53;
+}
+
+// Natural logarithm of x > 0, here so the programs need no -lm: split off
+// the binary exponent, then ln(m) = 2 atanh((m - 1) / (m + 1)) for m in [1, 2)
+static inline double random_log(double x) {
+    uint64_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    int exponent = (int)((bits >> 52) & 0x7ff) - 1023;
+    bits = (bits & 0x000fffffffffffffULL) | 0x3ff0000000000000ULL;
+    double m;
+    memcpy(&m, &bits, sizeof(m));
+    double z = (m - 1) / (m + 1);
+    double z2 = z * z;
+    double term = z;
+    double sum = 0;
+    for (int k = 1; k < 40; k += 2) {
+        sum += term / k;
+        term *= z2;
+    }
+    return 2 * sum + exponent * 0.69314718055994530942;
+}
+
+static inline long long random_duration_ns(DurationDistribution distribution, int min_seconds, int max_seconds) {
+    switch (distribution) {
+        case DURATION_EXPONENTIAL:
+            return (long long)(-random_log(random_unit()) * (min_seconds + max_seconds) / 2 * NS_PER_SEC);
+        case DURATION_BIMODAL:
+            return (random_next64() >> 63 ? max_seconds : min_seconds) * NS_PER_SEC;
+        case DURATION_UNIFORM:
+        default:
+            return (min_seconds + (long long)random_below(max_seconds - min_seconds + 1)) * NS_PER_SEC;
+    }
+}
+
+static inline long long random_think_ns(int min_seconds, int max_seconds) {
+    return random_duration_ns(random_config.think, min_seconds, max_seconds);
+}
+
+static inline long long random_eat_ns(int min_seconds, int max_seconds) {
+    return random_duration_ns(random_config.eat, min_seconds, max_seconds);
+}
+
+static inline int parse_duration_distribution(const char* name, size_t length, DurationDistribution* distribution) {
+    for (int i = 0; i < (int)(sizeof(duration_distribution_names) / sizeof(duration_distribution_names[0])); i++) {
+        if (strlen(duration_distribution_names[i]) == length &&
+            strncmp(duration_distribution_names[i], name, length) == 0) {
+            *distribution = (DurationDistribution)i;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+// spec is "<think>[:<eat>]"; one name applies to both. NULL keeps uniform.
+static inline int random_init(uint64_t seed, const char* spec) {
+    random_config.seed = seed;
+    atomic_init(&random_config.next_stream, 0);
+    random_config.think = DURATION_UNIFORM;
+    random_config.eat = DURATION_UNIFORM;
+    if (spec == NULL) {
+        return 0;
+    }
+    const char* colon = strchr(spec, ':');
+    size_t think_length = colon != NULL ? (size_t)(colon - spec) : strlen(spec);
+    if (parse_duration_distribution(spec, think_length, &random_config.think) != 0 ||
+        parse_duration_distribution(colon != NULL ? colon + 1 : spec,
+                                    colon != NULL ? strlen(colon + 1) : think_length, &random_config.eat) != 0) {
+        fprintf(stderr, "Unknown duration distribution: %s (uniform, exponential or bimodal, "
+                        "as <both> or <think>:<eat>)\n", spec);
+        return -1;
+    }
+    return 0;
+}
+
+static inline void random_print_config(void) {
+    printf("Random seed: %llu, durations: think %s, eat %s\n", (unsigned long long)random_config.seed,
+           duration_distribution_names[random_config.think], duration_distribution_names[random_config.eat]);
+}
+
+#endif // PHILO_RANDOM_H
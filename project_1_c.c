@@ -1,3 +1,4 @@
+#define _GNU_SOURCE  // mremap() for the memory-mapped event log
 #include <stdio.h>
 #include <stdlib.h>
 #include <pthread.h>
@@ -6,34 +7,92 @@
 #include <stdatomic.h>
 #include <signal.h>
 
-#define NUM_PHILOSOPHERS 5
+#include "philo_common.h"
+#include "philo_random.h"
+#include "futex_handoff.h"
+#include "event_log.h"
+#include "sim_clock.h"
+#include "count_tracker.h"
+#include "status_snapshot.h"
+#include "numa_placement.h"
+#include "task_pool.h"
+#include "bench_report.h"
+#include "trace_log.h"
+
 #define MAX_WAIT_TIME 6
+#define MAX_WAIT_NS (MAX_WAIT_TIME * NS_PER_SEC)
 
 // Forward declarations
 void* philosopher_routine(void* arg);
 void* print_status(void* arg);
-void* execute_task(void* arg);
+long long execute_task(void* arg);
+
+// Event log records, formatted by the writer thread
+enum {
+    EVENT_EATING,
+    EVENT_THINKING,
+    EVENT_WAITING,
+    EVENT_WAITED_TOO_LONG,
+};
+
+static const char* const event_formats[] = {
+    [EVENT_EATING] = "Philosopher %d is eating.\n",
+    [EVENT_THINKING] = "Philosopher %d is thinking.\n",
+    [EVENT_WAITING] = "Philosopher %d is waiting.\n",
+    [EVENT_WAITED_TOO_LONG] = "Philosopher %d waited too long, going back to thinking.\n",
+};
 
 // Global variables
 atomic_int should_print = 0;
 atomic_int running = 1;  // Added for graceful shutdown
 
 typedef struct {
-    atomic_int state;  // 1: thinking, 2: waiting, 3: eating
+    _Alignas(CACHE_LINE_SIZE) atomic_int state;  // 1: thinking, 2: waiting, 3: eating
     int philosopher_id;
     atomic_int invoke_count;
     atomic_int must_think;
-    time_t wait_start;
-} Philosopher;
+    long long wait_start;  // Simulated ns
+    TaskPhase phase;       // Where execute_task() resumes
+    HandoffStats handoff;  // Neighbour-finished-to-eating latency, owner thread only
+    int observed_seq;      // eating_seq when the last attempt to eat failed, -1 if none
+    StatusSlot status;     // Published copy read by print_status()
+} Philosopher;  // Padded to a cache line so neighbours never share one
 
-Philosopher philosophers[NUM_PHILOSOPHERS];
-pthread_mutex_t print_mutex;
+int num_philosophers = DEFAULT_NUM_PHILOSOPHERS;
+Philosopher* philosophers;
+CountTracker meal_counts;  // Running minimum of invoke_count for get_lowest_count()
+EventLog event_log;  // Per-philosopher rings drained by one writer thread
+LatencyHistogram* wait_histograms;  // Wait-to-eat time per philosopher, owner thread only
+MealTarget meal_target;             // -m: total meals after which the run stops
 pthread_mutex_t state_mutex;
+int blocking_mode = 0;
+
+// Bumped whenever a philosopher stops eating; blocked waiters sleep on it.
+// The manager keeps at most two philosophers waiting, so waking all is cheap.
+atomic_int eating_seq = 0;
+atomic_int eating_seq_waiters = 0;
+_Atomic long long last_release_ns = 0;
+
+// Manager bookkeeping, all guarded by state_mutex. Thinkers sit in a min-heap
+// keyed by (invoke count, random tie-break) so the lowest-count eligible
+// philosopher is always at the top and a promotion costs O(log N).
+typedef struct {
+    unsigned long long* keys;
+    int* ids;
+    int size;
+} ThinkerHeap;
+
+ThinkerHeap thinkers;
+int waiting_count = 0;
+long long slot_freed_ns = 0;  // When waiting_count last dropped; the trace reports promotion delays from it
+pthread_cond_t manager_cond = PTHREAD_COND_INITIALIZER;
+int manager_idle = 0;  // Manager is parked on manager_cond and off the simulation clock
 
 // Signal handler
 void handle_signal(int sig) {
     if (sig == SIGINT) {
         atomic_store(&running, 0);
+        clock_interrupt_from_signal();
     }
 }
 
@@ -47,12 +106,12 @@ int get_random(int min, int max) {
         low_num = max + 1;
         hi_num = min;
     }
-    result = (rand() % (hi_num - low_num)) + low_num;
+    result = (int)random_below(hi_num - low_num) + low_num;
     return result;
 }
 
 int is_anyone_eating() {
-    for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
+    for (int i = 0; i < num_philosophers; i++) {
         if (atomic_load(&philosophers[i].state) == 3) {
             return 1;
         }
@@ -61,41 +120,160 @@ int is_anyone_eating() {
 }
 
 int get_lowest_count() {
+    int tracked = count_tracker_lowest(&meal_counts);
+    if (tracked >= 0) {
+        return tracked;
+    }
+
+    // Counts spread past the tracker window; fall back to a full scan
     int lowest = atomic_load(&philosophers[0].invoke_count);
-    for (int i = 1; i < NUM_PHILOSOPHERS; i++) {
+    for (int i = 1; i < num_philosophers; i++) {
         int current = atomic_load(&philosophers[i].invoke_count);
         if (current < lowest) {
             lowest = current;
         }
     }
+    count_tracker_raise_floor(&meal_counts, lowest);
     return lowest;
 }
 
-// Philosopher actions
-void eat(Philosopher* philosopher) {
-    pthread_mutex_lock(&print_mutex);
-    printf("Philosopher %d is eating.\n", philosopher->philosopher_id);
-    pthread_mutex_unlock(&print_mutex);
-    
-    sleep(get_random(1, 4));  // 1-4 seconds
+void thinker_heap_push(int philosopher_id) {
+    unsigned long long key = ((unsigned long long)atomic_load(&philosophers[philosopher_id].invoke_count) << 32) |
+                             random_next32();
+    int i = thinkers.size++;
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (thinkers.keys[parent] <= key) {
+            break;
+        }
+        thinkers.keys[i] = thinkers.keys[parent];
+        thinkers.ids[i] = thinkers.ids[parent];
+        i = parent;
+    }
+    thinkers.keys[i] = key;
+    thinkers.ids[i] = philosopher_id;
+}
+
+int thinker_heap_pop() {
+    int top = thinkers.ids[0];
+    unsigned long long key = thinkers.keys[--thinkers.size];
+    int id = thinkers.ids[thinkers.size];
+    int i = 0;
+    while (2 * i + 1 < thinkers.size) {
+        int child = 2 * i + 1;
+        if (child + 1 < thinkers.size && thinkers.keys[child + 1] < thinkers.keys[child]) {
+            child++;
+        }
+        if (key <= thinkers.keys[child]) {
+            break;
+        }
+        thinkers.keys[i] = thinkers.keys[child];
+        thinkers.ids[i] = thinkers.ids[child];
+        i = child;
+    }
+    thinkers.keys[i] = key;
+    thinkers.ids[i] = id;
+    return top;
+}
+
+int thinker_heap_top_count() {
+    return (int)(thinkers.keys[0] >> 32);
+}
+
+// Publish this philosopher's status row; called by its own thread after
+// every step and by the manager when it promotes a thinker
+void publish_status(Philosopher* philosopher) {
+    StatusRecord record = {
+        .state = atomic_load(&philosopher->state),
+        .invoke_count = atomic_load(&philosopher->invoke_count),
+        .must_think = atomic_load(&philosopher->must_think),
+        .held = 0,
+    };
+    status_publish(&philosopher->status, &record);
+}
+
+// Wake the manager; in virtual time it must count as running again before
+// the caller's next sleep can let the clock advance past this event
+void signal_manager() {
+    if (manager_idle) {
+        manager_idle = 0;
+        clock_unblock_other();
+    }
+    pthread_cond_signal(&manager_cond);
+}
+
+// State transitions that the manager reacts to; callers hold state_mutex,
+// which also makes it safe for the manager to trace on a philosopher's behalf
+void set_state(Philosopher* philosopher, int state) {
+    atomic_store(&philosopher->state, state);
+    trace_event(philosopher->philosopher_id, TRACE_STATE, state);
+}
+
+void become_thinking(Philosopher* philosopher) {
+    if (atomic_load(&philosopher->state) == 2) {
+        waiting_count--;
+        slot_freed_ns = clock_now_ns();
+    }
+    set_state(philosopher, 1);
+    thinker_heap_push(philosopher->philosopher_id);
+    signal_manager();
+}
+
+void become_eating(Philosopher* philosopher) {
+    waiting_count--;
+    slot_freed_ns = clock_now_ns();
+    set_state(philosopher, 3);
+    signal_manager();
+}
+
+void become_waiting(Philosopher* philosopher) {
+    set_state(philosopher, 2);
+    philosopher->wait_start = clock_now_ns();
+    waiting_count++;
+    publish_status(philosopher);
+}
+
+void announce_finished_eating() {
+    atomic_store(&last_release_ns, monotonic_ns());
+    atomic_fetch_add(&eating_seq, 1);
+    if (atomic_load(&eating_seq_waiters) > 0) {
+        futex_wake(&eating_seq, INT_MAX);
+    }
+}
+
+// Philosopher actions. Each returns how long the philosopher now sleeps;
+// execute_task() resumes in the matching phase afterwards.
+long long eat(Philosopher* philosopher) {
+    log_event(&event_log, philosopher->philosopher_id, EVENT_EATING);
     
-    atomic_fetch_add(&philosopher->invoke_count, 1);
+    philosopher->phase = PHASE_ATE;
+    return random_eat_ns(1, 4);  // 1-4 seconds
+}
+
+void finish_eating(Philosopher* philosopher) {
+    int previous_count = atomic_fetch_add(&philosopher->invoke_count, 1);
+    count_tracker_increment(&meal_counts, previous_count);
     
+    pthread_mutex_lock(&state_mutex);
     int lowest = get_lowest_count();
     if (atomic_load(&philosopher->invoke_count) > (lowest + 1)) {
         atomic_store(&philosopher->must_think, 1);
     }
     
-    atomic_store(&philosopher->state, 1);
+    become_thinking(philosopher);
+    pthread_mutex_unlock(&state_mutex);
+    announce_finished_eating();
+    meal_target_count(&meal_target);
 }
 
-void think(Philosopher* philosopher) {
-    pthread_mutex_lock(&print_mutex);
-    printf("Philosopher %d is thinking.\n", philosopher->philosopher_id);
-    pthread_mutex_unlock(&print_mutex);
-    
-    sleep(get_random(1, 5));  // 1-5 seconds
+long long think(Philosopher* philosopher) {
+    log_event(&event_log, philosopher->philosopher_id, EVENT_THINKING);
     
+    philosopher->phase = PHASE_THOUGHT;
+    return random_think_ns(1, 5);  // 1-5 seconds
+}
+
+void finish_thinking(Philosopher* philosopher) {
     if (atomic_load(&philosopher->must_think)) {
         int lowest = get_lowest_count();
         if (atomic_load(&philosopher->invoke_count) <= (lowest + 1)) {
@@ -105,24 +283,25 @@ void think(Philosopher* philosopher) {
 }
 
 void wait(Philosopher* philosopher) {
-    time_t current_time = time(NULL);
-    if (current_time - philosopher->wait_start >= MAX_WAIT_TIME) {
-        pthread_mutex_lock(&print_mutex);
-        printf("Philosopher %d waited too long, going back to thinking.\n", 
-               philosopher->philosopher_id);
-        pthread_mutex_unlock(&print_mutex);
+    long long waited_ns = clock_now_ns() - philosopher->wait_start;
+    if (waited_ns >= MAX_WAIT_NS) {
+        log_event(&event_log, philosopher->philosopher_id, EVENT_WAITED_TOO_LONG);
+        latency_record(&wait_histograms[philosopher->philosopher_id], waited_ns, 1);
         
-        atomic_store(&philosopher->state, 1);
+        pthread_mutex_lock(&state_mutex);
+        trace_event(philosopher->philosopher_id, TRACE_TIMEOUT, 0);
+        become_thinking(philosopher);
+        pthread_mutex_unlock(&state_mutex);
+        philosopher->observed_seq = -1;
         return;
     }
     
-    pthread_mutex_lock(&print_mutex);
-    printf("Philosopher %d is waiting.\n", philosopher->philosopher_id);
-    pthread_mutex_unlock(&print_mutex);
+    log_event(&event_log, philosopher->philosopher_id, EVENT_WAITING);
     
-    int prev_id = (philosopher->philosopher_id - 1 + NUM_PHILOSOPHERS) % NUM_PHILOSOPHERS;
-    int next_id = (philosopher->philosopher_id + 1) % NUM_PHILOSOPHERS;
+    int prev_id = (philosopher->philosopher_id - 1 + num_philosophers) % num_philosophers;
+    int next_id = (philosopher->philosopher_id + 1) % num_philosophers;
     
+    int seq = atomic_load(&eating_seq);
     pthread_mutex_lock(&state_mutex);
     
     int prev_state = atomic_load(&philosophers[prev_id].state);
@@ -132,7 +311,7 @@ void wait(Philosopher* philosopher) {
     int my_count = atomic_load(&philosopher->invoke_count);
     
     int has_priority = (my_count == lowest) || 
-                      (current_time - philosopher->wait_start >= MAX_WAIT_TIME/2);
+                      (waited_ns >= MAX_WAIT_NS / 2);
     
     int can_eat = has_priority && 
                  prev_state != 3 && 
@@ -140,148 +319,270 @@ void wait(Philosopher* philosopher) {
                  (no_one_eating || atomic_load(&philosopher->must_think) == 0);
     
     if (can_eat) {
-        atomic_store(&philosopher->state, 3);
-    } else if (current_time - philosopher->wait_start >= MAX_WAIT_TIME) {
-        atomic_store(&philosopher->state, 1);
+        become_eating(philosopher);
+        latency_record(&wait_histograms[philosopher->philosopher_id], waited_ns, 0);
+        if (philosopher->observed_seq != -1 && philosopher->observed_seq != seq) {
+            handoff_stats_record(&philosopher->handoff, monotonic_ns() - atomic_load(&last_release_ns));
+        }
+        philosopher->observed_seq = -1;
+    } else if (waited_ns >= MAX_WAIT_NS) {
+        latency_record(&wait_histograms[philosopher->philosopher_id], waited_ns, 1);
+        trace_event(philosopher->philosopher_id, TRACE_TIMEOUT, 0);
+        become_thinking(philosopher);
+        philosopher->observed_seq = -1;
+    } else {
+        philosopher->observed_seq = seq;
     }
     
     pthread_mutex_unlock(&state_mutex);
+
+    if (blocking_mode && atomic_load(&philosopher->state) == 2) {
+        // Sleep until someone stops eating or the priority/timeout deadline passes
+        long long deadline_ns = waited_ns < MAX_WAIT_NS / 2 ? MAX_WAIT_NS / 2 : MAX_WAIT_NS;
+        long long timeout_ns = clock_real_timeout_ns(deadline_ns - waited_ns);
+        atomic_fetch_add(&eating_seq_waiters, 1);
+        futex_wait(&eating_seq, seq, timeout_ns < NS_PER_SEC ? timeout_ns : NS_PER_SEC);
+        atomic_fetch_sub(&eating_seq_waiters, 1);
+    }
 }
 
-void* execute_task(void* arg) {
+// Run the philosopher up to its next sleep and return that sleep in
+// simulated ns. The caller sleeps (its own thread, or a pool timer) and
+// calls again; phase records where to pick up.
+long long execute_task(void* arg) {
     Philosopher* philosopher = (Philosopher*)arg;
-    int current_state = atomic_load(&philosopher->state);
-    
-    if (atomic_load(&philosopher->must_think) && current_state != 2) {
-        think(philosopher);
-        return NULL;
-    }
     
-    if (current_state == 1) {
-        think(philosopher);
-    } else if (current_state == 2) {
-        wait(philosopher);
-    } else if (current_state == 3) {
-        eat(philosopher);
+    switch (philosopher->phase) {
+        case PHASE_THOUGHT:
+            finish_thinking(philosopher);
+            break;
+        case PHASE_ATE:
+            finish_eating(philosopher);
+            break;
+        case PHASE_WAITING:
+        case PHASE_DISPATCH: {
+            int current_state = atomic_load(&philosopher->state);
+            
+            if (atomic_load(&philosopher->must_think) && current_state != 2) {
+                return think(philosopher);
+            }
+            
+            if (current_state == 1) {
+                return think(philosopher);
+            } else if (current_state == 2) {
+                wait(philosopher);
+            } else if (current_state == 3) {
+                return eat(philosopher);
+            }
+            break;
+        }
     }
     
-    return NULL;
+    publish_status(philosopher);
+    philosopher->phase = PHASE_DISPATCH;
+    return blocking_mode ? 0 : 50 * NS_PER_MS;  // 50ms delay between tasks
 }
 
 void* philosopher_routine(void* arg) {
     Philosopher* philosopher = (Philosopher*)arg;
     while (atomic_load(&running)) {
-        execute_task(philosopher);
-        usleep(50000); // 50ms delay
+        clock_sleep_ns(execute_task(philosopher));
     }
+    clock_thread_exit();
     return NULL;
 }
 
 void* print_status(void* arg) {
     while (atomic_load(&running)) {
         sleep(1);
-        pthread_mutex_lock(&print_mutex);
-        for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
-            printf("Philosopher %d - State: %d, Invoke count: %d, Must think: %d\n", 
-                   i,  // Using i instead of philosopher_id to ensure order
-                   atomic_load(&philosophers[i].state),
-                   atomic_load(&philosophers[i].invoke_count),
-                   atomic_load(&philosophers[i].must_think));
+        int shown = num_philosophers < STATUS_DISPLAY_LIMIT ? num_philosophers : STATUS_DISPLAY_LIMIT;
+
+        // Copy the published rows, then render without holding any lock
+        StatusRecord snapshot[STATUS_DISPLAY_LIMIT];
+        for (int i = 0; i < shown; i++) {
+            status_read(&philosophers[i].status, &snapshot[i]);
+        }
+
+        char* frame = NULL;
+        size_t frame_size = 0;
+        FILE* out = open_memstream(&frame, &frame_size);
+        for (int i = 0; i < shown; i++) {
+            char p50[16], p99[16];
+            latency_format(p50, sizeof(p50), latency_percentile(&wait_histograms[i], 0.5));
+            latency_format(p99, sizeof(p99), latency_percentile(&wait_histograms[i], 0.99));
+            fprintf(out, "Philosopher %d - State: %d, Invoke count: %d, Must think: %d, Wait p50/p99: %s/%s\n", 
+                    i,  // Using i instead of philosopher_id to ensure order
+                    snapshot[i].state,
+                    snapshot[i].invoke_count,
+                    snapshot[i].must_think,
+                    p50, p99);
+        }
+        if (shown < num_philosophers) {
+            fprintf(out, "... %d more philosophers, lowest invoke count: %d\n",
+                    num_philosophers - shown, get_lowest_count());
         }
-        pthread_mutex_unlock(&print_mutex);
+        LatencyHistogram all_waits = {0};
+        for (int i = 0; i < num_philosophers; i++) {
+            latency_merge(&all_waits, &wait_histograms[i]);
+        }
+        latency_print_summary(out, "Wait to eat", &all_waits);
+
+        // One write per frame keeps the table from interleaving with events
+        fclose(out);
+        if (write(STDOUT_FILENO, frame, frame_size) < 0) {
+            perror("write");
+        }
+        free(frame);
         sleep(1);
     }
     return NULL;
 }
 
-int main() {
+int main(int argc, char* argv[]) {
+    PhiloOptions options;
+    parse_options(argc, argv, &options);
+    num_philosophers = options.num_philosophers;
+    numa_placement_init(num_philosophers, options.numa);
+    philosophers = numa_alloc_ring(num_philosophers, sizeof(Philosopher));
+    wait_histograms = numa_alloc_ring(num_philosophers, sizeof(LatencyHistogram));
+    meal_target_init(&meal_target, options.meal_target, &running);
+    blocking_mode = options.blocking;
+
     // Set up signal handling
     signal(SIGINT, handle_signal);
+    clock_init(options.time_scale, options.virtual_time);
+    if (options.virtual_time && blocking_mode) {
+        // Futex waits happen outside the clock, so virtual time could run past them
+        fprintf(stderr, "Blocking handoff is not available with virtual time; polling instead\n");
+        blocking_mode = 0;
+    }
+    if (options.workers > 0 && blocking_mode) {
+        // A futex wait would stall every philosopher sharing the worker
+        fprintf(stderr, "Blocking handoff is not available with a worker pool; polling instead\n");
+        blocking_mode = 0;
+    }
 
-    pthread_mutex_init(&print_mutex, NULL);
     pthread_mutex_init(&state_mutex, NULL);
     
-    srand((unsigned int)time(NULL));
+    if (random_init(options.seed, options.distributions) != 0) {
+        return 1;
+    }
+    // The manager has no chopsticks, so the trace holds states and timeouts only
+    if (trace_open(options.trace_path, "manager", num_philosophers, 0, MAX_WAIT_NS) != 0) {
+        return 1;
+    }
     
+    count_tracker_init(&meal_counts, num_philosophers);
+
     // Initialize philosophers
-    for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
+    for (int i = 0; i < num_philosophers; i++) {
         atomic_init(&philosophers[i].state, 1);
         philosophers[i].philosopher_id = i;
         atomic_init(&philosophers[i].invoke_count, 0);
         atomic_init(&philosophers[i].must_think, 0);
         philosophers[i].wait_start = 0;
+        philosophers[i].observed_seq = -1;
+        philosophers[i].phase = PHASE_DISPATCH;
+        publish_status(&philosophers[i]);
     }
     
-    int randomNum = get_random(0, NUM_PHILOSOPHERS - 1);
-    atomic_store(&philosophers[randomNum].state, 2);
-    philosophers[randomNum].wait_start = time(NULL);
+    thinkers.keys = malloc(num_philosophers * sizeof(unsigned long long));
+    thinkers.ids = malloc(num_philosophers * sizeof(int));
+    thinkers.size = 0;
+
+    int randomNum = get_random(0, num_philosophers - 1);
+    become_waiting(&philosophers[randomNum]);
+    for (int i = 0; i < num_philosophers; i++) {
+        if (i != randomNum) {
+            thinker_heap_push(i);
+        }
+    }
     
-    pthread_t philosopher_threads[NUM_PHILOSOPHERS];
+    pthread_t* philosopher_threads = malloc(num_philosophers * sizeof(pthread_t));
     pthread_t status_thread;
+    pthread_attr_t thread_attr;
+    init_philosopher_thread_attr(&thread_attr);
     
     // Create threads
+    numa_print_placement();
+    random_print_config();
+    // Rings 0..N-1 belong to the philosophers, ring N to monitor threads
+    if (event_log_start(&event_log, num_philosophers + 1, event_formats, options.log_path) != 0) {
+        return 1;
+    }
     pthread_create(&status_thread, NULL, print_status, NULL);
     
-    for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
-        pthread_create(&philosopher_threads[i], NULL, philosopher_routine, &philosophers[i]);
+    clock_register_thread();  // Time stands still until everything is started
+    TaskPool pool;
+    if (options.workers > 0) {
+        if (task_pool_start(&pool, options.workers, options.work_stealing, philosophers,
+                            sizeof(Philosopher), num_philosophers, execute_task, &running) != 0) {
+            return 1;
+        }
+    } else {
+        for (int i = 0; i < num_philosophers; i++) {
+            clock_register_thread();
+            numa_set_thread_attr(&thread_attr, i);
+            if (pthread_create(&philosopher_threads[i], &thread_attr, philosopher_routine, &philosophers[i]) != 0) {
+                fprintf(stderr, "Failed to create thread for philosopher %d\n", i);
+                return 1;
+            }
+        }
+    }
+    pthread_attr_destroy(&thread_attr);
+
+    StopTimer stop_timer;
+    if (options.duration_seconds > 0) {
+        clock_start_stop_timer(&stop_timer, options.duration_seconds, &running);
     }
     
-    // Main management loop
+    // Main management loop: sleeps until a philosopher stops eating or
+    // waiting, then promotes the lowest-count thinkers to fill the two slots
+    pthread_mutex_lock(&state_mutex);
     while (atomic_load(&running)) {
-        pthread_mutex_lock(&state_mutex);
-        
         int lowest = get_lowest_count();
-        int waiting_count = 0;
         
-        for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
-            if (atomic_load(&philosophers[i].state) == 2) {
-                waiting_count++;
-            }
+        while (waiting_count < 2 && thinkers.size > 0 && thinker_heap_top_count() == lowest) {
+            Philosopher* promoted = &philosophers[thinker_heap_pop()];
+            trace_event(promoted->philosopher_id, TRACE_PROMOTED, (int)((clock_now_ns() - slot_freed_ns) / 1000));
+            become_waiting(promoted);
         }
         
-        if (waiting_count < 2) {
-            int eligible[NUM_PHILOSOPHERS];
-            int eligible_count = 0;
-            
-            for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
-                if (atomic_load(&philosophers[i].state) == 1 && 
-                    atomic_load(&philosophers[i].invoke_count) == lowest) {
-                    eligible[eligible_count++] = i;
-                }
-            }
-            
-            if (eligible_count > 0) {
-                int num_to_add = 2 - waiting_count;
-                
-                for (int i = 0; i < num_to_add && i < eligible_count; i++) {
-                    int idx = get_random(0, eligible_count - 1 - i);
-                    int phil_id = eligible[idx];
-                    eligible[idx] = eligible[eligible_count - 1 - i];
-                    
-                    atomic_store(&philosophers[phil_id].state, 2);
-                    philosophers[phil_id].wait_start = time(NULL);
-                }
-            }
+        // The timeout only bounds how long a Ctrl+C goes unnoticed
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += 1;
+        manager_idle = 1;
+        clock_block_begin();
+        pthread_cond_timedwait(&manager_cond, &state_mutex, &deadline);
+        if (manager_idle) {
+            manager_idle = 0;
+            clock_block_end();
         }
-        
-        pthread_mutex_unlock(&state_mutex);
-        usleep(100000); // 100ms delay
     }
+    pthread_mutex_unlock(&state_mutex);
+    clock_thread_exit();
     
-    // Cleanup
-    for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
-        pthread_cancel(philosopher_threads[i]);
-        pthread_join(philosopher_threads[i], NULL);
+    // Cleanup: end every sleep and release blocked waiters so all threads
+    // notice the shutdown and return
+    clock_interrupt();
+    announce_finished_eating();
+    if (options.workers > 0) {
+        task_pool_join(&pool);
+    } else {
+        for (int i = 0; i < num_philosophers; i++) {
+            pthread_join(philosopher_threads[i], NULL);
+        }
     }
     pthread_cancel(status_thread);
     pthread_join(status_thread, NULL);
+    event_log_stop(&event_log);
     
-    pthread_mutex_destroy(&print_mutex);
     pthread_mutex_destroy(&state_mutex);
     
     printf("\nProgram terminated gracefully\n");
     printf("\nFinal Status:\n");
-    for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
+    for (int i = 0; i < num_philosophers; i++) {
         printf("Philosopher %d - State: %d, Invoke count: %d, Must think: %d\n", 
                i,
                atomic_load(&philosophers[i].state),
@@ -289,6 +590,26 @@ int main() {
                atomic_load(&philosophers[i].must_think));
     }
 
-    return 0;
+    HandoffStats handoff_totals = {0};
+    LatencyHistogram wait_totals = {0};
+    FairnessIndex fairness = {0};
+    long long total_meals = 0;
+    for (int i = 0; i < num_philosophers; i++) {
+        handoff_stats_merge(&handoff_totals, &philosophers[i].handoff);
+        latency_merge(&wait_totals, &wait_histograms[i]);
+        fairness_add(&fairness, atomic_load(&philosophers[i].invoke_count));
+        total_meals += atomic_load(&philosophers[i].invoke_count);
+    }
+    long long end_ns = clock_end_ns();
+    print_meal_throughput(total_meals, end_ns);
+    print_handoff_stats(&handoff_totals, blocking_mode);
+    bench_report(&options, "manager", blocking_mode, total_meals, &wait_totals, fairness_jain(&fairness), end_ns);
+    trace_close();
+
+    free(thinkers.keys);
+    free(thinkers.ids);
+    free(philosopher_threads);
+    numa_free_ring(wait_histograms, num_philosophers, sizeof(LatencyHistogram));
+    numa_free_ring(philosophers, num_philosophers, sizeof(Philosopher));
     return 0;
 }
@@ -0,0 +1,479 @@
+#define _GNU_SOURCE  // mremap() for the memory-mapped event log
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <time.h>
+#include <stdatomic.h>
+#include <signal.h>
+
+#include "philo_common.h"
+#include "philo_random.h"
+#include "futex_handoff.h"
+#include "event_log.h"
+#include "sim_clock.h"
+#include "status_snapshot.h"
+#include "numa_placement.h"
+#include "task_pool.h"
+#include "bench_report.h"
+#include "mailbox.h"
+
+// Chandy-Misra hygienic philosophers with message passing. There is no
+// shared chopstick array and nobody reads a neighbour's state: each
+// chopstick exists as one token owned by one of its two philosophers, and
+// chopsticks and requests for them travel through SPSC mailboxes between
+// neighbours. A philosopher only ever writes to its neighbours' mailboxes
+// and reads its own, so the cache lines it shares are those on its edges.
+
+#define POLL_INTERVAL_NS (50 * NS_PER_MS)  // Mailbox check while thinking or hungry
+
+enum {
+    SIDE_LEFT,   // Chopstick shared with the left neighbour
+    SIDE_RIGHT,  // Chopstick shared with the right neighbour
+};
+
+// Forward declarations
+void* philosopher_routine(void* arg);
+void* print_status(void* arg);
+long long execute_task(void* arg);
+
+// Event log records, formatted by the writer thread
+enum {
+    EVENT_EATING,
+    EVENT_THINKING,
+    EVENT_HUNGRY,
+    EVENT_PASSED_CHOPSTICK,
+};
+
+static const char* const event_formats[] = {
+    [EVENT_EATING] = "Philosopher %d is eating.\n",
+    [EVENT_THINKING] = "Philosopher %d is thinking.\n",
+    [EVENT_HUNGRY] = "Philosopher %d is hungry.\n",
+    [EVENT_PASSED_CHOPSTICK] = "Philosopher %d passed a chopstick to philosopher %d.\n",
+};
+
+// Global variables
+atomic_int running = 1;
+
+// Philosopher structure. Everything above the mailboxes is private to the
+// owner; state and invoke_count are atomic only for the final report.
+typedef struct {
+    _Alignas(CACHE_LINE_SIZE) atomic_int state;  // 1:thinking, 2:hungry, 3:eating
+    int philosopher_id;
+    atomic_int invoke_count;  // Times eaten
+    int holds[2];             // Holds the chopstick token on this side
+    int dirty[2];             // That chopstick has been eaten with since it arrived
+    int requested[2];         // Holds the request token: the neighbour wants the chopstick
+    long long phase_end;      // Simulated ns at which thinking or eating ends
+    long long wait_start;     // Simulated ns at which hunger set in
+    long long messages_sent;
+    HandoffStats handoff;     // Send-to-receive latency of requested chopsticks
+    Doorbell doorbell;
+    Mailbox inbox[2];         // inbox[SIDE_LEFT] is written by the left neighbour only
+    StatusSlot status;        // Published copy read by print_status()
+} Philosopher;  // Padded to a cache line so neighbours never share one
+
+int num_philosophers = DEFAULT_NUM_PHILOSOPHERS;
+Philosopher* philosophers;
+EventLog event_log;  // Per-philosopher rings drained by one writer thread
+LatencyHistogram* wait_histograms;  // Wait-to-eat time per philosopher, owner thread only
+MealTarget meal_target;             // -m: total meals after which the run stops
+int blocking_mode = 0;
+
+// Signal handler
+void handle_signal(int sig) {
+    if (sig == SIGINT) {
+        atomic_store(&running, 0);
+        clock_interrupt_from_signal();
+    }
+}
+
+// Utility functions
+int neighbour(int philosopher_id, int side) {
+    return side == SIDE_LEFT ? (philosopher_id - 1 + num_philosophers) % num_philosophers
+                             : (philosopher_id + 1) % num_philosophers;
+}
+
+// The neighbour on `side` sees this philosopher on its opposite side
+void send_message(Philosopher* philosopher, int side, int type) {
+    Philosopher* receiver = &philosophers[neighbour(philosopher->philosopher_id, side)];
+    mailbox_send(&receiver->inbox[1 - side], &receiver->doorbell, type);
+    philosopher->messages_sent++;
+}
+
+void send_chopstick(Philosopher* philosopher, int side) {
+    philosopher->holds[side] = 0;
+    send_message(philosopher, side, MESSAGE_CHOPSTICK);
+    log_event_arg(&event_log, philosopher->philosopher_id, EVENT_PASSED_CHOPSTICK,
+                  neighbour(philosopher->philosopher_id, side));
+}
+
+void send_request(Philosopher* philosopher, int side) {
+    philosopher->requested[side] = 0;
+    send_message(philosopher, side, MESSAGE_REQUEST);
+}
+
+// Publish this philosopher's row of the status table (owner thread only)
+void publish_status(Philosopher* philosopher) {
+    StatusRecord record = {
+        .state = atomic_load(&philosopher->state),
+        .invoke_count = atomic_load(&philosopher->invoke_count),
+        .must_think = 0,
+        .held = (philosopher->holds[SIDE_LEFT] ? HOLDS_LEFT : 0) | (philosopher->holds[SIDE_RIGHT] ? HOLDS_RIGHT : 0),
+    };
+    status_publish(&philosopher->status, &record);
+}
+
+// Apply the hygiene rules to everything the neighbours sent since the last step
+void read_mailboxes(Philosopher* philosopher) {
+    int state = atomic_load(&philosopher->state);
+    int changed = 0;
+    Message message;
+
+    for (int side = SIDE_LEFT; side <= SIDE_RIGHT; side++) {
+        while (mailbox_receive(&philosopher->inbox[side], &message)) {
+            changed = 1;
+            if (message.type == MESSAGE_CHOPSTICK) {
+                philosopher->holds[side] = 1;
+                philosopher->dirty[side] = 0;
+                handoff_stats_record(&philosopher->handoff, monotonic_ns() - message.sent_ns);
+                continue;
+            }
+
+            // A dirty chopstick goes on request unless it is being eaten with;
+            // a clean one stays until its holder has eaten
+            philosopher->requested[side] = 1;
+            if (philosopher->holds[side] && philosopher->dirty[side] && state != 3) {
+                send_chopstick(philosopher, side);
+                if (state == 2) {
+                    // Still hungry: ask for it back straight away
+                    send_request(philosopher, side);
+                }
+            }
+        }
+    }
+    if (changed) {
+        publish_status(philosopher);
+    }
+}
+
+// Wait for the next step. Polling sleeps on the clock; blocking mode sleeps
+// on the doorbell so a request or chopstick is handled as soon as it arrives.
+long long wait_for_messages(Philosopher* philosopher, long long limit_ns) {
+    if (!blocking_mode) {
+        return limit_ns >= 0 && limit_ns < POLL_INTERVAL_NS ? limit_ns : POLL_INTERVAL_NS;
+    }
+    long long timeout_ns = limit_ns >= 0 && limit_ns < NS_PER_SEC ? limit_ns : NS_PER_SEC;
+    doorbell_wait(&philosopher->doorbell, philosopher->inbox, 2, clock_real_timeout_ns(timeout_ns));
+    return 0;
+}
+
+// Philosopher actions
+void become_hungry(Philosopher* philosopher) {
+    atomic_store(&philosopher->state, 2);
+    philosopher->wait_start = clock_now_ns();
+    log_event(&event_log, philosopher->philosopher_id, EVENT_HUNGRY);
+
+    for (int side = SIDE_LEFT; side <= SIDE_RIGHT; side++) {
+        if (!philosopher->holds[side] && philosopher->requested[side]) {
+            send_request(philosopher, side);
+        }
+    }
+    publish_status(philosopher);
+}
+
+long long eat(Philosopher* philosopher) {
+    latency_record(&wait_histograms[philosopher->philosopher_id], clock_now_ns() - philosopher->wait_start, 0);
+    philosopher->dirty[SIDE_LEFT] = 1;
+    philosopher->dirty[SIDE_RIGHT] = 1;
+    atomic_store(&philosopher->state, 3);
+    log_event(&event_log, philosopher->philosopher_id, EVENT_EATING);
+    publish_status(philosopher);
+
+    long long duration_ns = random_eat_ns(1, 4);  // 1-4 seconds
+    philosopher->phase_end = clock_now_ns() + duration_ns;
+    return duration_ns;
+}
+
+long long think(Philosopher* philosopher) {
+    atomic_fetch_add(&philosopher->invoke_count, 1);
+    atomic_store(&philosopher->state, 1);
+
+    // Hand over the now dirty chopsticks the neighbours asked for while we ate
+    for (int side = SIDE_LEFT; side <= SIDE_RIGHT; side++) {
+        if (philosopher->requested[side] && philosopher->holds[side]) {
+            send_chopstick(philosopher, side);
+        }
+    }
+    log_event(&event_log, philosopher->philosopher_id, EVENT_THINKING);
+    publish_status(philosopher);
+    meal_target_count(&meal_target);
+
+    long long duration_ns = random_think_ns(2, 5);  // 2-5 seconds
+    philosopher->phase_end = clock_now_ns() + duration_ns;
+    return wait_for_messages(philosopher, duration_ns);
+}
+
+// Run the philosopher up to its next sleep and return that sleep in
+// simulated ns. Requests have to be answered while thinking, so think and
+// wait are sliced into mailbox checks and phase_end says when they are over.
+long long execute_task(void* arg) {
+    Philosopher* philosopher = (Philosopher*)arg;
+
+    read_mailboxes(philosopher);
+    long long now = clock_now_ns();
+
+    switch (atomic_load(&philosopher->state)) {
+        case 1:
+            if (now < philosopher->phase_end) {
+                return wait_for_messages(philosopher, philosopher->phase_end - now);
+            }
+            become_hungry(philosopher);
+            // fall through
+        case 2:
+            if (philosopher->holds[SIDE_LEFT] && philosopher->holds[SIDE_RIGHT]) {
+                return eat(philosopher);
+            }
+            return wait_for_messages(philosopher, -1);
+        case 3:
+        default:
+            if (now < philosopher->phase_end) {
+                return philosopher->phase_end - now;
+            }
+            return think(philosopher);
+    }
+}
+
+void* philosopher_routine(void* arg) {
+    Philosopher* philosopher = (Philosopher*)arg;
+    while (atomic_load(&running)) {
+        clock_sleep_ns(execute_task(philosopher));
+    }
+    clock_thread_exit();
+    return NULL;
+}
+
+void* print_status(void* arg) {
+    while (atomic_load(&running)) {
+        sleep(1);
+        int shown = num_philosophers < STATUS_DISPLAY_LIMIT ? num_philosophers : STATUS_DISPLAY_LIMIT;
+
+        // Copy the published rows, then render without holding any lock
+        StatusRecord snapshot[STATUS_DISPLAY_LIMIT];
+        for (int i = 0; i < shown; i++) {
+            status_read(&philosophers[i].status, &snapshot[i]);
+        }
+
+        char* frame = NULL;
+        size_t frame_size = 0;
+        FILE* out = open_memstream(&frame, &frame_size);
+        fprintf(out, " ");
+        for (int i = 0; i < shown * 9; i++) fputs("═", out);
+        fprintf(out, "\n");
+        fprintf(out, "║");
+        for (int i = 0; i < shown; i++) {
+            fprintf(out, " P%-7d", i);
+        }
+        fprintf(out, "║\n║");
+
+        // Chopstick tokens held
+        for (int i = 0; i < shown; i++) {
+            if (snapshot[i].held == (HOLDS_LEFT | HOLDS_RIGHT)) {
+                fprintf(out, " ||      "); // Has both chopsticks
+            } else if (snapshot[i].held & HOLDS_LEFT) {
+                fprintf(out, " |_      "); // Has only left chopstick
+            } else if (snapshot[i].held & HOLDS_RIGHT) {
+                fprintf(out, " _|      "); // Has only right chopstick
+            } else {
+                fprintf(out, " __      "); // No chopsticks
+            }
+        }
+        fprintf(out, "║\n║");
+
+        // State representation
+        for (int i = 0; i < shown; i++) {
+            char state_char;
+            switch (snapshot[i].state) {
+                case 1: state_char = 't'; break; // Thinking
+                case 2: state_char = 'h'; break; // Hungry
+                case 3: state_char = 'e'; break; // Eating
+                default: state_char = '?'; break;
+            }
+            fprintf(out, " %c       ", state_char);
+        }
+        fprintf(out, "║\n║");
+
+        // Invoke count representation
+        for (int i = 0; i < shown; i++) {
+            fprintf(out, " %-7d ", snapshot[i].invoke_count);
+        }
+        fprintf(out, "║\n║");
+
+        // Wait-to-eat p50 and p99, read from the live histograms
+        for (int i = 0; i < shown; i++) {
+            char p50[16];
+            latency_format(p50, sizeof(p50), latency_percentile(&wait_histograms[i], 0.5));
+            fprintf(out, " %-7s ", p50);
+        }
+        fprintf(out, "║\n║");
+        for (int i = 0; i < shown; i++) {
+            char p99[16];
+            latency_format(p99, sizeof(p99), latency_percentile(&wait_histograms[i], 0.99));
+            fprintf(out, " %-7s ", p99);
+        }
+        fprintf(out, "║\n ");
+
+        for (int i = 0; i < shown * 9; i++) fputs("═", out);
+        fprintf(out, "\n");
+        if (shown < num_philosophers) {
+            fprintf(out, "(showing %d of %d philosophers)\n", shown, num_philosophers);
+        }
+        LatencyHistogram all_waits = {0};
+        for (int i = 0; i < num_philosophers; i++) {
+            latency_merge(&all_waits, &wait_histograms[i]);
+        }
+        latency_print_summary(out, "Wait to eat (rows 4-5: p50, p99)", &all_waits);
+        fprintf(out, "\n");
+
+        // One write per frame keeps the table from interleaving with events
+        fclose(out);
+        if (write(STDOUT_FILENO, frame, frame_size) < 0) {
+            perror("write");
+        }
+        free(frame);
+        sleep(1);
+    }
+    return NULL;
+}
+
+int main(int argc, char* argv[]) {
+    PhiloOptions options;
+    parse_options(argc, argv, &options);
+    num_philosophers = options.num_philosophers;
+    numa_placement_init(num_philosophers, options.numa);
+    philosophers = numa_alloc_ring(num_philosophers, sizeof(Philosopher));
+    wait_histograms = numa_alloc_ring(num_philosophers, sizeof(LatencyHistogram));
+    meal_target_init(&meal_target, options.meal_target, &running);
+    blocking_mode = options.blocking;
+
+    signal(SIGINT, handle_signal);
+    clock_init(options.time_scale, options.virtual_time);
+    if (options.virtual_time && blocking_mode) {
+        // Futex waits happen outside the clock, so virtual time could run past them
+        fprintf(stderr, "Blocking handoff is not available with virtual time; polling instead\n");
+        blocking_mode = 0;
+    }
+    if (options.workers > 0 && blocking_mode) {
+        // A futex wait would stall every philosopher sharing the worker
+        fprintf(stderr, "Blocking handoff is not available with a worker pool; polling instead\n");
+        blocking_mode = 0;
+    }
+    if (random_init(options.seed, options.distributions) != 0) {
+        return 1;
+    }
+
+    // Initialize philosophers. Each chopstick starts dirty with the lower
+    // numbered of its two philosophers and the request token with the other,
+    // which makes the precedence graph acyclic.
+    for (int i = 0; i < num_philosophers; i++) {
+        atomic_init(&philosophers[i].state, 1); // Initial state: thinking
+        philosophers[i].philosopher_id = i;
+        atomic_init(&philosophers[i].invoke_count, 0);
+        for (int side = SIDE_LEFT; side <= SIDE_RIGHT; side++) {
+            philosophers[i].holds[side] = i < neighbour(i, side);
+            philosophers[i].dirty[side] = 1;
+            philosophers[i].requested[side] = !philosophers[i].holds[side];
+        }
+        philosophers[i].phase_end = random_think_ns(2, 5);
+    }
+    for (int i = 0; i < num_philosophers; i++) {
+        publish_status(&philosophers[i]);
+    }
+
+    pthread_t* philosopher_threads = malloc(num_philosophers * sizeof(pthread_t));
+    pthread_t status_thread;
+    pthread_attr_t thread_attr;
+    init_philosopher_thread_attr(&thread_attr);
+
+    printf("Starting dining philosophers simulation (Chandy-Misra, message passing)\n");
+    printf("Number of philosophers: %d\n", num_philosophers);
+    numa_print_placement();
+    random_print_config();
+    if (options.workers > 0) {
+        printf("Worker threads: %d\n", options.workers < num_philosophers ? options.workers : num_philosophers);
+    }
+    printf("Press Ctrl+C to terminate the program\n\n");
+
+    if (event_log_start(&event_log, num_philosophers, event_formats, options.log_path) != 0) {
+        return 1;
+    }
+    pthread_create(&status_thread, NULL, print_status, NULL);
+
+    clock_register_thread();  // Time stands still until everything is started
+    TaskPool pool;
+    if (options.workers > 0) {
+        if (task_pool_start(&pool, options.workers, options.work_stealing, philosophers,
+                            sizeof(Philosopher), num_philosophers, execute_task, &running) != 0) {
+            return 1;
+        }
+    } else {
+        for (int i = 0; i < num_philosophers; i++) {
+            clock_register_thread();
+            numa_set_thread_attr(&thread_attr, i);
+            if (pthread_create(&philosopher_threads[i], &thread_attr, philosopher_routine, &philosophers[i]) != 0) {
+                fprintf(stderr, "Failed to create thread for philosopher %d\n", i);
+                return 1;
+            }
+        }
+    }
+    pthread_attr_destroy(&thread_attr);
+
+    StopTimer stop_timer;
+    if (options.duration_seconds > 0) {
+        clock_start_stop_timer(&stop_timer, options.duration_seconds, &running);
+    }
+    clock_thread_exit();
+
+    if (options.workers > 0) {
+        task_pool_join(&pool);
+    } else {
+        for (int i = 0; i < num_philosophers; i++) {
+            pthread_join(philosopher_threads[i], NULL);
+        }
+    }
+    pthread_join(status_thread, NULL);
+    event_log_stop(&event_log);
+
+    printf("\nProgram terminated successfully\n");
+    printf("\nFinal Status:\n");
+    for (int i = 0; i < num_philosophers; i++) {
+        printf("Philosopher %d - State: %d, Times eaten: %d\n",
+               i,
+               atomic_load(&philosophers[i].state),
+               atomic_load(&philosophers[i].invoke_count));
+    }
+
+    HandoffStats handoff_totals = {0};
+    LatencyHistogram wait_totals = {0};
+    FairnessIndex fairness = {0};
+    long long total_meals = 0;
+    long long total_messages = 0;
+    for (int i = 0; i < num_philosophers; i++) {
+        handoff_stats_merge(&handoff_totals, &philosophers[i].handoff);
+        latency_merge(&wait_totals, &wait_histograms[i]);
+        fairness_add(&fairness, atomic_load(&philosophers[i].invoke_count));
+        total_meals += atomic_load(&philosophers[i].invoke_count);
+        total_messages += philosophers[i].messages_sent;
+    }
+    long long end_ns = clock_end_ns();
+    print_meal_throughput(total_meals, end_ns);
+    print_handoff_stats(&handoff_totals, blocking_mode);
+    printf("Messages: %lld sent (%.2f per meal)\n", total_messages,
+           total_meals > 0 ? (double)total_messages / total_meals : 0.0);
+    bench_report(&options, "chandy-misra", blocking_mode, total_meals, &wait_totals, fairness_jain(&fairness), end_ns);
+
+    free(philosopher_threads);
+    numa_free_ring(wait_histograms, num_philosophers, sizeof(LatencyHistogram));
+    numa_free_ring(philosophers, num_philosophers, sizeof(Philosopher));
+    return 0;
+}
@@ -1,3 +1,4 @@
+#define _GNU_SOURCE  // mremap() for the memory-mapped event log
 #include <stdio.h>
 #include <stdlib.h>
 #include <pthread.h>
@@ -6,14 +7,42 @@
 #include <stdatomic.h>
 #include <signal.h>
 
-#define NUM_PHILOSOPHERS 5
+#include "philo_common.h"
+#include "philo_random.h"
+#include "futex_handoff.h"
+#include "event_log.h"
+#include "sim_clock.h"
+#include "chopstick_pairs.h"
+#include "status_snapshot.h"
+#include "numa_placement.h"
+#include "task_pool.h"
+#include "bench_report.h"
+#include "wait_for_graph.h"
+#include "trace_log.h"
+
 #define MAX_WAIT_TIME 6
-#define SHARED_MEMORY_SIZE 5  // Number of shared memory cells for chopsticks
+#define MAX_WAIT_NS (MAX_WAIT_TIME * NS_PER_SEC)
+#define DEADLOCK_SCAN_NS (100 * NS_PER_MS)  // Simulated time between wait-for graph scans
+#define CYCLE_DISPLAY_LIMIT 16              // Members listed when a cycle is reported
 
 // Forward declarations
 void* philosopher_routine(void* arg);
 void* print_status(void* arg);
-void* execute_task(void* arg);
+void* deadlock_monitor(void* arg);
+long long execute_task(void* arg);
+
+// Event log records, formatted by the writer thread
+enum {
+    EVENT_EATING,
+    EVENT_THINKING,
+    EVENT_RELEASED_FOR_RECOVERY,
+};
+
+static const char* const event_formats[] = {
+    [EVENT_EATING] = "Philosopher %d is eating.\n",
+    [EVENT_THINKING] = "Philosopher %d is thinking.\n",
+    [EVENT_RELEASED_FOR_RECOVERY] = "Philosopher %d put down its chopstick to break a deadlock.\n",
+};
 
 // Global variables
 atomic_int should_print = 0;
@@ -21,40 +50,57 @@ atomic_int running = 1;
 
 // Philosopher structure
 typedef struct {
-    atomic_int state;         // 1:thinking, 2:waiting, 3:eating
+    _Alignas(CACHE_LINE_SIZE) atomic_int state;         // 1:thinking, 2:waiting, 3:eating
     int philosopher_id;       // ID number
     atomic_int invoke_count;  // Times eaten
     atomic_int must_think;    // Fairness control
-    time_t wait_start;       // Wait timestamp
-} Philosopher;
-
-Philosopher philosophers[NUM_PHILOSOPHERS];
-pthread_mutex_t print_mutex;
+    long long wait_start;  // Wait timestamp (simulated ns)
+    TaskPhase phase;          // Where execute_task() resumes
+    int try_after_think;      // think() is followed by try_to_wait()
+    int contended;            // Chopstick busy on the last failed attempt, -1 if none
+    atomic_int must_release;  // Set by the deadlock monitor to pick this philosopher as victim
+    HandoffStats handoff;     // Release-to-acquire latency, owner thread only
+    StatusSlot status;        // Published copy read by print_status()
+} Philosopher;  // Padded to a cache line so neighbours never share one
+
+// Chopstick cell, one per cache line so a CAS never invalidates a neighbour's
+typedef struct {
+    _Alignas(CACHE_LINE_SIZE) atomic_int owner;  // 0: free, otherwise philosopher ID + 1
+    atomic_int waiters;                          // Threads blocked on owner in futex_wait()
+    _Atomic long long released_ns;               // Time of the last release
+} Chopstick;
+
+int num_philosophers = DEFAULT_NUM_PHILOSOPHERS;
+Philosopher* philosophers;
+EventLog event_log;  // Per-philosopher rings drained by one writer thread
+LatencyHistogram* wait_histograms;  // Wait-to-eat time per philosopher, owner thread only
+MealTarget meal_target;             // -m: total meals after which the run stops
 pthread_mutex_t state_mutex;
-atomic_int chopsticks[SHARED_MEMORY_SIZE]; // Shared memory for chopsticks
+Chopstick* chopsticks; // Shared memory for chopsticks
+int blocking_mode = 0;
+int pair_mode = 0;               // -a pair: claim both chopsticks at once
+ChopstickPairs chopstick_pairs;  // Bitmap view of chopsticks[] used by pair_mode
+
+// Deadlock monitor state. The monitor alone writes the counters; a
+// philosopher that starts eating while a recovery is pending stamps
+// recovery_finished_ns, and the monitor turns the pair into a sample.
+WaitForGraph wait_for_graph;
+int break_deadlocks = 0;
+long long deadlocks_detected = 0;
+HandoffStats recovery_stats;                   // Deadlock detection to the next meal
+_Atomic long long recovery_started_ns = -1;    // Simulated time of the pending break, -1 if none
+_Atomic long long recovery_finished_ns = -1;   // First meal after it, -1 if none yet
 
 // Signal handler
 void handle_signal(int sig) {
     if (sig == SIGINT) {
         atomic_store(&running, 0);
+        clock_interrupt_from_signal();
     }
 }
 // Utility functions
-int get_random(int min, int max) {
-    int result = 0, low_num = 0, hi_num = 0;
-    if (min < max) {
-        low_num = min;
-        hi_num = max + 1;
-    } else {
-        low_num = max + 1;
-        hi_num = min;
-    }
-    result = (rand() % (hi_num - low_num)) + low_num;
-    return result;
-}
-
 int is_anyone_eating() {
-    for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
+    for (int i = 0; i < num_philosophers; i++) {
         if (atomic_load(&philosophers[i].state) == 3) {
             return 1;
         }
@@ -62,202 +108,613 @@ int is_anyone_eating() {
     return 0;
 }
 
-// Philosopher actions
-void eat(Philosopher* philosopher) {
-    int left_chopstick_index = (philosopher->philosopher_id - 1 + NUM_PHILOSOPHERS) % NUM_PHILOSOPHERS; // Left chopstick
-    int right_chopstick_index = philosopher->philosopher_id; // Right chopstick
+// Every state change goes through here so the trace sees it
+void set_state(Philosopher* philosopher, int state) {
+    atomic_store(&philosopher->state, state);
+    trace_event(philosopher->philosopher_id, TRACE_STATE, state);
+}
 
-    pthread_mutex_lock(&print_mutex);
-    printf("Philosopher %d is eating.\n", philosopher->philosopher_id);
-    pthread_mutex_unlock(&print_mutex);
+// Chopstick handoff: a release wakes the one neighbour blocked on that chopstick
+void release_chopstick(int philosopher_id, int index) {
+    trace_event(philosopher_id, TRACE_RELEASE, index);
+    atomic_store(&chopsticks[index].released_ns, monotonic_ns());
+    atomic_store(&chopsticks[index].owner, 0);
+    if (atomic_load(&chopsticks[index].waiters) > 0) {
+        futex_wake(&chopsticks[index].owner, 1);
+    }
+}
 
-    sleep(get_random(1, 4));  // 1-4 seconds
+void wait_for_chopstick(int index, int owner, long long timeout_ns) {
+    atomic_fetch_add(&chopsticks[index].waiters, 1);
+    futex_wait(&chopsticks[index].owner, owner, timeout_ns);
+    atomic_fetch_sub(&chopsticks[index].waiters, 1);
+}
+
+// Pair mode keeps chopsticks[].owner in sync for the status view and for
+// futex handoff, but the bitmap in chopstick_pairs decides who gets them.
+// The owner words are cleared before the bitmap frees the pair, since a
+// neighbour that wins it sets its own, and woken only after.
+void release_pair(int philosopher_id, int left_chopstick_index, int right_chopstick_index) {
+    int pair[2] = {left_chopstick_index, right_chopstick_index};
+    for (int i = 0; i < 2; i++) {
+        trace_event(philosopher_id, TRACE_RELEASE, pair[i]);
+        atomic_store(&chopsticks[pair[i]].released_ns, monotonic_ns());
+        atomic_store(&chopsticks[pair[i]].owner, 0);
+    }
+    chopstick_pair_release(&chopstick_pairs, left_chopstick_index, right_chopstick_index);
+    for (int i = 0; i < 2; i++) {
+        if (atomic_load(&chopsticks[pair[i]].waiters) > 0) {
+            futex_wake(&chopsticks[pair[i]].owner, 1);
+        }
+    }
+}
+
+// First meal after the monitor broke a deadlock ends the recovery
+void note_recovery() {
+    if (atomic_load_explicit(&recovery_started_ns, memory_order_relaxed) >= 0) {
+        long long expected = -1;
+        atomic_compare_exchange_strong(&recovery_finished_ns, &expected, clock_now_ns());
+    }
+}
+
+// One pass of wait()'s loop in pair mode. Returns the delay before the next
+// pass, or -1 once waiting is over.
+long long wait_for_pair_pass(Philosopher* philosopher, int left_chopstick_index, int right_chopstick_index) {
+    if (chopstick_pair_try_acquire(&chopstick_pairs, left_chopstick_index, right_chopstick_index)) {
+        atomic_store(&chopsticks[left_chopstick_index].owner, philosopher->philosopher_id + 1);
+        atomic_store(&chopsticks[right_chopstick_index].owner, philosopher->philosopher_id + 1);
+        trace_event(philosopher->philosopher_id, TRACE_ACQUIRE, left_chopstick_index);
+        trace_event(philosopher->philosopher_id, TRACE_ACQUIRE, right_chopstick_index);
+        if (philosopher->contended >= 0) {
+            handoff_stats_record(&philosopher->handoff,
+                                 monotonic_ns() - atomic_load(&chopsticks[philosopher->contended].released_ns));
+        }
+        latency_record(&wait_histograms[philosopher->philosopher_id], clock_now_ns() - philosopher->wait_start, 0);
+        set_state(philosopher, 3);
+        return -1;
+    }
+
+    // Nothing is held here, so blocking cannot form a hold-and-wait cycle
+    philosopher->contended = atomic_load(&chopsticks[left_chopstick_index].owner) != 0 ? left_chopstick_index
+                                                                                       : right_chopstick_index;
+    trace_event(philosopher->philosopher_id, TRACE_CONTENDED, philosopher->contended);
+    if (blocking_mode) {
+        int owner = atomic_load(&chopsticks[philosopher->contended].owner);
+        // An owner of 0 is a pair changing hands; there is nothing to sleep on yet
+        if (owner != 0) {
+            wait_for_chopstick(philosopher->contended, owner, NS_PER_SEC);
+        }
+        return 0;
+    }
+    return 50 * NS_PER_MS;
+}
+
+// Publish this philosopher's row of the status table (owner thread only)
+void publish_status(Philosopher* philosopher) {
+    int owner_id = philosopher->philosopher_id + 1;
+    int left_chopstick_index = (philosopher->philosopher_id - 1 + num_philosophers) % num_philosophers;
+    int right_chopstick_index = philosopher->philosopher_id;
+    StatusRecord record = {
+        .state = atomic_load(&philosopher->state),
+        .invoke_count = atomic_load(&philosopher->invoke_count),
+        .must_think = atomic_load(&philosopher->must_think),
+        .held = (atomic_load(&chopsticks[left_chopstick_index].owner) == owner_id ? HOLDS_LEFT : 0) |
+                (atomic_load(&chopsticks[right_chopstick_index].owner) == owner_id ? HOLDS_RIGHT : 0),
+    };
+    status_publish(&philosopher->status, &record);
+}
+
+// Philosopher actions. Each returns how long the philosopher now sleeps;
+// execute_task() resumes in the matching phase afterwards.
+long long eat(Philosopher* philosopher) {
+    log_event(&event_log, philosopher->philosopher_id, EVENT_EATING);
+
+    philosopher->phase = PHASE_ATE;
+    return random_eat_ns(1, 4);  // 1-4 seconds
+}
+
+void finish_eating(Philosopher* philosopher) {
+    int left_chopstick_index = (philosopher->philosopher_id - 1 + num_philosophers) % num_philosophers; // Left chopstick
+    int right_chopstick_index = philosopher->philosopher_id; // Right chopstick
 
     atomic_fetch_add(&philosopher->invoke_count, 1);
 
-    atomic_store(&philosopher->state, 1);
+    set_state(philosopher, 1);
 
     // Release the chopsticks
-    atomic_store(&chopsticks[left_chopstick_index], 0);
-    atomic_store(&chopsticks[right_chopstick_index], 0);
+    if (pair_mode) {
+        release_pair(philosopher->philosopher_id, left_chopstick_index, right_chopstick_index);
+    } else {
+        release_chopstick(philosopher->philosopher_id, left_chopstick_index);
+        release_chopstick(philosopher->philosopher_id, right_chopstick_index);
+    }
+    meal_target_count(&meal_target);
 }
 
-void think(Philosopher* philosopher) {
-    pthread_mutex_lock(&print_mutex);
-    printf("Philosopher %d is thinking.\n", philosopher->philosopher_id);
-    pthread_mutex_unlock(&print_mutex);
+long long think(Philosopher* philosopher) {
+    log_event(&event_log, philosopher->philosopher_id, EVENT_THINKING);
 
-    sleep(get_random(2, 5));  // 2-5 seconds
+    philosopher->phase = PHASE_THOUGHT;
+    return random_think_ns(2, 5);  // 2-5 seconds
 }
 
 void try_to_wait(Philosopher* philosopher) {
     int right_chopstick_index = philosopher->philosopher_id; // Right chopstick
     int expected = 0;
 
+    if (pair_mode) {
+        // Announce hunger without holding anything; wait() takes both at once
+        set_state(philosopher, 2);
+        return;
+    }
+
     // Try to get right chopstick and never release it
-    if (atomic_compare_exchange_weak(&chopsticks[right_chopstick_index], &expected, philosopher->philosopher_id + 1)) {
-        atomic_store(&philosopher->state, 2);
+    if (atomic_compare_exchange_weak(&chopsticks[right_chopstick_index].owner, &expected, philosopher->philosopher_id + 1)) {
+        trace_event(philosopher->philosopher_id, TRACE_ACQUIRE, right_chopstick_index);
+        set_state(philosopher, 2);
         // Once we get the right chopstick, we keep it and wait for the left one
+    } else {
+        trace_event(philosopher->philosopher_id, TRACE_CONTENDED, right_chopstick_index);
     }
 }
 
-void wait(Philosopher* philosopher) {
-    int left_chopstick_index = (philosopher->philosopher_id - 1 + NUM_PHILOSOPHERS) % NUM_PHILOSOPHERS;
-    
+// One pass of wait()'s retry loop. Returns the delay before the next pass,
+// or -1 once the philosopher holds both chopsticks.
+long long wait_pass(Philosopher* philosopher) {
+    int left_chopstick_index = (philosopher->philosopher_id - 1 + num_philosophers) % num_philosophers;
+
+    if (pair_mode) {
+        return wait_for_pair_pass(philosopher, left_chopstick_index, philosopher->philosopher_id);
+    }
+
+    // The deadlock monitor picked this philosopher to break a cycle
+    if (atomic_load_explicit(&philosopher->must_release, memory_order_relaxed)) {
+        atomic_store(&philosopher->must_release, 0);
+        release_chopstick(philosopher->philosopher_id, philosopher->philosopher_id);
+        set_state(philosopher, 1);
+        latency_record(&wait_histograms[philosopher->philosopher_id], clock_now_ns() - philosopher->wait_start, 1);
+        log_event(&event_log, philosopher->philosopher_id, EVENT_RELEASED_FOR_RECOVERY);
+        return -1;
+    }
+
     // Keep trying to get left chopstick without ever releasing the right one
-    while (atomic_load(&running) && atomic_load(&philosophers[philosopher->philosopher_id].state) == 2) {
-        int expected_left = 0;
-        
-        // Try to get left chopstick
-        if (atomic_load(&chopsticks[left_chopstick_index]) == 0) {
-            if (atomic_compare_exchange_weak(&chopsticks[left_chopstick_index], &expected_left, philosopher->philosopher_id + 1)) {
-                atomic_store(&philosopher->state, 3);
-                return;
+    int expected_left = 0;
+    int left_owner = atomic_load(&chopsticks[left_chopstick_index].owner);
+
+    // Try to get left chopstick
+    if (left_owner == 0) {
+        if (atomic_compare_exchange_weak(&chopsticks[left_chopstick_index].owner, &expected_left, philosopher->philosopher_id + 1)) {
+            trace_event(philosopher->philosopher_id, TRACE_ACQUIRE, left_chopstick_index);
+            if (philosopher->contended >= 0) {
+                handoff_stats_record(&philosopher->handoff,
+                                     monotonic_ns() - atomic_load(&chopsticks[left_chopstick_index].released_ns));
             }
+            latency_record(&wait_histograms[philosopher->philosopher_id], clock_now_ns() - philosopher->wait_start, 0);
+            note_recovery();
+            set_state(philosopher, 3);
+            return -1;
         }
-        
-        // Critical change: Don't release right chopstick even if we can't get the left one
-        usleep(50000);
+        trace_event(philosopher->philosopher_id, TRACE_CONTENDED, left_chopstick_index);
+    } else {
+        philosopher->contended = left_chopstick_index;
+        trace_event(philosopher->philosopher_id, TRACE_CONTENDED, left_chopstick_index);
+    }
+
+    // Critical change: Don't release right chopstick even if we can't get the left one
+    if (blocking_mode) {
+        wait_for_chopstick(left_chopstick_index, left_owner, NS_PER_SEC);
+        return 0;
     }
+    return 50 * NS_PER_MS;
 }
 
-void* execute_task(void* arg) {
+// Run the philosopher up to its next sleep and return that sleep in
+// simulated ns. The caller sleeps (its own thread, or a pool timer) and
+// calls again; phase records where to pick up.
+long long execute_task(void* arg) {
     Philosopher* philosopher = (Philosopher*)arg;
-    int current_state = atomic_load(&philosopher->state);
+    long long delay_ns;
 
-    if (atomic_load(&philosopher->must_think) && current_state != 2) {
-        think(philosopher);
-        return NULL;
-    }
+    switch (philosopher->phase) {
+        case PHASE_THOUGHT:
+            if (philosopher->try_after_think) {
+                try_to_wait(philosopher);
+            }
+            break;
+        case PHASE_ATE:
+            finish_eating(philosopher);
+            break;
+        case PHASE_WAITING:
+            if ((delay_ns = wait_pass(philosopher)) >= 0) {
+                return delay_ns;
+            }
+            break;
+        case PHASE_DISPATCH: {
+            int current_state = atomic_load(&philosopher->state);
 
-    if (current_state == 1) {
-        think(philosopher);
-        try_to_wait(philosopher);
-    } else if (current_state == 2) {
-        wait(philosopher);
-    } else if (current_state == 3) {
-        eat(philosopher);
+            if (atomic_load(&philosopher->must_think) && current_state != 2) {
+                philosopher->try_after_think = 0;
+                return think(philosopher);
+            }
+
+            if (current_state == 1) {
+                philosopher->try_after_think = 1;
+                return think(philosopher);
+            } else if (current_state == 2) {
+                philosopher->wait_start = clock_now_ns();
+                philosopher->contended = -1;
+                philosopher->phase = PHASE_WAITING;
+                if ((delay_ns = wait_pass(philosopher)) >= 0) {
+                    return delay_ns;
+                }
+            } else if (current_state == 3) {
+                return eat(philosopher);
+            }
+            break;
+        }
     }
 
-    return NULL;
+    publish_status(philosopher);
+    philosopher->phase = PHASE_DISPATCH;
+    return blocking_mode ? 0 : 50 * NS_PER_MS;  // 50ms delay between tasks
 }
 
 void* philosopher_routine(void* arg) {
     Philosopher* philosopher = (Philosopher*)arg;
     while (atomic_load(&running)) {
-        execute_task(philosopher);
-        usleep(50000); // 50ms delay
+        clock_sleep_ns(execute_task(philosopher));
     }
+    clock_thread_exit();
+    return NULL;
+}
+
+// Edge i -> j when philosopher i waits for a chopstick that j holds. Owner
+// ids and states are read without a lock, so a scan can see a cycle that is
+// already gone; the monitor only trusts a cycle that survives two scans.
+void build_wait_for_graph() {
+    for (int i = 0; i < num_philosophers; i++) {
+        wait_for_graph.waits_for[i] = -1;
+        if (atomic_load_explicit(&philosophers[i].state, memory_order_relaxed) != 2) {
+            continue;
+        }
+        int left_chopstick_index = (i - 1 + num_philosophers) % num_philosophers;
+        int owner = atomic_load_explicit(&chopsticks[left_chopstick_index].owner, memory_order_relaxed);
+        if (owner != 0 && owner - 1 != i) {
+            wait_for_graph.waits_for[i] = owner - 1;
+        }
+    }
+}
+
+void report_cycle(int victim) {
+    char* report = NULL;
+    size_t report_size = 0;
+    FILE* out = open_memstream(&report, &report_size);
+    fprintf(out, "Deadlock detected at %.1f s: ", (double)clock_now_ns() / NS_PER_SEC);
+    int listed = wait_for_graph.cycle_length < CYCLE_DISPLAY_LIMIT ? wait_for_graph.cycle_length
+                                                                    : CYCLE_DISPLAY_LIMIT;
+    for (int i = 0; i < listed; i++) {
+        fprintf(out, "P%d -> ", wait_for_graph.cycle[i]);
+    }
+    if (listed < wait_for_graph.cycle_length) {
+        fprintf(out, "... (%d philosophers) -> ", wait_for_graph.cycle_length);
+    }
+    fprintf(out, "P%d", wait_for_graph.cycle[0]);
+    if (victim >= 0) {
+        fprintf(out, "; philosopher %d releases its chopstick", victim);
+    }
+    fprintf(out, "\n");
+    fclose(out);
+    if (write(STDOUT_FILENO, report, report_size) < 0) {
+        perror("write");
+    }
+    free(report);
+}
+
+// The cycle member that has eaten most gives up its chopstick
+int pick_victim() {
+    int victim = wait_for_graph.cycle[0];
+    for (int i = 1; i < wait_for_graph.cycle_length; i++) {
+        int member = wait_for_graph.cycle[i];
+        if (atomic_load(&philosophers[member].invoke_count) > atomic_load(&philosophers[victim].invoke_count)) {
+            victim = member;
+        }
+    }
+    return victim;
+}
+
+void* deadlock_monitor(void* arg) {
+    (void)arg;
+    int suspect = -1;   // Smallest member of the cycle seen on the previous scan
+    int reported = 0;   // That cycle was already counted
+
+    while (atomic_load(&running)) {
+        clock_sleep_ns(DEADLOCK_SCAN_NS);
+
+        long long finished = atomic_load(&recovery_finished_ns);
+        if (finished >= 0) {
+            long long started = atomic_load(&recovery_started_ns);
+            handoff_stats_record(&recovery_stats, finished - started);
+            atomic_store(&recovery_started_ns, -1);
+            atomic_store(&recovery_finished_ns, -1);
+        }
+
+        build_wait_for_graph();
+        if (wait_for_graph_find_cycle(&wait_for_graph) == 0) {
+            suspect = -1;
+            reported = 0;
+            continue;
+        }
+        int smallest = wait_for_graph.cycle[0];
+        for (int i = 1; i < wait_for_graph.cycle_length; i++) {
+            if (wait_for_graph.cycle[i] < smallest) {
+                smallest = wait_for_graph.cycle[i];
+            }
+        }
+        if (smallest != suspect) {
+            suspect = smallest;  // Confirm on the next scan
+            reported = 0;
+            continue;
+        }
+        if (reported) {
+            continue;  // Still the same deadlock; its victim has not reacted yet
+        }
+        reported = 1;
+        deadlocks_detected++;
+
+        int victim = -1;
+        if (break_deadlocks && atomic_load(&recovery_started_ns) < 0) {
+            victim = pick_victim();
+            atomic_store(&recovery_started_ns, clock_now_ns());
+            atomic_store(&philosophers[victim].must_release, 1);
+            // Cut short a blocking victim's futex wait on its left chopstick
+            futex_wake(&chopsticks[(victim - 1 + num_philosophers) % num_philosophers].owner, INT_MAX);
+        }
+        report_cycle(victim);
+    }
+    clock_thread_exit();
     return NULL;
 }
 
 void* print_status(void* arg) {
     while (atomic_load(&running)) {
         sleep(1);
-        pthread_mutex_lock(&print_mutex);
-        printf(" ");
-        for (int i = 0; i < NUM_PHILOSOPHERS * 9; i++) printf("═");
-        printf("\n");
-        printf("║");
-        for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
-            printf(" P%d      ", i);
+        int shown = num_philosophers < STATUS_DISPLAY_LIMIT ? num_philosophers : STATUS_DISPLAY_LIMIT;
+
+        // Copy the published rows, then render without holding any lock
+        StatusRecord snapshot[STATUS_DISPLAY_LIMIT];
+        for (int i = 0; i < shown; i++) {
+            status_read(&philosophers[i].status, &snapshot[i]);
         }
-        printf("║\n║");
+
+        char* frame = NULL;
+        size_t frame_size = 0;
+        FILE* out = open_memstream(&frame, &frame_size);
+        fprintf(out, " ");
+        for (int i = 0; i < shown * 9; i++) fputs("═", out);
+        fprintf(out, "\n");
+        fprintf(out, "║");
+        for (int i = 0; i < shown; i++) {
+            fprintf(out, " P%-7d", i);
+        }
+        fprintf(out, "║\n║");
 
         // Chopstick representation
-        for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
-            int left_chopstick_index = (i - 1 + NUM_PHILOSOPHERS) % NUM_PHILOSOPHERS;
-            int right_chopstick_index = i;
-            int left_taken = atomic_load(&chopsticks[left_chopstick_index]);
-            int right_taken = atomic_load(&chopsticks[right_chopstick_index]);
-
-            if (atomic_load(&philosophers[i].state) == 3) {
-                printf(" ||      "); // Eating, so has both chopsticks
-            } else if (left_taken == (i + 1) && right_taken == (i + 1)) {
-                printf(" ||      "); // Eating, so has both chopsticks
-            } else if (left_taken == (i + 1)) {
-                printf(" |_      "); // Has only left chopstick
-            } else if (right_taken == (i + 1)) {
-                printf(" _|      "); // Has only right chopstick
+        for (int i = 0; i < shown; i++) {
+            if (snapshot[i].state == 3) {
+                fprintf(out, " ||      "); // Eating, so has both chopsticks
+            } else if (snapshot[i].held == (HOLDS_LEFT | HOLDS_RIGHT)) {
+                fprintf(out, " ||      "); // Eating, so has both chopsticks
+            } else if (snapshot[i].held & HOLDS_LEFT) {
+                fprintf(out, " |_      "); // Has only left chopstick
+            } else if (snapshot[i].held & HOLDS_RIGHT) {
+                fprintf(out, " _|      "); // Has only right chopstick
             } else {
-                printf(" __      "); // No chopsticks
+                fprintf(out, " __      "); // No chopsticks
             }
         }
-        printf("║\n║");
+        fprintf(out, "║\n║");
 
         // State representation
-        for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
+        for (int i = 0; i < shown; i++) {
             char state_char;
-            switch (atomic_load(&philosophers[i].state)) {
+            switch (snapshot[i].state) {
                 case 1: state_char = 't'; break; // Thinking
                 case 2: state_char = 'w'; break; // Waiting
                 case 3: state_char = 'e'; break; // Eating
                 default: state_char = '?'; break;
             }
-            printf(" %c       ", state_char);
+            fprintf(out, " %c       ", state_char);
         }
-        printf("║\n║");
+        fprintf(out, "║\n║");
 
         // Invoke count representation
-        for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
-            printf(" %-7d ", atomic_load(&philosophers[i].invoke_count));
+        for (int i = 0; i < shown; i++) {
+            fprintf(out, " %-7d ", snapshot[i].invoke_count);
+        }
+        fprintf(out, "║\n║");
+
+        // Wait-to-eat p50 and p99, read from the live histograms
+        for (int i = 0; i < shown; i++) {
+            char p50[16];
+            latency_format(p50, sizeof(p50), latency_percentile(&wait_histograms[i], 0.5));
+            fprintf(out, " %-7s ", p50);
+        }
+        fprintf(out, "║\n║");
+        for (int i = 0; i < shown; i++) {
+            char p99[16];
+            latency_format(p99, sizeof(p99), latency_percentile(&wait_histograms[i], 0.99));
+            fprintf(out, " %-7s ", p99);
+        }
+        fprintf(out, "║\n ");
+
+        for (int i = 0; i < shown * 9; i++) fputs("═", out);
+        fprintf(out, "\n");
+        if (shown < num_philosophers) {
+            fprintf(out, "(showing %d of %d philosophers)\n", shown, num_philosophers);
         }
-        printf("║\n ");
+        LatencyHistogram all_waits = {0};
+        for (int i = 0; i < num_philosophers; i++) {
+            latency_merge(&all_waits, &wait_histograms[i]);
+        }
+        latency_print_summary(out, "Wait to eat (rows 4-5: p50, p99)", &all_waits);
 
-        for (int i = 0; i < NUM_PHILOSOPHERS * 9; i++) printf("═");
-        printf("\n");
-        pthread_mutex_unlock(&print_mutex);
+        // One write per frame keeps the table from interleaving with events
+        fclose(out);
+        if (write(STDOUT_FILENO, frame, frame_size) < 0) {
+            perror("write");
+        }
+        free(frame);
         sleep(1);
     }
     return NULL;
 }
 
-int main() {
+int main(int argc, char* argv[]) {
+    PhiloOptions options;
+    parse_options(argc, argv, &options);
+    num_philosophers = options.num_philosophers;
+    numa_placement_init(num_philosophers, options.numa);
+    philosophers = numa_alloc_ring(num_philosophers, sizeof(Philosopher));
+    wait_histograms = numa_alloc_ring(num_philosophers, sizeof(LatencyHistogram));
+    meal_target_init(&meal_target, options.meal_target, &running);
+    chopsticks = numa_alloc_ring(num_philosophers, sizeof(Chopstick));
+    blocking_mode = options.blocking;
+    pair_mode = options.acquire_pairs;
+    break_deadlocks = options.break_deadlocks;
+    wait_for_graph_init(&wait_for_graph, num_philosophers);
+    chopstick_pairs_init(&chopstick_pairs, num_philosophers);
+
     // Set up signal handling
     signal(SIGINT, handle_signal);
+    clock_init(options.time_scale, options.virtual_time);
+    if (options.virtual_time && blocking_mode) {
+        // Futex waits happen outside the clock, so virtual time could run past them
+        fprintf(stderr, "Blocking handoff is not available with virtual time; polling instead\n");
+        blocking_mode = 0;
+    }
+    if (options.workers > 0 && blocking_mode) {
+        // A futex wait would stall every philosopher sharing the worker
+        fprintf(stderr, "Blocking handoff is not available with a worker pool; polling instead\n");
+        blocking_mode = 0;
+    }
 
-    pthread_mutex_init(&print_mutex, NULL);
 
-    srand((unsigned int)time(NULL));
+    if (random_init(options.seed, options.distributions) != 0) {
+        return 1;
+    }
+    if (trace_open(options.trace_path, "deadlock", num_philosophers, num_philosophers, MAX_WAIT_NS) != 0) {
+        return 1;
+    }
 
     // Initialize philosophers
-    for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
+    for (int i = 0; i < num_philosophers; i++) {
         atomic_init(&philosophers[i].state, 1); // Initial state: thinking
         philosophers[i].philosopher_id = i;
         atomic_init(&philosophers[i].invoke_count, 0);
+        philosophers[i].phase = PHASE_DISPATCH;
     }
 
     // Initialize chopsticks (shared memory)
-    for (int i = 0; i < SHARED_MEMORY_SIZE; i++) {
-        atomic_init(&chopsticks[i], 0); // 0 means available, otherwise philosopher ID + 1
+    for (int i = 0; i < num_philosophers; i++) {
+        atomic_init(&chopsticks[i].owner, 0); // 0 means available, otherwise philosopher ID + 1
+    }
+    for (int i = 0; i < num_philosophers; i++) {
+        publish_status(&philosophers[i]);
     }
 
-    pthread_t philosopher_threads[NUM_PHILOSOPHERS];
+    pthread_t* philosopher_threads = malloc(num_philosophers * sizeof(pthread_t));
     pthread_t status_thread;
+    pthread_t monitor_thread;
+    pthread_attr_t thread_attr;
+    init_philosopher_thread_attr(&thread_attr);
 
     // Create threads
+    numa_print_placement();
+    random_print_config();
+    // Rings 0..N-1 belong to the philosophers, ring N to monitor threads
+    if (event_log_start(&event_log, num_philosophers + 1, event_formats, options.log_path) != 0) {
+        return 1;
+    }
+    clock_register_thread();  // Time stands still until everything is started
     pthread_create(&status_thread, NULL, print_status, NULL);
+    clock_register_thread();
+    pthread_create(&monitor_thread, NULL, deadlock_monitor, NULL);
+
+    TaskPool pool;
+    if (options.workers > 0) {
+        if (task_pool_start(&pool, options.workers, options.work_stealing, philosophers,
+                            sizeof(Philosopher), num_philosophers, execute_task, &running) != 0) {
+            return 1;
+        }
+    } else {
+        for (int i = 0; i < num_philosophers; i++) {
+            clock_register_thread();
+            numa_set_thread_attr(&thread_attr, i);
+            if (pthread_create(&philosopher_threads[i], &thread_attr, philosopher_routine, &philosophers[i]) != 0) {
+                fprintf(stderr, "Failed to create thread for philosopher %d\n", i);
+                return 1;
+            }
+        }
+    }
+    pthread_attr_destroy(&thread_attr);
 
-    for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
-        pthread_create(&philosopher_threads[i], NULL, philosopher_routine, &philosophers[i]);
+    StopTimer stop_timer;
+    if (options.duration_seconds > 0) {
+        clock_start_stop_timer(&stop_timer, options.duration_seconds, &running);
     }
+    clock_thread_exit();
 
     // Wait for threads to finish
-    for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
-        pthread_join(philosopher_threads[i], NULL);
+    if (options.workers > 0) {
+        task_pool_join(&pool);
+    } else {
+        for (int i = 0; i < num_philosophers; i++) {
+            pthread_join(philosopher_threads[i], NULL);
+        }
     }
+    pthread_join(monitor_thread, NULL);
     pthread_join(status_thread, NULL);
+    event_log_stop(&event_log);
 
     // Cleanup
-    pthread_mutex_destroy(&print_mutex);
 
     printf("\nProgram terminated successfully\n");
     printf("\nFinal Status:\n");
-    for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
+    for (int i = 0; i < num_philosophers; i++) {
         printf("Philosopher %d - State: %d, Invoke count: %d\n",
                i,
                atomic_load(&philosophers[i].state),
                atomic_load(&philosophers[i].invoke_count));
     }
+
+    HandoffStats handoff_totals = {0};
+    LatencyHistogram wait_totals = {0};
+    FairnessIndex fairness = {0};
+    long long total_meals = 0;
+    for (int i = 0; i < num_philosophers; i++) {
+        handoff_stats_merge(&handoff_totals, &philosophers[i].handoff);
+        latency_merge(&wait_totals, &wait_histograms[i]);
+        fairness_add(&fairness, atomic_load(&philosophers[i].invoke_count));
+        total_meals += atomic_load(&philosophers[i].invoke_count);
+    }
+    long long end_ns = clock_end_ns();
+    print_meal_throughput(total_meals, end_ns);
+    print_handoff_stats(&handoff_totals, blocking_mode);
+    bench_report(&options, "deadlock", blocking_mode, total_meals, &wait_totals, fairness_jain(&fairness), end_ns);
+    printf("Deadlocks: %lld detected, %lld recovered", deadlocks_detected, recovery_stats.count);
+    if (recovery_stats.count > 0) {
+        printf(", detection to next meal mean %.1f ms, max %.1f ms",
+               (double)recovery_stats.total_ns / recovery_stats.count / NS_PER_MS,
+               (double)recovery_stats.max_ns / NS_PER_MS);
+    }
+    printf("\n");
+    trace_close();
+
+    free(philosopher_threads);
+    numa_free_ring(wait_histograms, num_philosophers, sizeof(LatencyHistogram));
+    wait_for_graph_destroy(&wait_for_graph);
+    chopstick_pairs_destroy(&chopstick_pairs);
+    numa_free_ring(chopsticks, num_philosophers, sizeof(Chopstick));
+    numa_free_ring(philosophers, num_philosophers, sizeof(Philosopher));
     return 0;
 }
@@ -1,3 +1,4 @@
+#define _GNU_SOURCE  // mremap() for the memory-mapped event log
 #include <stdio.h>
 #include <stdlib.h>
 #include <pthread.h>
@@ -5,15 +6,42 @@
 #include <time.h>
 #include <stdatomic.h>
 #include <signal.h>
+#include <sys/wait.h>
+
+#include "philo_common.h"
+#include "philo_random.h"
+#include "futex_handoff.h"
+#include "event_log.h"
+#include "sim_clock.h"
+#include "chopstick_pairs.h"
+#include "arbitration.h"
+#include "status_snapshot.h"
+#include "count_tracker.h"
+#include "numa_placement.h"
+#include "task_pool.h"
+#include "bench_report.h"
+#include "shared_memory.h"
 
-#define NUM_PHILOSOPHERS 5
 #define MAX_WAIT_TIME 6
-#define SHARED_MEMORY_SIZE 5  // Number of shared memory cells for chopsticks
+#define MAX_WAIT_NS (MAX_WAIT_TIME * NS_PER_SEC)
 
 // Forward declarations
 void* philosopher_routine(void* arg);
 void* print_status(void* arg);
-void* execute_task(void* arg);
+long long execute_task(void* arg);
+
+// Event log records, formatted by the writer thread
+enum {
+    EVENT_EATING,
+    EVENT_THINKING,
+    EVENT_WAITED_TOO_LONG,
+};
+
+static const char* const event_formats[] = {
+    [EVENT_EATING] = "Philosopher %d is eating.\n",
+    [EVENT_THINKING] = "Philosopher %d is thinking.\n",
+    [EVENT_WAITED_TOO_LONG] = "Philosopher %d waited too long and returned to thinking.\n",
+};
 
 // Global variables
 atomic_int should_print = 0;
@@ -21,41 +49,45 @@ atomic_int running = 1;
 
 // Philosopher structure
 typedef struct {
-    atomic_int state;         // 1:thinking, 2:waiting, 3:eating
+    _Alignas(CACHE_LINE_SIZE) atomic_int state;         // 1:thinking, 2:waiting, 3:eating
     int philosopher_id;       // ID number
     atomic_int invoke_count;  // Times eaten
     atomic_int must_think;    // Fairness control
-    time_t wait_start;       // Wait timestamp
-} Philosopher;
-
-Philosopher philosophers[NUM_PHILOSOPHERS];
-pthread_mutex_t print_mutex;
+    long long wait_start;  // Wait timestamp (simulated ns)
+    TaskPhase phase;          // Where execute_task() resumes
+    int try_after_think;      // think() is followed by try_to_wait()
+    int contended;            // Chopstick busy on the last failed attempt, -1 if none
+    HandoffStats handoff;     // Release-to-acquire latency, owner thread only
+    StatusSlot status;        // Published copy read by print_status()
+} Philosopher;  // Padded to a cache line so neighbours never share one
+
+int num_philosophers = DEFAULT_NUM_PHILOSOPHERS;
+Philosopher* philosophers;
+CountTracker* meal_counts;  // Running minimum of invoke_count for get_lowest_count()
+EventLog event_log;  // Per-philosopher rings drained by one writer thread
+LatencyHistogram* wait_histograms;  // Wait-to-eat time per philosopher, owner thread only
+MealTarget* meal_target;            // -m: total meals after which the run stops
 pthread_mutex_t state_mutex;
-atomic_int chopsticks[SHARED_MEMORY_SIZE]; // Shared memory for chopsticks
-
-// Signal handler
+Chopstick* chopsticks; // Shared memory for chopsticks (a POSIX shm segment with -F)
+int blocking_mode = 0;
+ChopstickPairs chopstick_pairs;  // Bitmap view of chopsticks[] used by -a pair
+Arbiter arbiter;                 // -P: decides who gets the chopsticks
+ResourceGraph resource_graph;    // -T: which chopsticks each philosopher needs
+int process_mode = 0;            // -F: philosophers are forked processes
+pid_t* philosopher_pids;
+
+// Signal handler. In process mode SIGCHLD means a philosopher process
+// stopped (it reached the -m target, or crashed), which ends the run.
 void handle_signal(int sig) {
-    if (sig == SIGINT) {
+    if (sig == SIGINT || sig == SIGCHLD) {
         atomic_store(&running, 0);
+        clock_interrupt_from_signal();
     }
 }
 
 // Utility functions
-int get_random(int min, int max) {
-    int result = 0, low_num = 0, hi_num = 0;
-    if (min < max) {
-        low_num = min;
-        hi_num = max + 1;
-    } else {
-        low_num = max + 1;
-        hi_num = min;
-    }
-    result = (rand() % (hi_num - low_num)) + low_num;
-    return result;
-}
-
 int is_anyone_eating() {
-    for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
+    for (int i = 0; i < num_philosophers; i++) {
         if (atomic_load(&philosophers[i].state) == 3) {
             return 1;
         }
@@ -63,250 +95,596 @@ int is_anyone_eating() {
     return 0;
 }
 
-int get_lowest_count() {
+int get_lowest_count(void) {
+    int tracked = count_tracker_lowest(meal_counts);
+    if (tracked >= 0) {
+        return tracked;
+    }
+
+    // Counts spread past the tracker window; fall back to a full scan
     int lowest = atomic_load(&philosophers[0].invoke_count);
-    for (int i = 1; i < NUM_PHILOSOPHERS; i++) {
+    for (int i = 1; i < num_philosophers; i++) {
         int current = atomic_load(&philosophers[i].invoke_count);
         if (current < lowest) {
             lowest = current;
         }
     }
+    count_tracker_raise_floor(meal_counts, lowest);
     return lowest;
 }
 
-// Philosopher actions
-void eat(Philosopher* philosopher) {
-    int left_chopstick_index = (philosopher->philosopher_id - 1 + NUM_PHILOSOPHERS) % NUM_PHILOSOPHERS;
-    int right_chopstick_index = philosopher->philosopher_id;
+int get_meal_count(int philosopher) {
+    return atomic_load(&philosophers[philosopher].invoke_count);
+}
 
-    pthread_mutex_lock(&print_mutex);
-    printf("Philosopher %d is eating.\n", philosopher->philosopher_id);
-    pthread_mutex_unlock(&print_mutex);
+// All chopsticks granted: record the handoff and the wait, then eat
+void start_eating(Philosopher* philosopher) {
+    if (philosopher->contended >= 0) {
+        handoff_stats_record(&philosopher->handoff,
+                             monotonic_ns() - atomic_load(&chopsticks[philosopher->contended].released_ns));
+    }
+    latency_record(&wait_histograms[philosopher->philosopher_id], clock_now_ns() - philosopher->wait_start, 0);
+    atomic_store(&philosopher->state, 3);
+}
 
-    sleep(get_random(1, 4));  // 1-4 seconds
+// Publish this philosopher's row of the status table (owner thread only)
+void publish_status(Philosopher* philosopher) {
+    int owner_id = philosopher->philosopher_id + 1;
+    const int* row = resource_graph_row(&resource_graph, philosopher->philosopher_id);
+    StatusRecord record = {
+        .state = atomic_load(&philosopher->state),
+        .invoke_count = atomic_load(&philosopher->invoke_count),
+        .must_think = atomic_load(&philosopher->must_think),
+    };
+    // Ring rows are [left, right]; elsewhere only the number held is shown
+    for (int i = 0; i < resource_graph_degree(&resource_graph, philosopher->philosopher_id); i++) {
+        if (atomic_load(&chopsticks[row[i]].owner) == owner_id) {
+            record.held += resource_graph.is_ring ? (i == 0 ? HOLDS_LEFT : HOLDS_RIGHT) : 1;
+        }
+    }
+    status_publish(&philosopher->status, &record);
+}
 
-    atomic_fetch_add(&philosopher->invoke_count, 1);
+// Philosopher actions. Each returns how long the philosopher now sleeps;
+// execute_task() resumes in the matching phase afterwards.
+long long eat(Philosopher* philosopher) {
+    log_event(&event_log, philosopher->philosopher_id, EVENT_EATING);
+
+    philosopher->phase = PHASE_ATE;
+    return random_eat_ns(1, 4);  // 1-4 seconds
+}
+
+void finish_eating(Philosopher* philosopher) {
+    int previous_count = atomic_fetch_add(&philosopher->invoke_count, 1);
+    count_tracker_increment(meal_counts, previous_count);
 
     // Check if this philosopher needs to think more after eating
-    int lowest = get_lowest_count();
-    if (atomic_load(&philosopher->invoke_count) > lowest + 2) {
+    if (arbiter.policy->on_tick(&arbiter, philosopher->philosopher_id)) {
         atomic_store(&philosopher->must_think, 1);
     }
 
     atomic_store(&philosopher->state, 1);
 
     // Release the chopsticks
-    atomic_store(&chopsticks[left_chopstick_index], 0);
-    atomic_store(&chopsticks[right_chopstick_index], 0);
+    arbiter.policy->on_release(&arbiter, philosopher->philosopher_id);
+    meal_target_count(meal_target);
 }
 
-void think(Philosopher* philosopher) {
-    pthread_mutex_lock(&print_mutex);
-    printf("Philosopher %d is thinking.\n", philosopher->philosopher_id);
-    pthread_mutex_unlock(&print_mutex);
+long long think(Philosopher* philosopher) {
+    log_event(&event_log, philosopher->philosopher_id, EVENT_THINKING);
 
-    sleep(get_random(2, 5));  // 2-5 seconds
+    philosopher->phase = PHASE_THOUGHT;
+    return random_think_ns(2, 5);  // 2-5 seconds
 }
 
 void try_to_wait(Philosopher* philosopher) {
-    int right_chopstick_index = philosopher->philosopher_id;
-    int expected = 0;
-
-    if (atomic_compare_exchange_weak(&chopsticks[right_chopstick_index], &expected, philosopher->philosopher_id + 1)) {
-        atomic_store(&philosopher->state, 2);
+    int contended;
+
+    philosopher->wait_start = clock_now_ns();
+    philosopher->contended = -1;
+    switch (arbiter.policy->on_request(&arbiter, philosopher->philosopher_id, 1, &contended)) {
+        case ARBITRATION_GRANTED:
+            start_eating(philosopher);
+            break;
+        case ARBITRATION_WAIT:
+            philosopher->contended = contended;
+            atomic_store(&philosopher->state, 2);
+            break;
+        case ARBITRATION_REFUSED:
+            break;
     }
 }
 
-void wait(Philosopher* philosopher) {
-    int left_chopstick_index = (philosopher->philosopher_id - 1 + NUM_PHILOSOPHERS) % NUM_PHILOSOPHERS;
-    int right_chopstick_index = philosopher->philosopher_id;
-    
-    // Set wait start time when entering waiting state
-    philosopher->wait_start = time(NULL);
-    
-    while (atomic_load(&running) && atomic_load(&philosophers[philosopher->philosopher_id].state) == 2) {
-        // Check if waiting time exceeded MAX_WAIT_TIME seconds
-        if (time(NULL) - philosopher->wait_start > MAX_WAIT_TIME) {
-            // Release right chopstick
-            atomic_store(&chopsticks[right_chopstick_index], 0);
-            // Return to thinking state
-            atomic_store(&philosopher->state, 1);
-            
-            pthread_mutex_lock(&print_mutex);
-            printf("Philosopher %d waited too long and returned to thinking.\n", philosopher->philosopher_id);
-            pthread_mutex_unlock(&print_mutex);
-            
-            return;
-        }
+// One pass of wait()'s retry loop. Returns the delay before the next pass,
+// or -1 once waiting is over (eating, or back to thinking).
+long long wait_pass(Philosopher* philosopher) {
+    const ArbitrationPolicy* policy = arbiter.policy;
+    int contended;
 
-        // Attempt to acquire the left chopstick
-        int expected_left = 0;
+    // Check if waiting time exceeded MAX_WAIT_TIME seconds
+    long long waited_ns = clock_now_ns() - philosopher->wait_start;
+    if (policy->uses_timeout && waited_ns > MAX_WAIT_NS) {
+        latency_record(&wait_histograms[philosopher->philosopher_id], waited_ns, 1);
+        policy->on_abandon(&arbiter, philosopher->philosopher_id);
+        // Return to thinking state
+        atomic_store(&philosopher->state, 1);
 
-        if (atomic_load(&chopsticks[left_chopstick_index]) == 0) {
-            if (atomic_compare_exchange_weak(&chopsticks[left_chopstick_index], &expected_left, philosopher->philosopher_id + 1)) {
-                atomic_store(&philosopher->state, 3);
-                return;
-            }
+        log_event(&event_log, philosopher->philosopher_id, EVENT_WAITED_TOO_LONG);
+
+        return -1;
+    }
+
+    if (policy->on_request(&arbiter, philosopher->philosopher_id, 0, &contended) == ARBITRATION_GRANTED) {
+        start_eating(philosopher);
+        return -1;
+    }
+    if (contended >= 0) {
+        philosopher->contended = contended;
+    }
+
+    if (blocking_mode && contended >= 0) {
+        // Sleep until the chopstick changes hands, rechecking timeout and shutdown
+        long long timeout_ns = NS_PER_SEC;
+        if (policy->uses_timeout) {
+            long long remaining_ns = clock_real_timeout_ns(philosopher->wait_start + MAX_WAIT_NS + 1 - clock_now_ns());
+            timeout_ns = remaining_ns < timeout_ns ? remaining_ns : timeout_ns;
+        }
+        if (arbiter_block(&arbiter, contended, timeout_ns) == 0) {
+            return 0;
         }
-        usleep(50000); // Wait a bit before retrying
+        return NS_PER_MS;  // Free but spoken for; it changes hands without a wakeup
     }
+    return 50 * NS_PER_MS; // Wait a bit before retrying
 }
 
-void* execute_task(void* arg) {
+// Run the philosopher up to its next sleep and return that sleep in
+// simulated ns. The caller sleeps (its own thread, or a pool timer) and
+// calls again; phase records where to pick up.
+long long execute_task(void* arg) {
     Philosopher* philosopher = (Philosopher*)arg;
-    int current_state = atomic_load(&philosopher->state);
+    long long delay_ns;
 
-    // Check if philosopher has eaten too much compared to others
-    int lowest = get_lowest_count();
-    if (atomic_load(&philosopher->invoke_count) > lowest + 2) {
-        atomic_store(&philosopher->must_think, 1);
-    } else {
-        atomic_store(&philosopher->must_think, 0);
-    }
+    switch (philosopher->phase) {
+        case PHASE_THOUGHT:
+            if (philosopher->try_after_think) {
+                try_to_wait(philosopher);
+            }
+            break;
+        case PHASE_ATE:
+            finish_eating(philosopher);
+            break;
+        case PHASE_WAITING:
+            if ((delay_ns = wait_pass(philosopher)) >= 0) {
+                return delay_ns;
+            }
+            break;
+        case PHASE_DISPATCH: {
+            int current_state = atomic_load(&philosopher->state);
 
-    // If must_think is set and not already waiting, force thinking
-    if (atomic_load(&philosopher->must_think) && current_state != 2) {
-        think(philosopher);
-        return NULL;
-    }
+            // Check if philosopher has eaten too much compared to others
+            if (arbiter.policy->on_tick(&arbiter, philosopher->philosopher_id)) {
+                atomic_store(&philosopher->must_think, 1);
+            } else {
+                atomic_store(&philosopher->must_think, 0);
+            }
 
-    if (current_state == 1) {
-        think(philosopher);
-        try_to_wait(philosopher);
-    } else if (current_state == 2) {
-        wait(philosopher);
-    } else if (current_state == 3) {
-        eat(philosopher);
+            // If must_think is set and not already waiting, force thinking
+            if (atomic_load(&philosopher->must_think) && current_state != 2) {
+                philosopher->try_after_think = 0;
+                return think(philosopher);
+            }
+
+            if (current_state == 1) {
+                philosopher->try_after_think = 1;
+                return think(philosopher);
+            } else if (current_state == 2) {
+                // try_to_wait() started the wait clock when hunger set in
+                philosopher->phase = PHASE_WAITING;
+                if ((delay_ns = wait_pass(philosopher)) >= 0) {
+                    return delay_ns;
+                }
+            } else if (current_state == 3) {
+                return eat(philosopher);
+            }
+            break;
+        }
     }
 
-    return NULL;
+    publish_status(philosopher);
+    philosopher->phase = PHASE_DISPATCH;
+    return blocking_mode ? 0 : 50 * NS_PER_MS;  // 50ms delay between tasks
 }
 
 void* philosopher_routine(void* arg) {
     Philosopher* philosopher = (Philosopher*)arg;
     while (atomic_load(&running)) {
-        execute_task(philosopher);
-        usleep(50000); // 50ms delay
+        clock_sleep_ns(execute_task(philosopher));
     }
+    clock_thread_exit();
     return NULL;
 }
 
+// Per-philosopher tables go where every philosopher can reach them: the
+// shared segment in process mode, NUMA-placed memory otherwise
+void* alloc_table(size_t count, size_t element_size) {
+    return process_mode ? shared_alloc(count, element_size) : numa_alloc_ring(count, element_size);
+}
+
+void free_table(void* memory, size_t count, size_t element_size) {
+    if (!shared_memory_contains(memory)) {
+        numa_free_ring(memory, count, element_size);
+    }
+}
+
+// Fork one process per philosopher. Each runs the same philosopher_routine()
+// as a thread would, on the chopsticks and state table in shared memory.
+int start_philosopher_processes(void) {
+    philosopher_pids = malloc(num_philosophers * sizeof(pid_t));
+    fflush(stdout);  // Or every child inherits the unwritten output
+    for (int i = 0; i < num_philosophers; i++) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            perror("fork");
+            fprintf(stderr, "Failed to create process for philosopher %d\n", i);
+            atomic_store(&running, 0);
+            for (int j = 0; j < i; j++) {
+                kill(philosopher_pids[j], SIGINT);
+                waitpid(philosopher_pids[j], NULL, 0);
+            }
+            return -1;
+        }
+        if (pid == 0) {
+            random_fork_stream(i);
+            philosopher_routine(&philosophers[i]);
+            _exit(0);  // Skip exit handlers and stdio buffers that belong to the parent
+        }
+        philosopher_pids[i] = pid;
+    }
+    return 0;
+}
+
+// Sleep until -d, -m, Ctrl+C or a philosopher process ends the run, then
+// stop the others and collect them all
+void join_philosopher_processes(void) {
+    while (atomic_load(&running)) {
+        clock_sleep_ns(NS_PER_SEC);
+    }
+    for (int i = 0; i < num_philosophers; i++) {
+        kill(philosopher_pids[i], SIGINT);
+    }
+    for (int i = 0; i < num_philosophers; i++) {
+        int status;
+        if (waitpid(philosopher_pids[i], &status, 0) < 0) {
+            perror("waitpid");
+        } else if (WIFSIGNALED(status) && WTERMSIG(status) != SIGINT) {
+            fprintf(stderr, "Philosopher %d's process was killed by signal %d\n", i, WTERMSIG(status));
+        } else if (WIFEXITED(status) && WEXITSTATUS(status) != 0) {
+            fprintf(stderr, "Philosopher %d's process exited with status %d\n", i, WEXITSTATUS(status));
+        }
+    }
+    philosopher_processes_cpu_seconds = rusage_cpu_seconds(RUSAGE_CHILDREN);
+    free(philosopher_pids);
+}
+
 void* print_status(void* arg) {
     while (atomic_load(&running)) {
         sleep(1);
-        pthread_mutex_lock(&print_mutex);
-        printf(" ");
-        for (int i = 0; i < NUM_PHILOSOPHERS * 9; i++) printf("═");
-        printf("\n");
-        printf("║");
-        for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
-            printf(" P%d      ", i);
+        int shown = num_philosophers < STATUS_DISPLAY_LIMIT ? num_philosophers : STATUS_DISPLAY_LIMIT;
+
+        // Copy the published rows, then render without holding any lock
+        StatusRecord snapshot[STATUS_DISPLAY_LIMIT];
+        for (int i = 0; i < shown; i++) {
+            status_read(&philosophers[i].status, &snapshot[i]);
+        }
+
+        char* frame = NULL;
+        size_t frame_size = 0;
+        FILE* out = open_memstream(&frame, &frame_size);
+        fprintf(out, " ");
+        for (int i = 0; i < shown * 9; i++) fputs("═", out);
+        fprintf(out, "\n");
+        fprintf(out, "║");
+        for (int i = 0; i < shown; i++) {
+            fprintf(out, " P%-7d", i);
         }
-        printf("║\n║");
+        fprintf(out, "║\n║");
 
         // Chopstick representation
-        for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
-            int left_chopstick_index = (i - 1 + NUM_PHILOSOPHERS) % NUM_PHILOSOPHERS;
-            int right_chopstick_index = i;
-            int left_taken = atomic_load(&chopsticks[left_chopstick_index]);
-            int right_taken = atomic_load(&chopsticks[right_chopstick_index]);
-
-            if (atomic_load(&philosophers[i].state) == 3) {
-                printf(" ||      "); // Eating, so has both chopsticks
-            } else if (left_taken == (i + 1) && right_taken == (i + 1)) {
-                printf(" ||      "); // Eating, so has both chopsticks
-            } else if (left_taken == (i + 1)) {
-                printf(" |_      "); // Has only left chopstick
-            } else if (right_taken == (i + 1)) {
-                printf(" _|      "); // Has only right chopstick
+        for (int i = 0; i < shown; i++) {
+            if (!resource_graph.is_ring) {
+                char held[16];
+                snprintf(held, sizeof(held), "%d/%d", snapshot[i].state == 3 ? resource_graph_degree(&resource_graph, i)
+                                                                             : snapshot[i].held,
+                         resource_graph_degree(&resource_graph, i));
+                fprintf(out, " %-7s ", held); // Chopsticks held out of those needed
+            } else if (snapshot[i].state == 3) {
+                fprintf(out, " ||      "); // Eating, so has both chopsticks
+            } else if (snapshot[i].held == (HOLDS_LEFT | HOLDS_RIGHT)) {
+                fprintf(out, " ||      "); // Eating, so has both chopsticks
+            } else if (snapshot[i].held & HOLDS_LEFT) {
+                fprintf(out, " |_      "); // Has only left chopstick
+            } else if (snapshot[i].held & HOLDS_RIGHT) {
+                fprintf(out, " _|      "); // Has only right chopstick
             } else {
-                printf(" __      "); // No chopsticks
+                fprintf(out, " __      "); // No chopsticks
             }
         }
-        printf("║\n║");
+        fprintf(out, "║\n║");
 
         // State representation
-        for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
+        for (int i = 0; i < shown; i++) {
             char state_char;
-            switch (atomic_load(&philosophers[i].state)) {
+            switch (snapshot[i].state) {
                 case 1: state_char = 't'; break; // Thinking
                 case 2: state_char = 'w'; break; // Waiting
                 case 3: state_char = 'e'; break; // Eating
                 default: state_char = '?'; break;
             }
-            printf(" %c       ", state_char);
+            fprintf(out, " %c       ", state_char);
         }
-        printf("║\n║");
+        fprintf(out, "║\n║");
 
         // Invoke count representation
-        for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
-            printf(" %-7d ", atomic_load(&philosophers[i].invoke_count));
+        for (int i = 0; i < shown; i++) {
+            fprintf(out, " %-7d ", snapshot[i].invoke_count);
         }
-        printf("║\n ");
+        fprintf(out, "║\n║");
 
-        for (int i = 0; i < NUM_PHILOSOPHERS * 9; i++) printf("═");
-        printf("\n");
+        // Wait-to-eat p50 and p99, read from the live histograms
+        for (int i = 0; i < shown; i++) {
+            char p50[16];
+            latency_format(p50, sizeof(p50), latency_percentile(&wait_histograms[i], 0.5));
+            fprintf(out, " %-7s ", p50);
+        }
+        fprintf(out, "║\n║");
+        for (int i = 0; i < shown; i++) {
+            char p99[16];
+            latency_format(p99, sizeof(p99), latency_percentile(&wait_histograms[i], 0.99));
+            fprintf(out, " %-7s ", p99);
+        }
+        fprintf(out, "║\n ");
+
+        for (int i = 0; i < shown * 9; i++) fputs("═", out);
+        fprintf(out, "\n");
+        if (shown < num_philosophers) {
+            fprintf(out, "(showing %d of %d philosophers)\n", shown, num_philosophers);
+        }
+        LatencyHistogram all_waits = {0};
+        for (int i = 0; i < num_philosophers; i++) {
+            latency_merge(&all_waits, &wait_histograms[i]);
+        }
+        latency_print_summary(out, "Wait to eat (rows 4-5: p50, p99)", &all_waits);
 
         // Fairness information
-        printf("Lowest meal count: %d\n", get_lowest_count());
-        printf("Must think: ");
-        for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
-            printf("%d ", atomic_load(&philosophers[i].must_think));
+        fprintf(out, "Lowest meal count: %d\n", get_lowest_count());
+        fprintf(out, "Must think: ");
+        for (int i = 0; i < shown; i++) {
+            fprintf(out, "%d ", snapshot[i].must_think);
+        }
+        fprintf(out, "\n\n");
+
+        // One write per frame keeps the table from interleaving with events
+        fclose(out);
+        if (write(STDOUT_FILENO, frame, frame_size) < 0) {
+            perror("write");
         }
-        printf("\n\n");
-        
-        pthread_mutex_unlock(&print_mutex);
+        free(frame);
         sleep(1);
     }
     return NULL;
 }
 
-int main() {
+int main(int argc, char* argv[]) {
+    PhiloOptions options;
+    parse_options(argc, argv, &options);
+    if (resource_graph_build(&resource_graph, options.topology, options.num_philosophers, options.seed) != 0) {
+        return 1;
+    }
+    if (resource_graph.num_processes > MAX_NUM_PHILOSOPHERS) {
+        fprintf(stderr, "Topology has %d philosophers; at most %d are supported\n",
+                resource_graph.num_processes, MAX_NUM_PHILOSOPHERS);
+        return 1;
+    }
+    // Grids and files fix the number of philosophers themselves
+    num_philosophers = options.num_philosophers = resource_graph.num_processes;
+    process_mode = options.processes;
+    if (process_mode && (options.virtual_time || options.workers > 0)) {
+        // Both schedule every philosopher from inside one process
+        fprintf(stderr, "Process mode cannot be combined with virtual time or a worker pool\n");
+        return 1;
+    }
+    if (process_mode && options.numa) {
+        fprintf(stderr, "NUMA placement is not available in process mode; ignoring -N\n");
+        options.numa = 0;
+    }
+    // Everything the philosophers share is allocated after this, before the fork
+    if (process_mode && shared_memory_open() != 0) {
+        return 1;
+    }
+    numa_placement_init(num_philosophers, options.numa);
+    philosophers = alloc_table(num_philosophers, sizeof(Philosopher));
+    wait_histograms = alloc_table(num_philosophers, sizeof(LatencyHistogram));
+    meal_counts = shared_alloc(1, sizeof(CountTracker));
+    meal_target = shared_alloc(1, sizeof(MealTarget));
+    meal_target_init(meal_target, options.meal_target, &running);
+    chopsticks = alloc_table(resource_graph.num_resources, sizeof(Chopstick));
+    blocking_mode = options.blocking;
+    chopstick_pairs_init(&chopstick_pairs, resource_graph.num_resources);
+    const ArbitrationPolicy* policy = find_arbitration_policy(options.arbitration ? options.arbitration : "fairness");
+    if (policy == NULL) {
+        return 1;
+    }
+    if (options.acquire_pairs && strcmp(policy->name, "fairness") != 0) {
+        // The other policies decide themselves how both chopsticks are taken
+        fprintf(stderr, "Pair acquisition only applies to the fairness policy; ignoring -a pair\n");
+        options.acquire_pairs = 0;
+    }
+    for (int r = 0; r < resource_graph.num_resources && is_chandy_misra(policy); r++) {
+        // Clean chopsticks are never handed over, so a third sharer can close a cycle
+        if (resource_graph.sharer_offsets[r + 1] - resource_graph.sharer_offsets[r] > 2) {
+            fprintf(stderr, "Chandy-Misra needs every chopstick shared by at most two philosophers "
+                            "(chopstick %d has more)\n", r);
+            return 1;
+        }
+    }
+    int all_pairs = 1;
+    for (int i = 0; i < resource_graph.num_processes; i++) {
+        all_pairs = all_pairs && resource_graph_degree(&resource_graph, i) == 2;
+    }
+    if (options.acquire_pairs && !all_pairs) {
+        fprintf(stderr, "Pair acquisition needs exactly two chopsticks per philosopher; ignoring -a pair\n");
+        options.acquire_pairs = 0;
+    }
+
     signal(SIGINT, handle_signal);
-    pthread_mutex_init(&print_mutex, NULL);
-    srand((unsigned int)time(NULL));
+    if (process_mode) {
+        signal(SIGCHLD, handle_signal);
+    }
+    clock_init(options.time_scale, options.virtual_time);
+    if (options.virtual_time && blocking_mode) {
+        // Futex waits happen outside the clock, so virtual time could run past them
+        fprintf(stderr, "Blocking handoff is not available with virtual time; polling instead\n");
+        blocking_mode = 0;
+    }
+    if (options.workers > 0 && blocking_mode) {
+        // A futex wait would stall every philosopher sharing the worker
+        fprintf(stderr, "Blocking handoff is not available with a worker pool; polling instead\n");
+        blocking_mode = 0;
+    }
+    if (random_init(options.seed, options.distributions) != 0) {
+        return 1;
+    }
+
+    count_tracker_init(meal_counts, num_philosophers);
 
     // Initialize philosophers
-    for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
+    for (int i = 0; i < num_philosophers; i++) {
         atomic_init(&philosophers[i].state, 1); // Initial state: thinking
         philosophers[i].philosopher_id = i;
         atomic_init(&philosophers[i].invoke_count, 0);
         atomic_init(&philosophers[i].must_think, 0); // Initialize must_think to 0
+        philosophers[i].phase = PHASE_DISPATCH;
     }
 
     // Initialize chopsticks
-    for (int i = 0; i < SHARED_MEMORY_SIZE; i++) {
-        atomic_init(&chopsticks[i], 0);
+    arbiter_init(&arbiter, policy, &resource_graph, chopsticks, get_meal_count, get_lowest_count,
+                 &chopstick_pairs, options.acquire_pairs);
+    for (int i = 0; i < num_philosophers; i++) {
+        publish_status(&philosophers[i]);
     }
 
-    pthread_t philosopher_threads[NUM_PHILOSOPHERS];
+    pthread_t* philosopher_threads = malloc(num_philosophers * sizeof(pthread_t));
     pthread_t status_thread;
+    pthread_attr_t thread_attr;
+    init_philosopher_thread_attr(&thread_attr);
 
     printf("Starting dining philosophers simulation (with fairness)\n");
-    printf("Number of philosophers: %d\n", NUM_PHILOSOPHERS);
+    printf("Number of philosophers: %d\n", num_philosophers);
+    numa_print_placement();
+    random_print_config();
+    printf("Arbitration: %s (%s)\n", policy->name, policy->description);
+    if (!resource_graph.is_ring) {
+        printf("Topology: %s (%d chopsticks, up to %d per philosopher)\n", options.topology,
+               resource_graph.num_resources, resource_graph.max_degree);
+    }
+    if (options.workers > 0) {
+        printf("Worker threads: %d\n", options.workers < num_philosophers ? options.workers : num_philosophers);
+    }
+    if (process_mode) {
+        printf("Philosopher processes: %d (POSIX shared memory, process-shared futexes)\n", num_philosophers);
+    }
     printf("Press Ctrl+C to terminate the program\n\n");
 
+    // Rings 0..N-1 belong to the philosophers, ring N to monitor threads
+    if (event_log_start(&event_log, num_philosophers + 1, event_formats, options.log_path) != 0) {
+        return 1;
+    }
     pthread_create(&status_thread, NULL, print_status, NULL);
 
-    for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
-        pthread_create(&philosopher_threads[i], NULL, philosopher_routine, &philosophers[i]);
+    clock_register_thread();  // Time stands still until everything is started
+    TaskPool pool;
+    if (options.workers > 0) {
+        if (task_pool_start(&pool, options.workers, options.work_stealing, philosophers,
+                            sizeof(Philosopher), num_philosophers, execute_task, &running) != 0) {
+            return 1;
+        }
+    } else if (process_mode) {
+        if (start_philosopher_processes() != 0) {
+            return 1;
+        }
+    } else {
+        for (int i = 0; i < num_philosophers; i++) {
+            clock_register_thread();
+            numa_set_thread_attr(&thread_attr, i);
+            if (pthread_create(&philosopher_threads[i], &thread_attr, philosopher_routine, &philosophers[i]) != 0) {
+                fprintf(stderr, "Failed to create thread for philosopher %d\n", i);
+                return 1;
+            }
+        }
     }
+    pthread_attr_destroy(&thread_attr);
 
-    for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
-        pthread_join(philosopher_threads[i], NULL);
+    StopTimer stop_timer;
+    if (options.duration_seconds > 0) {
+        clock_start_stop_timer(&stop_timer, options.duration_seconds, &running);
+    }
+    clock_thread_exit();
+
+    if (options.workers > 0) {
+        task_pool_join(&pool);
+    } else if (process_mode) {
+        join_philosopher_processes();
+    } else {
+        for (int i = 0; i < num_philosophers; i++) {
+            pthread_join(philosopher_threads[i], NULL);
+        }
     }
     pthread_join(status_thread, NULL);
+    event_log_stop(&event_log);
 
-    pthread_mutex_destroy(&print_mutex);
 
     printf("\nProgram terminated successfully\n");
     printf("\nFinal Status:\n");
-    for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
+    for (int i = 0; i < num_philosophers; i++) {
         printf("Philosopher %d - State: %d, Times eaten: %d, Must think: %d\n",
                i,
                atomic_load(&philosophers[i].state),
                atomic_load(&philosophers[i].invoke_count),
                atomic_load(&philosophers[i].must_think));
     }
+
+    HandoffStats handoff_totals = {0};
+    LatencyHistogram wait_totals = {0};
+    FairnessIndex fairness = {0};
+    long long total_meals = 0;
+    for (int i = 0; i < num_philosophers; i++) {
+        handoff_stats_merge(&handoff_totals, &philosophers[i].handoff);
+        latency_merge(&wait_totals, &wait_histograms[i]);
+        fairness_add(&fairness, atomic_load(&philosophers[i].invoke_count));
+        total_meals += atomic_load(&philosophers[i].invoke_count);
+    }
+    long long end_ns = clock_end_ns();
+    print_meal_throughput(total_meals, end_ns);
+    print_handoff_stats(&handoff_totals, blocking_mode);
+    arbiter_print_acquire_stats(&arbiter);
+    // The default policy keeps the historical "frame" name in results files
+    char policy_name[64];
+    if (strcmp(policy->name, "fairness") == 0) {
+        snprintf(policy_name, sizeof(policy_name), "frame");
+    } else {
+        snprintf(policy_name, sizeof(policy_name), "frame-%s", policy->name);
+    }
+    bench_report(&options, policy_name, blocking_mode, total_meals, &wait_totals, fairness_jain(&fairness), end_ns);
+
+    free(philosopher_threads);
+    free_table(wait_histograms, num_philosophers, sizeof(LatencyHistogram));
+    shared_free(meal_target);
+    shared_free(meal_counts);
+    arbiter_destroy(&arbiter);
+    chopstick_pairs_destroy(&chopstick_pairs);
+    free_table(chopsticks, resource_graph.num_resources, sizeof(Chopstick));
+    resource_graph_destroy(&resource_graph);
+    free_table(philosophers, num_philosophers, sizeof(Philosopher));
+    shared_memory_close();
     return 0;
 }
@@ -1,3 +1,4 @@
+#define _GNU_SOURCE  // mremap() for the memory-mapped event log
 #include <stdio.h>
 #include <stdlib.h>
 #include <pthread.h>
@@ -6,14 +7,44 @@
 #include <stdatomic.h>
 #include <signal.h>
 
-#define NUM_PHILOSOPHERS 5
+#include "philo_common.h"
+#include "philo_random.h"
+#include "futex_handoff.h"
+#include "event_log.h"
+#include "sim_clock.h"
+#include "chopstick_pairs.h"
+#include "status_snapshot.h"
+#include "numa_placement.h"
+#include "task_pool.h"
+#include "bench_report.h"
+#include "schedule_log.h"
+#include "trace_log.h"
+
 #define MAX_WAIT_TIME 6
-#define SHARED_MEMORY_SIZE 5  // Number of shared memory cells for chopsticks
+#define MAX_WAIT_NS (MAX_WAIT_TIME * NS_PER_SEC)
+#define STARVATION_SCAN_NS (250 * NS_PER_MS)  // Simulated time between starvation scans
+#define STARVING_DISPLAY_LIMIT 8               // Hungriest philosophers listed in the status
 
 // Forward declarations
 void* philosopher_routine(void* arg);
 void* print_status(void* arg);
-void* execute_task(void* arg);
+void* starvation_monitor(void* arg);
+long long execute_task(void* arg);
+
+// Event log records, formatted by the writer thread
+enum {
+    EVENT_EATING,
+    EVENT_THINKING,
+    EVENT_WAITED_TOO_LONG,
+    EVENT_YIELDED,
+};
+
+static const char* const event_formats[] = {
+    [EVENT_EATING] = "Philosopher %d is eating.\n",
+    [EVENT_THINKING] = "Philosopher %d is thinking.\n",
+    [EVENT_WAITED_TOO_LONG] = "Philosopher %d waited too long and returned to thinking.\n",
+    [EVENT_YIELDED] = "Philosopher %d put down its chopstick for a hungrier neighbour.\n",
+};
 
 // Global variables
 atomic_int should_print = 0;
@@ -21,41 +52,57 @@ atomic_int running = 1;
 
 // Philosopher structure
 typedef struct {
-    atomic_int state;         // 1:thinking, 2:waiting, 3:eating
+    _Alignas(CACHE_LINE_SIZE) atomic_int state;         // 1:thinking, 2:waiting, 3:eating
     int philosopher_id;       // ID number
     atomic_int invoke_count;  // Times eaten
     atomic_int must_think;    // Fairness control
-    time_t wait_start;       // Wait timestamp
-} Philosopher;
-
-Philosopher philosophers[NUM_PHILOSOPHERS];
-pthread_mutex_t print_mutex;
+    long long wait_start;  // Wait timestamp (simulated ns)
+    TaskPhase phase;          // Where execute_task() resumes
+    int contended;            // Chopstick busy on the last failed attempt, -1 if none
+    _Atomic long long last_meal_ns;  // Simulated time this philosopher last started eating
+    atomic_int priority;      // Aging boost set by the starvation monitor, 0 when not starving
+    HandoffStats handoff;     // Release-to-acquire latency, owner thread only
+    StatusSlot status;        // Published copy read by print_status()
+} Philosopher;  // Padded to a cache line so neighbours never share one
+
+// Chopstick cell, one per cache line so a CAS never invalidates a neighbour's
+typedef struct {
+    _Alignas(CACHE_LINE_SIZE) atomic_int owner;  // 0: free, otherwise philosopher ID + 1
+    atomic_int waiters;                          // Threads blocked on owner in futex_wait()
+    _Atomic long long released_ns;               // Time of the last release
+} Chopstick;
+
+int num_philosophers = DEFAULT_NUM_PHILOSOPHERS;
+Philosopher* philosophers;
+EventLog event_log;  // Per-philosopher rings drained by one writer thread
+LatencyHistogram* wait_histograms;  // Wait-to-eat time per philosopher, owner thread only
+MealTarget meal_target;             // -m: total meals after which the run stops
 pthread_mutex_t state_mutex;
-atomic_int chopsticks[SHARED_MEMORY_SIZE]; // Shared memory for chopsticks
+Chopstick* chopsticks; // Shared memory for chopsticks
+int blocking_mode = 0;
+int pair_mode = 0;               // -a pair: claim both chopsticks at once
+ChopstickPairs chopstick_pairs;  // Bitmap view of chopsticks[] used by pair_mode
+
+// Starvation monitor. Every scan measures how long each philosopher has gone
+// without eating; with -A, a gap past the threshold raises the philosopher's
+// priority by one level per threshold, and neighbours with a lower priority
+// step back from the chopsticks it needs.
+long long aging_threshold_ns = 0;          // 0: track starvation without aging
+_Atomic long long longest_gap_ns = 0;      // Longest time anyone went without eating
+atomic_int longest_gap_philosopher = 0;
+long long boosts_applied = 0;              // Times a philosopher went from priority 0 to boosted
 
 // Signal handler
 void handle_signal(int sig) {
     if (sig == SIGINT) {
         atomic_store(&running, 0);
+        clock_interrupt_from_signal();
     }
 }
 
 // Utility functions
-int get_random(int min, int max) {
-    int result = 0, low_num = 0, hi_num = 0;
-    if (min < max) {
-        low_num = min;
-        hi_num = max + 1;
-    } else {
-        low_num = max + 1;
-        hi_num = min;
-    }
-    result = (rand() % (hi_num - low_num)) + low_num;
-    return result;
-}
-
 int is_anyone_eating() {
-    for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
+    for (int i = 0; i < num_philosophers; i++) {
         if (atomic_load(&philosophers[i].state) == 3) {
             return 1;
         }
@@ -63,210 +110,653 @@ int is_anyone_eating() {
     return 0;
 }
 
-// Philosopher actions
-void eat(Philosopher* philosopher) {
-    int left_chopstick_index = (philosopher->philosopher_id - 1 + NUM_PHILOSOPHERS) % NUM_PHILOSOPHERS;
+// Every state change goes through here so the trace sees it
+void set_state(Philosopher* philosopher, int state) {
+    atomic_store(&philosopher->state, state);
+    trace_event(philosopher->philosopher_id, TRACE_STATE, state);
+}
+
+// Chopstick handoff: a release wakes the one neighbour blocked on that chopstick
+void release_chopstick(int philosopher_id, int index) {
+    trace_event(philosopher_id, TRACE_RELEASE, index);
+    atomic_store(&chopsticks[index].released_ns, monotonic_ns());
+    atomic_store(&chopsticks[index].owner, 0);
+    if (atomic_load(&chopsticks[index].waiters) > 0) {
+        futex_wake(&chopsticks[index].owner, 1);
+    }
+}
+
+void wait_for_chopstick(int index, int owner, long long timeout_ns) {
+    atomic_fetch_add(&chopsticks[index].waiters, 1);
+    futex_wait(&chopsticks[index].owner, owner, timeout_ns);
+    atomic_fetch_sub(&chopsticks[index].waiters, 1);
+}
+
+// Pair mode keeps chopsticks[].owner in sync for the status view and for
+// futex handoff, but the bitmap in chopstick_pairs decides who gets them.
+// The owner words are cleared before the bitmap frees the pair, since a
+// neighbour that wins it sets its own, and woken only after.
+void release_pair(int philosopher_id, int left_chopstick_index, int right_chopstick_index) {
+    int pair[2] = {left_chopstick_index, right_chopstick_index};
+    for (int i = 0; i < 2; i++) {
+        trace_event(philosopher_id, TRACE_RELEASE, pair[i]);
+        atomic_store(&chopsticks[pair[i]].released_ns, monotonic_ns());
+        atomic_store(&chopsticks[pair[i]].owner, 0);
+    }
+    chopstick_pair_release(&chopstick_pairs, left_chopstick_index, right_chopstick_index);
+    for (int i = 0; i < 2; i++) {
+        if (atomic_load(&chopsticks[pair[i]].waiters) > 0) {
+            futex_wake(&chopsticks[pair[i]].owner, 1);
+        }
+    }
+}
+
+// A neighbour that has starved longer gets first claim on the shared chopstick
+int neighbour_outranks(Philosopher* philosopher, int neighbour_id) {
+    return aging_threshold_ns > 0 &&
+           atomic_load_explicit(&philosophers[neighbour_id].priority, memory_order_relaxed) >
+               atomic_load_explicit(&philosopher->priority, memory_order_relaxed);
+}
+
+void start_eating(Philosopher* philosopher) {
+    latency_record(&wait_histograms[philosopher->philosopher_id], clock_now_ns() - philosopher->wait_start, 0);
+    atomic_store(&philosopher->last_meal_ns, clock_now_ns());
+    atomic_store(&philosopher->priority, 0);
+    set_state(philosopher, 3);
+}
+
+// One pass of wait()'s loop in pair mode. Returns the delay before the next
+// pass, or -1 once waiting is over.
+long long wait_for_pair_pass(Philosopher* philosopher, int left_chopstick_index, int right_chopstick_index) {
+    long long waited_ns = clock_now_ns() - philosopher->wait_start;
+    if (waited_ns > MAX_WAIT_NS) {
+        latency_record(&wait_histograms[philosopher->philosopher_id], waited_ns, 1);
+        trace_event(philosopher->philosopher_id, TRACE_TIMEOUT, 0);
+        set_state(philosopher, 1);
+
+        log_event(&event_log, philosopher->philosopher_id, EVENT_WAITED_TOO_LONG);
+
+        return -1;
+    }
+
+    int left_id = (philosopher->philosopher_id - 1 + num_philosophers) % num_philosophers;
+    int right_id = (philosopher->philosopher_id + 1) % num_philosophers;
+    int outranked = neighbour_outranks(philosopher, left_id) || neighbour_outranks(philosopher, right_id);
+    if (!outranked && schedule_cas(left_chopstick_index, chopstick_pair_try_acquire(&chopstick_pairs, left_chopstick_index,
+                                                                                    right_chopstick_index))) {
+        atomic_store(&chopsticks[left_chopstick_index].owner, philosopher->philosopher_id + 1);
+        atomic_store(&chopsticks[right_chopstick_index].owner, philosopher->philosopher_id + 1);
+        trace_event(philosopher->philosopher_id, TRACE_ACQUIRE, left_chopstick_index);
+        trace_event(philosopher->philosopher_id, TRACE_ACQUIRE, right_chopstick_index);
+        if (philosopher->contended >= 0) {
+            handoff_stats_record(&philosopher->handoff,
+                                 monotonic_ns() - atomic_load(&chopsticks[philosopher->contended].released_ns));
+        }
+        start_eating(philosopher);
+        return -1;
+    }
+
+    // Nothing is held here, so blocking cannot form a hold-and-wait cycle
+    philosopher->contended = atomic_load(&chopsticks[left_chopstick_index].owner) != 0 ? left_chopstick_index
+                                                                                       : right_chopstick_index;
+    if (!outranked) {
+        trace_event(philosopher->philosopher_id, TRACE_CONTENDED, philosopher->contended);
+    }
+    if (blocking_mode) {
+        int owner = atomic_load(&chopsticks[philosopher->contended].owner);
+        // An owner of 0 is a pair changing hands; there is nothing to sleep on yet
+        if (owner != 0) {
+            wait_for_chopstick(philosopher->contended, owner, NS_PER_SEC);
+        }
+        return 0;
+    }
+    return 50 * NS_PER_MS;
+}
+
+// Publish this philosopher's row of the status table (owner thread only)
+void publish_status(Philosopher* philosopher) {
+    int owner_id = philosopher->philosopher_id + 1;
+    int left_chopstick_index = (philosopher->philosopher_id - 1 + num_philosophers) % num_philosophers;
     int right_chopstick_index = philosopher->philosopher_id;
+    StatusRecord record = {
+        .state = atomic_load(&philosopher->state),
+        .invoke_count = atomic_load(&philosopher->invoke_count),
+        .must_think = atomic_load(&philosopher->must_think),
+        .held = (atomic_load(&chopsticks[left_chopstick_index].owner) == owner_id ? HOLDS_LEFT : 0) |
+                (atomic_load(&chopsticks[right_chopstick_index].owner) == owner_id ? HOLDS_RIGHT : 0),
+    };
+    status_publish(&philosopher->status, &record);
+}
 
-    pthread_mutex_lock(&print_mutex);
-    printf("Philosopher %d is eating.\n", philosopher->philosopher_id);
-    pthread_mutex_unlock(&print_mutex);
+// Philosopher actions. Each returns how long the philosopher now sleeps;
+// execute_task() resumes in the matching phase afterwards.
+long long eat(Philosopher* philosopher) {
+    log_event(&event_log, philosopher->philosopher_id, EVENT_EATING);
 
-    sleep(get_random(1, 4));  // 1-4 seconds
+    philosopher->phase = PHASE_ATE;
+    return random_eat_ns(1, 4);  // 1-4 seconds
+}
+
+void finish_eating(Philosopher* philosopher) {
+    int left_chopstick_index = (philosopher->philosopher_id - 1 + num_philosophers) % num_philosophers;
+    int right_chopstick_index = philosopher->philosopher_id;
 
     atomic_fetch_add(&philosopher->invoke_count, 1);
 
-    atomic_store(&philosopher->state, 2); // Set to waiting state
+    // Keep the right chopstick and go straight back to waiting, unless aging
+    // says the right neighbour has starved longer
+    int yield = !pair_mode && neighbour_outranks(philosopher, (philosopher->philosopher_id + 1) % num_philosophers);
+    set_state(philosopher, yield ? 1 : 2);
 
     // Release the chopsticks
-    atomic_store(&chopsticks[left_chopstick_index], 0);
+    if (pair_mode) {
+        release_pair(philosopher->philosopher_id, left_chopstick_index, right_chopstick_index);
+    } else {
+        release_chopstick(philosopher->philosopher_id, left_chopstick_index);
+        if (yield) {
+            release_chopstick(philosopher->philosopher_id, right_chopstick_index);
+            log_event(&event_log, philosopher->philosopher_id, EVENT_YIELDED);
+        }
+    }
+    meal_target_count(&meal_target);
 }
 
-void think(Philosopher* philosopher) {
-    pthread_mutex_lock(&print_mutex);
-    printf("Philosopher %d is thinking.\n", philosopher->philosopher_id);
-    pthread_mutex_unlock(&print_mutex);
+long long think(Philosopher* philosopher) {
+    log_event(&event_log, philosopher->philosopher_id, EVENT_THINKING);
 
-    sleep(get_random(2, 5));  // 2-5 seconds
+    philosopher->phase = PHASE_THOUGHT;
+    return random_think_ns(2, 5);  // 2-5 seconds
 }
 
 void try_to_wait(Philosopher* philosopher) {
     int right_chopstick_index = philosopher->philosopher_id;
     int expected = 0;
 
-    if (atomic_compare_exchange_weak(&chopsticks[right_chopstick_index], &expected, philosopher->philosopher_id + 1)) {
-        atomic_store(&philosopher->state, 2);
+    if (pair_mode) {
+        // Announce hunger without holding anything; wait() takes both at once
+        set_state(philosopher, 2);
+        return;
+    }
+
+    if (neighbour_outranks(philosopher, (philosopher->philosopher_id + 1) % num_philosophers)) {
+        return;  // Leave it to the hungrier right neighbour and think again
+    }
+    // Strong CAS: a spurious failure could not be replayed
+    if (schedule_cas(right_chopstick_index, atomic_compare_exchange_strong(&chopsticks[right_chopstick_index].owner,
+                                                                           &expected, philosopher->philosopher_id + 1))) {
+        trace_event(philosopher->philosopher_id, TRACE_ACQUIRE, right_chopstick_index);
+        set_state(philosopher, 2);
+    } else {
+        trace_event(philosopher->philosopher_id, TRACE_CONTENDED, right_chopstick_index);
     }
 }
 
-void wait(Philosopher* philosopher) {
-    int left_chopstick_index = (philosopher->philosopher_id - 1 + NUM_PHILOSOPHERS) % NUM_PHILOSOPHERS;
+// One pass of wait()'s retry loop. Returns the delay before the next pass,
+// or -1 once waiting is over (eating, or back to thinking).
+long long wait_pass(Philosopher* philosopher) {
+    int left_chopstick_index = (philosopher->philosopher_id - 1 + num_philosophers) % num_philosophers;
     int right_chopstick_index = philosopher->philosopher_id;
-    
-    // Set wait start time when entering waiting state
-    philosopher->wait_start = time(NULL);
-    
-    while (atomic_load(&running) && atomic_load(&philosophers[philosopher->philosopher_id].state) == 2) {
-        // Check if waiting time exceeded MAX_WAIT_TIME seconds
-        if (time(NULL) - philosopher->wait_start > MAX_WAIT_TIME) {
-            // Release right chopstick
-            atomic_store(&chopsticks[right_chopstick_index], 0);
-            // Return to thinking state
-            atomic_store(&philosopher->state, 1);
-            
-            pthread_mutex_lock(&print_mutex);
-            printf("Philosopher %d waited too long and returned to thinking.\n", philosopher->philosopher_id);
-            pthread_mutex_unlock(&print_mutex);
-            
-            return;
-        }
 
-        // Attempt to acquire the left chopstick
+    if (pair_mode) {
+        return wait_for_pair_pass(philosopher, left_chopstick_index, right_chopstick_index);
+    }
+
+    // Check if waiting time exceeded MAX_WAIT_TIME seconds
+    long long waited_ns = clock_now_ns() - philosopher->wait_start;
+    if (waited_ns > MAX_WAIT_NS) {
+        latency_record(&wait_histograms[philosopher->philosopher_id], waited_ns, 1);
+        trace_event(philosopher->philosopher_id, TRACE_TIMEOUT, 0);
+        // Release right chopstick
+        release_chopstick(philosopher->philosopher_id, right_chopstick_index);
+        // Return to thinking state
+        set_state(philosopher, 1);
+
+        log_event(&event_log, philosopher->philosopher_id, EVENT_WAITED_TOO_LONG);
+
+        return -1;
+    }
+
+    // Aging: give the held right chopstick to a hungrier right neighbour
+    if (neighbour_outranks(philosopher, (philosopher->philosopher_id + 1) % num_philosophers)) {
+        latency_record(&wait_histograms[philosopher->philosopher_id], waited_ns, 1);
+        release_chopstick(philosopher->philosopher_id, right_chopstick_index);
+        set_state(philosopher, 1);
+        log_event(&event_log, philosopher->philosopher_id, EVENT_YIELDED);
+        return -1;
+    }
+
+    // Attempt to acquire the left chopstick, unless the left neighbour is
+    // hungrier and needs it as its right one
+    int left_owner = atomic_load(&chopsticks[left_chopstick_index].owner);
+
+    if (left_owner == 0 && !neighbour_outranks(philosopher, left_chopstick_index)) {
         int expected_left = 0;
+        if (schedule_cas(left_chopstick_index, atomic_compare_exchange_strong(&chopsticks[left_chopstick_index].owner,
+                                                                              &expected_left,
+                                                                              philosopher->philosopher_id + 1))) {
+            trace_event(philosopher->philosopher_id, TRACE_ACQUIRE, left_chopstick_index);
+            if (philosopher->contended >= 0) {
+                handoff_stats_record(&philosopher->handoff,
+                                     monotonic_ns() - atomic_load(&chopsticks[left_chopstick_index].released_ns));
+            }
+            start_eating(philosopher);
+            return -1;
+        }
+        trace_event(philosopher->philosopher_id, TRACE_CONTENDED, left_chopstick_index);
+    } else {
+        philosopher->contended = left_chopstick_index;
+        if (left_owner != 0) {
+            trace_event(philosopher->philosopher_id, TRACE_CONTENDED, left_chopstick_index);
+        }
+    }
+
+    if (blocking_mode) {
+        // Sleep until the owner releases it, rechecking timeout and shutdown
+        long long remaining_ns = clock_real_timeout_ns(philosopher->wait_start + MAX_WAIT_NS + 1 - clock_now_ns());
+        wait_for_chopstick(left_chopstick_index, left_owner,
+                           remaining_ns < NS_PER_SEC ? remaining_ns : NS_PER_SEC);
+        return 0;
+    }
+    return 50 * NS_PER_MS; // Wait a bit before retrying
+}
 
-        if (atomic_load(&chopsticks[left_chopstick_index]) == 0) {
-            if (atomic_compare_exchange_weak(&chopsticks[left_chopstick_index], &expected_left, philosopher->philosopher_id + 1)) {
-                atomic_store(&philosopher->state, 3);
-                return;
+// Run the philosopher up to its next sleep and return that sleep in
+// simulated ns; phase records where to pick up
+long long run_task(Philosopher* philosopher) {
+    long long delay_ns;
+
+    switch (philosopher->phase) {
+        case PHASE_THOUGHT:
+            try_to_wait(philosopher);
+            break;
+        case PHASE_ATE:
+            finish_eating(philosopher);
+            break;
+        case PHASE_WAITING:
+            if ((delay_ns = wait_pass(philosopher)) >= 0) {
+                return delay_ns;
             }
+            break;
+        case PHASE_DISPATCH: {
+            int current_state = atomic_load(&philosopher->state);
+
+            if (current_state == 1) {
+                return think(philosopher);
+            } else if (current_state == 2) {
+                philosopher->wait_start = clock_now_ns();
+                philosopher->contended = -1;
+                philosopher->phase = PHASE_WAITING;
+                if ((delay_ns = wait_pass(philosopher)) >= 0) {
+                    return delay_ns;
+                }
+            } else if (current_state == 3) {
+                return eat(philosopher);
+            }
+            break;
         }
-        usleep(50000); // Wait a bit before retrying
     }
+
+    publish_status(philosopher);
+    philosopher->phase = PHASE_DISPATCH;
+    return blocking_mode ? 0 : 50 * NS_PER_MS;  // 50ms delay between tasks
 }
 
-void* execute_task(void* arg) {
+// One step of the philosopher as a schedule_log.h step. The caller sleeps
+// for the returned time (its own thread, or a pool timer) and calls again.
+long long execute_task(void* arg) {
     Philosopher* philosopher = (Philosopher*)arg;
-    int current_state = atomic_load(&philosopher->state);
+    schedule_step_begin(philosopher->philosopher_id, &philosopher->state);
+    long long delay_ns = run_task(philosopher);
+    schedule_step_end();
+    return delay_ns;
+}
 
-    if (current_state == 1) {
-        think(philosopher);
-        try_to_wait(philosopher);
-    } else if (current_state == 2) {
-        wait(philosopher);
-    } else if (current_state == 3) {
-        eat(philosopher);
+void* philosopher_routine(void* arg) {
+    Philosopher* philosopher = (Philosopher*)arg;
+    while (atomic_load(&running)) {
+        clock_sleep_ns(execute_task(philosopher));
     }
-
+    clock_thread_exit();
     return NULL;
 }
 
-void* philosopher_routine(void* arg) {
-    Philosopher* philosopher = (Philosopher*)arg;
+// One scan of the starvation monitor, a schedule step of its own (actor N)
+void starvation_scan(void) {
+    schedule_step_begin(num_philosophers, NULL);
+    long long now = clock_now_ns();
+    for (int i = 0; i < num_philosophers; i++) {
+        long long gap_ns = now - atomic_load_explicit(&philosophers[i].last_meal_ns, memory_order_relaxed);
+        if (gap_ns > atomic_load_explicit(&longest_gap_ns, memory_order_relaxed)) {
+            atomic_store(&longest_gap_ns, gap_ns);
+            atomic_store(&longest_gap_philosopher, i);
+        }
+        if (aging_threshold_ns == 0 || atomic_load_explicit(&philosophers[i].state, memory_order_relaxed) == 3) {
+            continue;
+        }
+        int priority = gap_ns > aging_threshold_ns ? (int)(gap_ns / aging_threshold_ns) : 0;
+        int previous = atomic_exchange(&philosophers[i].priority, priority);
+        if (previous == 0 && priority > 0) {
+            boosts_applied++;
+        }
+    }
+    schedule_step_end();
+}
+
+void* starvation_monitor(void* arg) {
+    (void)arg;
     while (atomic_load(&running)) {
-        execute_task(philosopher);
-        usleep(50000); // 50ms delay
+        clock_sleep_ns(STARVATION_SCAN_NS);
+        starvation_scan();
     }
+    clock_thread_exit();
     return NULL;
 }
 
+// Replay: run the recorded actor's next step
+void replay_step(int actor) {
+    if (actor == num_philosophers) {
+        starvation_scan();
+    } else if (actor >= 0 && actor < num_philosophers) {
+        execute_task(&philosophers[actor]);
+    } else {
+        schedule_diverge("no such philosopher");
+    }
+}
+
 void* print_status(void* arg) {
     while (atomic_load(&running)) {
         sleep(1);
-        pthread_mutex_lock(&print_mutex);
-        printf(" ");
-        for (int i = 0; i < NUM_PHILOSOPHERS * 9; i++) printf("═");
-        printf("\n");
-        printf("║");
-        for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
-            printf(" P%d      ", i);
+        int shown = num_philosophers < STATUS_DISPLAY_LIMIT ? num_philosophers : STATUS_DISPLAY_LIMIT;
+
+        // Copy the published rows, then render without holding any lock
+        StatusRecord snapshot[STATUS_DISPLAY_LIMIT];
+        for (int i = 0; i < shown; i++) {
+            status_read(&philosophers[i].status, &snapshot[i]);
+        }
+
+        char* frame = NULL;
+        size_t frame_size = 0;
+        FILE* out = open_memstream(&frame, &frame_size);
+        fprintf(out, " ");
+        for (int i = 0; i < shown * 9; i++) fputs("═", out);
+        fprintf(out, "\n");
+        fprintf(out, "║");
+        for (int i = 0; i < shown; i++) {
+            fprintf(out, " P%-7d", i);
         }
-        printf("║\n║");
+        fprintf(out, "║\n║");
 
         // Chopstick representation
-        for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
-            int left_chopstick_index = (i - 1 + NUM_PHILOSOPHERS) % NUM_PHILOSOPHERS;
-            int right_chopstick_index = i;
-            int left_taken = atomic_load(&chopsticks[left_chopstick_index]);
-            int right_taken = atomic_load(&chopsticks[right_chopstick_index]);
-
-            if (atomic_load(&philosophers[i].state) == 3) {
-                printf(" ||      "); // Eating, so has both chopsticks
-            } else if (left_taken == (i + 1) && right_taken == (i + 1)) {
-                printf(" ||      "); // Eating, so has both chopsticks
-            } else if (left_taken == (i + 1)) {
-                printf(" |_      "); // Has only left chopstick
-            } else if (right_taken == (i + 1)) {
-                printf(" _|      "); // Has only right chopstick
+        for (int i = 0; i < shown; i++) {
+            if (snapshot[i].state == 3) {
+                fprintf(out, " ||      "); // Eating, so has both chopsticks
+            } else if (snapshot[i].held == (HOLDS_LEFT | HOLDS_RIGHT)) {
+                fprintf(out, " ||      "); // Eating, so has both chopsticks
+            } else if (snapshot[i].held & HOLDS_LEFT) {
+                fprintf(out, " |_      "); // Has only left chopstick
+            } else if (snapshot[i].held & HOLDS_RIGHT) {
+                fprintf(out, " _|      "); // Has only right chopstick
             } else {
-                printf(" __      "); // No chopsticks
+                fprintf(out, " __      "); // No chopsticks
             }
         }
-        printf("║\n║");
+        fprintf(out, "║\n║");
 
         // State representation
-        for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
+        for (int i = 0; i < shown; i++) {
             char state_char;
-            switch (atomic_load(&philosophers[i].state)) {
+            switch (snapshot[i].state) {
                 case 1: state_char = 't'; break; // Thinking
                 case 2: state_char = 'w'; break; // Waiting
                 case 3: state_char = 'e'; break; // Eating
                 default: state_char = '?'; break;
             }
-            printf(" %c       ", state_char);
+            fprintf(out, " %c       ", state_char);
         }
-        printf("║\n║");
+        fprintf(out, "║\n║");
 
         // Invoke count representation
-        for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
-            printf(" %-7d ", atomic_load(&philosophers[i].invoke_count));
+        for (int i = 0; i < shown; i++) {
+            fprintf(out, " %-7d ", snapshot[i].invoke_count);
         }
-        printf("║\n ");
+        fprintf(out, "║\n║");
 
-        for (int i = 0; i < NUM_PHILOSOPHERS * 9; i++) printf("═");
+        // Wait-to-eat p50 and p99, read from the live histograms
+        for (int i = 0; i < shown; i++) {
+            char p50[16];
+            latency_format(p50, sizeof(p50), latency_percentile(&wait_histograms[i], 0.5));
+            fprintf(out, " %-7s ", p50);
+        }
+        fprintf(out, "║\n║");
+        for (int i = 0; i < shown; i++) {
+            char p99[16];
+            latency_format(p99, sizeof(p99), latency_percentile(&wait_histograms[i], 0.99));
+            fprintf(out, " %-7s ", p99);
+        }
+        fprintf(out, "║\n ");
+
+        for (int i = 0; i < shown * 9; i++) fputs("═", out);
        
-        printf("\n\n");
-        
-        pthread_mutex_unlock(&print_mutex);
+        fprintf(out, "\n");
+        if (shown < num_philosophers) {
+            fprintf(out, "(showing %d of %d philosophers)\n", shown, num_philosophers);
+        }
+        LatencyHistogram all_waits = {0};
+        for (int i = 0; i < num_philosophers; i++) {
+            latency_merge(&all_waits, &wait_histograms[i]);
+        }
+        latency_print_summary(out, "Wait to eat (rows 4-5: p50, p99)", &all_waits);
+
+        // Hungriest philosophers right now, and the worst gap so far
+        long long now = clock_now_ns();
+        int starving[STARVING_DISPLAY_LIMIT];
+        long long starving_gap_ns[STARVING_DISPLAY_LIMIT];
+        int num_starving = 0;
+        for (int i = 0; i < num_philosophers; i++) {
+            long long gap_ns = now - atomic_load_explicit(&philosophers[i].last_meal_ns, memory_order_relaxed);
+            if (num_starving == STARVING_DISPLAY_LIMIT && gap_ns <= starving_gap_ns[num_starving - 1]) {
+                continue;
+            }
+            int slot = num_starving < STARVING_DISPLAY_LIMIT ? num_starving++ : num_starving - 1;
+            for (; slot > 0 && starving_gap_ns[slot - 1] < gap_ns; slot--) {
+                starving[slot] = starving[slot - 1];
+                starving_gap_ns[slot] = starving_gap_ns[slot - 1];
+            }
+            starving[slot] = i;
+            starving_gap_ns[slot] = gap_ns;
+        }
+        fprintf(out, "Hungriest:");
+        for (int i = 0; i < num_starving; i++) {
+            fprintf(out, " P%d %.0fs (priority %d)", starving[i], (double)starving_gap_ns[i] / NS_PER_SEC,
+                    atomic_load(&philosophers[starving[i]].priority));
+        }
+        fprintf(out, "\nLongest without eating: %.1f s (P%d)\n\n",
+                (double)atomic_load(&longest_gap_ns) / NS_PER_SEC, atomic_load(&longest_gap_philosopher));
+
+        // One write per frame keeps the table from interleaving with events
+        fclose(out);
+        if (write(STDOUT_FILENO, frame, frame_size) < 0) {
+            perror("write");
+        }
+        free(frame);
         sleep(1);
     }
     return NULL;
 }
 
-int main() {
+int main(int argc, char* argv[]) {
+    PhiloOptions options;
+    parse_options(argc, argv, &options);
+    ScheduleHeader schedule = {
+        .program = "starvation",
+        .num_philosophers = options.num_philosophers,
+        .acquire_pairs = options.acquire_pairs,
+        .aging_threshold_ns = (long long)(options.aging_seconds * NS_PER_SEC),
+        .seed = options.seed,
+    };
+    if (schedule_open(options.schedule, &schedule) != 0) {
+        return 1;
+    }
+    if (schedule_log.mode == SCHEDULE_REPLAY) {
+        // The table must be the one that was recorded
+        options.num_philosophers = schedule.num_philosophers;
+        options.acquire_pairs = schedule.acquire_pairs;
+        options.aging_seconds = (double)schedule.aging_threshold_ns / NS_PER_SEC;
+    }
+    num_philosophers = options.num_philosophers;
+    numa_placement_init(num_philosophers, options.numa);
+    philosophers = numa_alloc_ring(num_philosophers, sizeof(Philosopher));
+    wait_histograms = numa_alloc_ring(num_philosophers, sizeof(LatencyHistogram));
+    meal_target_init(&meal_target, options.meal_target, &running);
+    chopsticks = numa_alloc_ring(num_philosophers, sizeof(Chopstick));
+    blocking_mode = options.blocking;
+    pair_mode = options.acquire_pairs;
+    aging_threshold_ns = (long long)(options.aging_seconds * NS_PER_SEC);
+    chopstick_pairs_init(&chopstick_pairs, num_philosophers);
+
     signal(SIGINT, handle_signal);
-    pthread_mutex_init(&print_mutex, NULL);
-    srand((unsigned int)time(NULL));
+    clock_init(options.time_scale, options.virtual_time);
+    if (options.virtual_time && blocking_mode) {
+        // Futex waits happen outside the clock, so virtual time could run past them
+        fprintf(stderr, "Blocking handoff is not available with virtual time; polling instead\n");
+        blocking_mode = 0;
+    }
+    if (options.workers > 0 && blocking_mode) {
+        // A futex wait would stall every philosopher sharing the worker
+        fprintf(stderr, "Blocking handoff is not available with a worker pool; polling instead\n");
+        blocking_mode = 0;
+    }
+    if (schedule_log.mode != SCHEDULE_OFF && blocking_mode) {
+        // A futex wait inside a step would hold up every other step
+        fprintf(stderr, "Blocking handoff is not available with a schedule log; polling instead\n");
+        blocking_mode = 0;
+    }
+    if (random_init(options.seed, options.distributions) != 0) {
+        return 1;
+    }
+    if (trace_open(options.trace_path, "starvation", num_philosophers, num_philosophers, MAX_WAIT_NS) != 0) {
+        return 1;
+    }
 
     // Initialize philosophers
-    for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
+    for (int i = 0; i < num_philosophers; i++) {
         atomic_init(&philosophers[i].state, 1); // Initial state: thinking
         philosophers[i].philosopher_id = i;
         atomic_init(&philosophers[i].invoke_count, 0);
+        philosophers[i].phase = PHASE_DISPATCH;
         atomic_init(&philosophers[i].must_think, 0); // Initialize must_think to 0
     }
 
     // Initialize chopsticks
-    for (int i = 0; i < SHARED_MEMORY_SIZE; i++) {
-        atomic_init(&chopsticks[i], 0);
+    for (int i = 0; i < num_philosophers; i++) {
+        atomic_init(&chopsticks[i].owner, 0);
+    }
+    for (int i = 0; i < num_philosophers; i++) {
+        publish_status(&philosophers[i]);
     }
 
-    pthread_t philosopher_threads[NUM_PHILOSOPHERS];
+    pthread_t* philosopher_threads = malloc(num_philosophers * sizeof(pthread_t));
     pthread_t status_thread;
+    pthread_t monitor_thread;
+    pthread_attr_t thread_attr;
+    init_philosopher_thread_attr(&thread_attr);
 
     printf("Starting dining philosophers simulation (starvation)\n");
-    printf("Number of philosophers: %d\n", NUM_PHILOSOPHERS);
+    printf("Number of philosophers: %d\n", num_philosophers);
+    numa_print_placement();
+    random_print_config();
+    if (options.workers > 0) {
+        printf("Worker threads: %d\n", options.workers < num_philosophers ? options.workers : num_philosophers);
+    }
     printf("Press Ctrl+C to terminate the program\n\n");
 
-    pthread_create(&status_thread, NULL, print_status, NULL);
-
-    for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
-        pthread_create(&philosopher_threads[i], NULL, philosopher_routine, &philosophers[i]);
+    // Rings 0..N-1 belong to the philosophers, ring N to monitor threads
+    if (event_log_start(&event_log, num_philosophers + 1, event_formats, options.log_path) != 0) {
+        return 1;
     }
+    TaskPool pool;
+    StopTimer stop_timer;
+    if (schedule_log.mode == SCHEDULE_REPLAY) {
+        // One thread runs the recorded steps in order; nothing sleeps
+        pthread_attr_destroy(&thread_attr);
+        schedule_replay(replay_step);
+    } else {
+        clock_register_thread();  // Time stands still until everything is started
+        pthread_create(&status_thread, NULL, print_status, NULL);
+        clock_register_thread();
+        pthread_create(&monitor_thread, NULL, starvation_monitor, NULL);
+
+        if (options.workers > 0) {
+            if (task_pool_start(&pool, options.workers, options.work_stealing, philosophers,
+                                sizeof(Philosopher), num_philosophers, execute_task, &running) != 0) {
+                return 1;
+            }
+        } else {
+            for (int i = 0; i < num_philosophers; i++) {
+                clock_register_thread();
+                numa_set_thread_attr(&thread_attr, i);
+                if (pthread_create(&philosopher_threads[i], &thread_attr, philosopher_routine, &philosophers[i]) != 0) {
+                    fprintf(stderr, "Failed to create thread for philosopher %d\n", i);
+                    return 1;
+                }
+            }
+        }
+        pthread_attr_destroy(&thread_attr);
 
-    for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
-        pthread_join(philosopher_threads[i], NULL);
+        if (options.duration_seconds > 0) {
+            clock_start_stop_timer(&stop_timer, options.duration_seconds, &running);
+        }
+        clock_thread_exit();
+
+        if (options.workers > 0) {
+            task_pool_join(&pool);
+        } else {
+            for (int i = 0; i < num_philosophers; i++) {
+                pthread_join(philosopher_threads[i], NULL);
+            }
+        }
+        pthread_join(monitor_thread, NULL);
+        pthread_join(status_thread, NULL);
     }
-    pthread_join(status_thread, NULL);
+    event_log_stop(&event_log);
 
-    pthread_mutex_destroy(&print_mutex);
 
     printf("\nProgram terminated successfully\n");
     printf("\nFinal Status:\n");
-    for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
+    for (int i = 0; i < num_philosophers; i++) {
         printf("Philosopher %d - State: %d, Times eaten: %d\n",
                i,
                atomic_load(&philosophers[i].state),
                atomic_load(&philosophers[i].invoke_count));
     }
-    return 0;
+
+    HandoffStats handoff_totals = {0};
+    LatencyHistogram wait_totals = {0};
+    FairnessIndex fairness = {0};
+    long long total_meals = 0;
+    for (int i = 0; i < num_philosophers; i++) {
+        handoff_stats_merge(&handoff_totals, &philosophers[i].handoff);
+        latency_merge(&wait_totals, &wait_histograms[i]);
+        fairness_add(&fairness, atomic_load(&philosophers[i].invoke_count));
+        total_meals += atomic_load(&philosophers[i].invoke_count);
+    }
+    long long end_ns = clock_end_ns();
+    print_meal_throughput(total_meals, end_ns);
+    print_handoff_stats(&handoff_totals, blocking_mode);
+    bench_report(&options, "starvation", blocking_mode, total_meals, &wait_totals, fairness_jain(&fairness), end_ns);
+    printf("Starvation: longest without eating %.1f s (philosopher %d)",
+           (double)atomic_load(&longest_gap_ns) / NS_PER_SEC, atomic_load(&longest_gap_philosopher));
+    if (aging_threshold_ns > 0) {
+        printf(", aging after %.1f s, %lld boosts", (double)aging_threshold_ns / NS_PER_SEC, boosts_applied);
+    }
+    printf("\n");
+    schedule_close();
+    trace_close();
+
+    free(philosopher_threads);
+    numa_free_ring(wait_histograms, num_philosophers, sizeof(LatencyHistogram));
+    chopstick_pairs_destroy(&chopstick_pairs);
+    numa_free_ring(chopsticks, num_philosophers, sizeof(Chopstick));
+    numa_free_ring(philosophers, num_philosophers, sizeof(Philosopher));
+    return schedule_log.diverged ? 1 : 0;
 }
@@ -0,0 +1,324 @@
+#ifndef RESOURCE_GRAPH_H
+#define RESOURCE_GRAPH_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "philo_random.h"
+
+// Which resources (chopsticks) each process (philosopher) needs, as a
+// bipartite graph in compressed sparse row form. Row p of resources[] lists
+// process p's resources, and the transpose lists each resource's processes.
+//
+//   ring         the classic table: philosopher i needs chopsticks i - 1 and i
+//   grid:RxC     philosophers on an R x C grid, one chopstick per grid edge
+//   torus:RxC    the same grid with wrap-around edges, so everyone needs four
+//   regular:K[:seed]  random K-regular graph on -n philosophers, one
+//                chopstick per edge, so everyone needs K (seed: -r)
+//   file:path    one line per philosopher listing its resource numbers;
+//                '#' starts a comment
+//
+// Row order is kept as given (ring rows are [left, right]) and each row is
+// also stored sorted, for policies that acquire in a global order.
+
+#define RESOURCE_GRAPH_MAX_DEGREE 64  // Resources one process may need
+
+typedef struct {
+    int num_processes;
+    int num_resources;
+    int is_ring;            // Row p is [(p - 1 + N) % N, p]
+    int max_degree;
+    int* offsets;           // Row p is resources[offsets[p]] .. resources[offsets[p + 1] - 1]
+    int* resources;         // Rows in topology order
+    int* ordered;           // The same rows sorted ascending
+    int* sharer_offsets;    // Transpose: resource r's processes are
+    int* sharers;           //   sharers[sharer_offsets[r]] .. [sharer_offsets[r + 1] - 1]
+} ResourceGraph;
+
+static inline int resource_graph_degree(const ResourceGraph* graph, int process) {
+    return graph->offsets[process + 1] - graph->offsets[process];
+}
+
+static inline const int* resource_graph_row(const ResourceGraph* graph, int process) {
+    return &graph->resources[graph->offsets[process]];
+}
+
+static inline const int* resource_graph_ordered_row(const ResourceGraph* graph, int process) {
+    return &graph->ordered[graph->offsets[process]];
+}
+
+static inline int compare_ints(const void* a, const void* b) {
+    return (*(const int*)a > *(const int*)b) - (*(const int*)a < *(const int*)b);
+}
+
+// Finish a graph whose offsets[] and resources[] are filled in: sorted rows,
+// transpose and sanity checks. Returns 0, or -1 with a message.
+static inline int resource_graph_finish(ResourceGraph* graph) {
+    int num_edges = graph->offsets[graph->num_processes];
+    graph->ordered = malloc((num_edges > 0 ? num_edges : 1) * sizeof(int));
+    memcpy(graph->ordered, graph->resources, num_edges * sizeof(int));
+    graph->max_degree = 0;
+    graph->num_resources = 0;
+    for (int p = 0; p < graph->num_processes; p++) {
+        int degree = resource_graph_degree(graph, p);
+        int* row = &graph->ordered[graph->offsets[p]];
+        qsort(row, degree, sizeof(int), compare_ints);
+        if (degree == 0 || degree > RESOURCE_GRAPH_MAX_DEGREE) {
+            fprintf(stderr, "Topology: philosopher %d needs %d resources (1-%d allowed)\n",
+                    p, degree, RESOURCE_GRAPH_MAX_DEGREE);
+            return -1;
+        }
+        for (int i = 0; i < degree; i++) {
+            if (row[i] < 0 || (i > 0 && row[i] == row[i - 1])) {
+                fprintf(stderr, "Topology: philosopher %d lists resource %d %s\n", p, row[i],
+                        row[i] < 0 ? "(negative)" : "twice");
+                return -1;
+            }
+        }
+        if (degree > graph->max_degree) {
+            graph->max_degree = degree;
+        }
+        if (row[degree - 1] + 1 > graph->num_resources) {
+            graph->num_resources = row[degree - 1] + 1;
+        }
+    }
+
+    graph->sharer_offsets = calloc(graph->num_resources + 1, sizeof(int));
+    graph->sharers = malloc((num_edges > 0 ? num_edges : 1) * sizeof(int));
+    for (int i = 0; i < num_edges; i++) {
+        graph->sharer_offsets[graph->resources[i] + 1]++;
+    }
+    for (int r = 0; r < graph->num_resources; r++) {
+        graph->sharer_offsets[r + 1] += graph->sharer_offsets[r];
+    }
+    int* fill = malloc((graph->num_resources > 0 ? graph->num_resources : 1) * sizeof(int));
+    memcpy(fill, graph->sharer_offsets, graph->num_resources * sizeof(int));
+    for (int p = 0; p < graph->num_processes; p++) {
+        for (int i = graph->offsets[p]; i < graph->offsets[p + 1]; i++) {
+            graph->sharers[fill[graph->resources[i]]++] = p;  // Ascending, since p is
+        }
+    }
+    free(fill);
+    return 0;
+}
+
+static inline void resource_graph_alloc(ResourceGraph* graph, int num_processes, int num_edges) {
+    memset(graph, 0, sizeof(*graph));
+    graph->num_processes = num_processes;
+    graph->offsets = calloc(num_processes + 1, sizeof(int));
+    graph->resources = malloc((num_edges > 0 ? num_edges : 1) * sizeof(int));
+}
+
+// Rows from an edge list: resource e joins processes edge_a[e] and edge_b[e]
+static inline int resource_graph_from_edges(ResourceGraph* graph, int num_processes, int num_edges,
+                                            const int* edge_a, const int* edge_b) {
+    resource_graph_alloc(graph, num_processes, 2 * num_edges);
+    for (int e = 0; e < num_edges; e++) {
+        graph->offsets[edge_a[e] + 1]++;
+        graph->offsets[edge_b[e] + 1]++;
+    }
+    for (int p = 0; p < num_processes; p++) {
+        graph->offsets[p + 1] += graph->offsets[p];
+    }
+    int* fill = malloc(num_processes * sizeof(int));
+    memcpy(fill, graph->offsets, num_processes * sizeof(int));
+    for (int e = 0; e < num_edges; e++) {
+        graph->resources[fill[edge_a[e]]++] = e;
+        graph->resources[fill[edge_b[e]]++] = e;
+    }
+    free(fill);
+    return resource_graph_finish(graph);
+}
+
+static inline int resource_graph_ring(ResourceGraph* graph, int num_processes) {
+    resource_graph_alloc(graph, num_processes, 2 * num_processes);
+    for (int p = 0; p < num_processes; p++) {
+        graph->offsets[p + 1] = 2 * (p + 1);
+        graph->resources[2 * p] = (p - 1 + num_processes) % num_processes;  // Left
+        graph->resources[2 * p + 1] = p;                                    // Right
+    }
+    graph->is_ring = 1;
+    return resource_graph_finish(graph);
+}
+
+static inline int resource_graph_grid(ResourceGraph* graph, int rows, int columns, int wrap) {
+    int num_processes = rows * columns;
+    int* edge_a = malloc(2 * num_processes * sizeof(int));
+    int* edge_b = malloc(2 * num_processes * sizeof(int));
+    int num_edges = 0;
+    for (int r = 0; r < rows; r++) {
+        for (int c = 0; c < columns; c++) {
+            int p = r * columns + c;
+            if (c + 1 < columns || wrap) {
+                edge_a[num_edges] = p;
+                edge_b[num_edges++] = r * columns + (c + 1) % columns;
+            }
+            if (r + 1 < rows || wrap) {
+                edge_a[num_edges] = p;
+                edge_b[num_edges++] = ((r + 1) % rows) * columns + c;
+            }
+        }
+    }
+    int result = resource_graph_from_edges(graph, num_processes, num_edges, edge_a, edge_b);
+    free(edge_a);
+    free(edge_b);
+    return result;
+}
+
+// Random K-regular graph by stub pairing: join two random free stubs unless
+// that makes a loop or a double edge, and start over if the last few stubs
+// cannot be paired. Fast while K is small against N.
+static inline int resource_graph_regular(ResourceGraph* graph, int num_processes, int degree, uint64_t seed) {
+    if (degree < 1 || degree >= num_processes || (long long)num_processes * degree % 2 != 0) {
+        fprintf(stderr, "Topology: a %d-regular graph on %d philosophers needs 1 <= K < N and N * K even\n",
+                degree, num_processes);
+        return -1;
+    }
+    int num_edges = num_processes * degree / 2;
+    int* stubs = malloc(num_processes * degree * sizeof(int));
+    int* neighbours = malloc(num_processes * degree * sizeof(int));
+    int* neighbour_count = malloc(num_processes * sizeof(int));
+    int* edge_a = malloc(num_edges * sizeof(int));
+    int* edge_b = malloc(num_edges * sizeof(int));
+    RandomState random;
+    random_state_seed(&random, seed, RANDOM_SETUP_STREAM);
+
+    for (int attempt = 0; attempt < 100; attempt++) {
+        int remaining = num_processes * degree;
+        for (int i = 0; i < remaining; i++) {
+            stubs[i] = i / degree;
+        }
+        memset(neighbour_count, 0, num_processes * sizeof(int));
+        int edges = 0;
+        int failures = 0;
+        while (remaining > 0 && failures < 1000) {
+            int i = (int)random_state_below(&random, remaining);
+            int j = (int)random_state_below(&random, remaining);
+            int a = stubs[i];
+            int b = stubs[j];
+            int valid = i != j && a != b;
+            for (int n = 0; valid && n < neighbour_count[a]; n++) {
+                valid = neighbours[a * degree + n] != b;
+            }
+            if (!valid) {
+                failures++;
+                continue;
+            }
+            failures = 0;
+            neighbours[a * degree + neighbour_count[a]++] = b;
+            neighbours[b * degree + neighbour_count[b]++] = a;
+            edge_a[edges] = a;
+            edge_b[edges++] = b;
+            // Remove both stubs, the higher index first so the swap cannot move the other
+            int high = i > j ? i : j;
+            int low = i > j ? j : i;
+            stubs[high] = stubs[--remaining];
+            stubs[low] = stubs[--remaining];
+        }
+        if (remaining == 0) {
+            free(stubs);
+            free(neighbours);
+            free(neighbour_count);
+            int result = resource_graph_from_edges(graph, num_processes, num_edges, edge_a, edge_b);
+            free(edge_a);
+            free(edge_b);
+            return result;
+        }
+    }
+    fprintf(stderr, "Topology: could not build a %d-regular graph on %d philosophers\n", degree, num_processes);
+    free(stubs);
+    free(neighbours);
+    free(neighbour_count);
+    free(edge_a);
+    free(edge_b);
+    return -1;
+}
+
+static inline int resource_graph_load(ResourceGraph* graph, const char* path) {
+    FILE* file = fopen(path, "r");
+    if (file == NULL) {
+        perror(path);
+        return -1;
+    }
+    int capacity = 1024;
+    int num_edges = 0;
+    int num_processes = 0;
+    int* resources = malloc(capacity * sizeof(int));
+    int* row_of = malloc(capacity * sizeof(int));
+    char line[65536];
+    while (fgets(line, sizeof(line), file) != NULL) {
+        char* comment = strchr(line, '#');
+        if (comment != NULL) {
+            *comment = '\0';
+        }
+        int found = 0;
+        for (char* token = strtok(line, " \t\r\n,"); token != NULL; token = strtok(NULL, " \t\r\n,")) {
+            if (num_edges == capacity) {
+                capacity *= 2;
+                resources = realloc(resources, capacity * sizeof(int));
+                row_of = realloc(row_of, capacity * sizeof(int));
+            }
+            resources[num_edges] = atoi(token);
+            row_of[num_edges++] = num_processes;
+            found = 1;
+        }
+        num_processes += found;
+    }
+    fclose(file);
+
+    resource_graph_alloc(graph, num_processes, num_edges);
+    for (int i = 0; i < num_edges; i++) {
+        graph->offsets[row_of[i] + 1]++;
+        graph->resources[i] = resources[i];  // Rows are already contiguous and in order
+    }
+    for (int p = 0; p < num_processes; p++) {
+        graph->offsets[p + 1] += graph->offsets[p];
+    }
+    free(resources);
+    free(row_of);
+    if (num_processes < 2) {
+        fprintf(stderr, "Topology: %s lists %d philosophers (at least 2 needed)\n", path, num_processes);
+        return -1;
+    }
+    return resource_graph_finish(graph);
+}
+
+// Build the graph described by spec (NULL: ring of num_processes). Random
+// graphs draw from seed unless the spec names its own.
+static inline int resource_graph_build(ResourceGraph* graph, const char* spec, int num_processes, uint64_t seed) {
+    int rows, columns, degree;
+    if (spec == NULL || strcmp(spec, "ring") == 0) {
+        return resource_graph_ring(graph, num_processes);
+    }
+    if (sscanf(spec, "grid:%dx%d", &rows, &columns) == 2 || sscanf(spec, "torus:%dx%d", &rows, &columns) == 2) {
+        int wrap = spec[0] == 't';
+        if (rows < 1 || columns < 1 || rows * columns < 2 || (wrap && (rows < 2 || columns < 2))) {
+            fprintf(stderr, "Topology: bad size in %s\n", spec);
+            return -1;
+        }
+        return resource_graph_grid(graph, rows, columns, wrap);
+    }
+    unsigned long long spec_seed;
+    if (sscanf(spec, "regular:%d:%llu", &degree, &spec_seed) == 2) {
+        return resource_graph_regular(graph, num_processes, degree, spec_seed);
+    }
+    if (sscanf(spec, "regular:%d", &degree) == 1) {
+        return resource_graph_regular(graph, num_processes, degree, seed);
+    }
+    if (strncmp(spec, "file:", 5) == 0) {
+        return resource_graph_load(graph, spec + 5);
+    }
+    fprintf(stderr, "Unknown topology: %s (ring, grid:RxC, torus:RxC, regular:K[:seed] or file:path)\n", spec);
+    return -1;
+}
+
+static inline void resource_graph_destroy(ResourceGraph* graph) {
+    free(graph->offsets);
+    free(graph->resources);
+    free(graph->ordered);
+    free(graph->sharer_offsets);
+    free(graph->sharers);
+}
+
+#endif // RESOURCE_GRAPH_H
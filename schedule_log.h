@@ -0,0 +1,317 @@
+#ifndef SCHEDULE_LOG_H
+#define SCHEDULE_LOG_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "philo_common.h"
+#include "sim_clock.h"
+
+// Record/replay of a run's schedule (-S record:FILE, -S replay:FILE).
+//
+// A step is one call that touches shared state: a philosopher's
+// execute_task() or one scan of a monitor thread. While recording, steps
+// run one at a time under a global lock, each sees the clock frozen at the
+// moment it started, and the log gets, per step, who ran and when plus the
+// outcome of every chopstick CAS and the state the actor ended in. Sleep
+// lengths are not needed: they only decide when the next step runs, and
+// that time is in the log.
+//
+// Replay runs the same steps in the same order on one thread, with the
+// clock pinned to each step's recorded time, so it needs no sleeping and
+// no scheduler. Every CAS outcome and state transition is checked against
+// the log; the first mismatch is reported as a divergence. Replaying an old
+// schedule against changed code therefore shows where behaviour differs.
+//
+// The file is a header and a byte stream of records. Numbers are LEB128
+// varints; times are zigzag deltas from the previous step.
+//   SCHEDULE_STEP       actor, time delta
+//   SCHEDULE_CAS_FAIL   chopstick
+//   SCHEDULE_CAS_OK     chopstick
+//   SCHEDULE_STATE      new state, when the step changed it
+
+#define SCHEDULE_MAGIC "PHSCHED1"
+#define SCHEDULE_BUFFER_SIZE (1024 * 1024)
+
+enum {
+    SCHEDULE_STEP = 1,
+    SCHEDULE_CAS_FAIL,
+    SCHEDULE_CAS_OK,
+    SCHEDULE_STATE,
+};
+
+typedef enum {
+    SCHEDULE_OFF,
+    SCHEDULE_RECORD,
+    SCHEDULE_REPLAY,
+} ScheduleMode;
+
+// What replay needs to rebuild the same table
+typedef struct {
+    char magic[8];
+    char program[24];
+    int32_t num_philosophers;
+    int32_t acquire_pairs;
+    int64_t aging_threshold_ns;
+    uint64_t seed;
+} ScheduleHeader;
+
+typedef struct {
+    ScheduleMode mode;
+    const char* path;
+    ScheduleHeader header;
+    pthread_mutex_t lock;  // Record: one step at a time
+
+    // Record: buffered writes to file
+    FILE* file;
+    unsigned char* buffer;
+    size_t buffer_used;
+    long long bytes;
+
+    // Replay: the whole file in memory
+    unsigned char* data;
+    size_t size;
+    size_t position;
+
+    long long last_ns;  // Time of the previous step
+    long long steps;
+    int actor;          // Actor of the current step
+    int state_before;   // -1 for actors without a state
+    atomic_int* state;
+    int diverged;
+    char divergence[160];
+} ScheduleLog;
+
+static ScheduleLog schedule_log;
+
+static inline void schedule_put_varint(uint64_t value) {
+    ScheduleLog* log = &schedule_log;
+    if (log->buffer_used + 10 > SCHEDULE_BUFFER_SIZE) {
+        fwrite(log->buffer, 1, log->buffer_used, log->file);
+        log->bytes += log->buffer_used;
+        log->buffer_used = 0;
+    }
+    while (value >= 0x80) {
+        log->buffer[log->buffer_used++] = (unsigned char)(value | 0x80);
+        value >>= 7;
+    }
+    log->buffer[log->buffer_used++] = (unsigned char)value;
+}
+
+// Returns 0 at the end of the log
+static inline int schedule_get_varint(uint64_t* value) {
+    ScheduleLog* log = &schedule_log;
+    *value = 0;
+    for (int shift = 0; log->position < log->size && shift < 64; shift += 7) {
+        unsigned char byte = log->data[log->position++];
+        *value |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static inline uint64_t zigzag_encode(long long value) {
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static inline long long zigzag_decode(uint64_t value) {
+    return (long long)(value >> 1) ^ -(long long)(value & 1);
+}
+
+static inline int schedule_peek(void) {
+    return schedule_log.position < schedule_log.size ? schedule_log.data[schedule_log.position] : 0;
+}
+
+static inline void schedule_diverge(const char* what) {
+    ScheduleLog* log = &schedule_log;
+    if (!log->diverged) {
+        log->diverged = 1;
+        snprintf(log->divergence, sizeof(log->divergence), "step %lld (actor %d): %s", log->steps, log->actor, what);
+    }
+}
+
+// spec is record:FILE or replay:FILE. Recording writes header; replay
+// fills it in from the file for the caller to apply. Returns 0 or -1.
+static inline int schedule_open(const char* spec, ScheduleHeader* header) {
+    ScheduleLog* log = &schedule_log;
+    memset(log, 0, sizeof(*log));
+    pthread_mutex_init(&log->lock, NULL);
+    if (spec == NULL) {
+        return 0;
+    }
+    if (strncmp(spec, "record:", 7) == 0) {
+        log->mode = SCHEDULE_RECORD;
+        log->path = spec + 7;
+        log->file = fopen(log->path, "wb");
+        if (log->file == NULL) {
+            perror(log->path);
+            return -1;
+        }
+        memcpy(header->magic, SCHEDULE_MAGIC, sizeof(header->magic));
+        log->header = *header;
+        fwrite(header, sizeof(*header), 1, log->file);
+        log->buffer = malloc(SCHEDULE_BUFFER_SIZE);
+        return 0;
+    }
+    if (strncmp(spec, "replay:", 7) != 0) {
+        fprintf(stderr, "Unknown schedule mode: %s (record:FILE or replay:FILE)\n", spec);
+        return -1;
+    }
+
+    log->mode = SCHEDULE_REPLAY;
+    log->path = spec + 7;
+    FILE* file = fopen(log->path, "rb");
+    if (file == NULL) {
+        perror(log->path);
+        return -1;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if (size < (long)sizeof(ScheduleHeader) || fread(&log->header, sizeof(ScheduleHeader), 1, file) != 1 ||
+        memcmp(log->header.magic, SCHEDULE_MAGIC, sizeof(log->header.magic)) != 0) {
+        fprintf(stderr, "%s: not a schedule recording\n", log->path);
+        fclose(file);
+        return -1;
+    }
+    if (strncmp(log->header.program, header->program, sizeof(header->program)) != 0) {
+        fprintf(stderr, "%s was recorded by %.*s, not %s\n", log->path, (int)sizeof(log->header.program),
+                log->header.program, header->program);
+        fclose(file);
+        return -1;
+    }
+    log->size = (size_t)size - sizeof(ScheduleHeader);
+    log->data = malloc(log->size > 0 ? log->size : 1);
+    if (fread(log->data, 1, log->size, file) != log->size) {
+        perror(log->path);
+        fclose(file);
+        return -1;
+    }
+    fclose(file);
+    *header = log->header;
+    return 0;
+}
+
+// Start a step of actor. state is the actor's state word, or NULL.
+static inline void schedule_step_begin(int actor, atomic_int* state) {
+    ScheduleLog* log = &schedule_log;
+    if (log->mode == SCHEDULE_OFF) {
+        return;
+    }
+    if (log->mode == SCHEDULE_REPLAY) {
+        // schedule_replay() has read the step and pinned the clock
+        log->state = state;
+        log->state_before = state != NULL ? atomic_load(state) : -1;
+        return;
+    }
+    pthread_mutex_lock(&log->lock);
+    long long now = clock_now_ns();
+    schedule_put_varint(SCHEDULE_STEP);
+    schedule_put_varint((uint64_t)actor);
+    schedule_put_varint(zigzag_encode(now - log->last_ns));
+    log->last_ns = now;
+    log->steps++;
+    log->actor = actor;
+    log->state = state;
+    log->state_before = state != NULL ? atomic_load(state) : -1;
+    clock_pin(now);
+}
+
+static inline void schedule_step_end(void) {
+    ScheduleLog* log = &schedule_log;
+    if (log->mode == SCHEDULE_OFF) {
+        return;
+    }
+    int state = log->state != NULL ? atomic_load(log->state) : -1;
+    if (log->mode == SCHEDULE_RECORD) {
+        if (state != log->state_before) {
+            schedule_put_varint(SCHEDULE_STATE);
+            schedule_put_varint((uint64_t)state);
+        }
+        clock_unpin();
+        pthread_mutex_unlock(&log->lock);
+        return;
+    }
+
+    uint64_t recorded = (uint64_t)log->state_before;
+    if (schedule_peek() == SCHEDULE_STATE) {
+        log->position++;
+        schedule_get_varint(&recorded);
+    }
+    if ((int)recorded != state) {
+        char what[96];
+        snprintf(what, sizeof(what), "recorded state %d, replay reached %d", (int)recorded, state);
+        schedule_diverge(what);
+    }
+}
+
+// Log or check the outcome of a CAS on chopstick index; returns succeeded
+static inline int schedule_cas(int index, int succeeded) {
+    ScheduleLog* log = &schedule_log;
+    if (log->mode == SCHEDULE_RECORD) {
+        schedule_put_varint(succeeded ? SCHEDULE_CAS_OK : SCHEDULE_CAS_FAIL);
+        schedule_put_varint((uint64_t)index);
+    } else if (log->mode == SCHEDULE_REPLAY) {
+        int type = schedule_peek();
+        uint64_t recorded = 0;
+        if (type == SCHEDULE_CAS_OK || type == SCHEDULE_CAS_FAIL) {
+            log->position++;
+            schedule_get_varint(&recorded);
+        }
+        if (type != (succeeded ? SCHEDULE_CAS_OK : SCHEDULE_CAS_FAIL) || (int)recorded != index) {
+            char what[96];
+            snprintf(what, sizeof(what), "CAS on chopstick %d %s, not as recorded", index,
+                     succeeded ? "succeeded" : "failed");
+            schedule_diverge(what);
+        }
+    }
+    return succeeded;
+}
+
+// Replay every recorded step through step(actor), which runs the same code
+// as when recording, stopping at the first divergence. The clock is left at the last step's time so the summary
+// covers the recorded span. Returns 0 if the whole schedule matched.
+static inline int schedule_replay(void (*step)(int actor)) {
+    ScheduleLog* log = &schedule_log;
+    while (log->position < log->size && !log->diverged) {
+        uint64_t type, actor, delta;
+        if (!schedule_get_varint(&type) || type != SCHEDULE_STEP || !schedule_get_varint(&actor) ||
+            !schedule_get_varint(&delta)) {
+            schedule_diverge("log ends or has an unexpected record where a step should start");
+            break;
+        }
+        log->last_ns += zigzag_decode(delta);
+        log->steps++;
+        log->actor = (int)actor;
+        clock_pin(log->last_ns);
+        step((int)actor);
+    }
+    return log->diverged ? -1 : 0;
+}
+
+static inline void schedule_close(void) {
+    ScheduleLog* log = &schedule_log;
+    if (log->mode == SCHEDULE_RECORD) {
+        fwrite(log->buffer, 1, log->buffer_used, log->file);
+        log->bytes += log->buffer_used;
+        fclose(log->file);
+        free(log->buffer);
+        printf("Schedule: recorded %lld steps to %s, %lld bytes (%.2f per step)\n", log->steps, log->path,
+               log->bytes, log->steps > 0 ? (double)log->bytes / log->steps : 0.0);
+    } else if (log->mode == SCHEDULE_REPLAY) {
+        if (log->diverged) {
+            printf("Schedule: replay of %s diverged at %s\n", log->path, log->divergence);
+        } else {
+            printf("Schedule: replayed %lld steps from %s, every CAS and transition matched\n", log->steps,
+                   log->path);
+        }
+        free(log->data);
+    }
+}
+
+#endif // SCHEDULE_LOG_H
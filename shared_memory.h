@@ -0,0 +1,112 @@
+#ifndef SHARED_MEMORY_H
+#define SHARED_MEMORY_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+
+#include "philo_common.h"
+#include "futex_handoff.h"
+
+// Process mode (-F): every philosopher is a forked process, and the state
+// they share lives in one POSIX shared memory segment. shm_open() creates
+// the segment, it is mapped MAP_SHARED over a large sparse reservation and
+// unlinked straight away, so only the mappings keep it alive and nothing is
+// left behind in /dev/shm when the run ends or crashes.
+//
+// Allocation is a bump pointer, and all of it happens before the fork.
+// Every process therefore finds the tables at the same addresses, and
+// pointers into them stay valid on both sides.
+//
+// Modules that keep cross-philosopher state (chopsticks, arbiter tickets,
+// event rings) allocate it with shared_alloc(). That draws from the segment
+// once it is open and from the heap otherwise, so threaded runs are
+// unchanged. Opening the segment also makes mutexes from shared_mutex_init()
+// process-shared and drops FUTEX_PRIVATE_FLAG from futex calls.
+
+#define SHARED_MEMORY_RESERVE_BYTES (4LL << 30)  // Sparse; only touched pages use memory
+
+typedef struct {
+    char* base;   // NULL until shared_memory_open()
+    size_t used;
+} SharedMemory;
+
+static SharedMemory shared_memory;
+
+// Returns 0 on success
+static inline int shared_memory_open(void) {
+    char name[64];
+    snprintf(name, sizeof(name), "/philosophers-%d", (int)getpid());
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) {
+        perror(name);
+        return -1;
+    }
+    void* base = MAP_FAILED;
+    if (ftruncate(fd, SHARED_MEMORY_RESERVE_BYTES) == 0) {
+        base = mmap(NULL, SHARED_MEMORY_RESERVE_BYTES, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_NORESERVE, fd, 0);
+    }
+    if (base == MAP_FAILED) {
+        perror(name);
+    }
+    shm_unlink(name);
+    close(fd);
+    if (base == MAP_FAILED) {
+        return -1;
+    }
+    shared_memory.base = base;
+    shared_memory.used = 0;
+    futex_share_between_processes();
+    return 0;
+}
+
+static inline int shared_memory_contains(const void* memory) {
+    return shared_memory.base != NULL && (const char*)memory >= shared_memory.base &&
+           (const char*)memory < shared_memory.base + SHARED_MEMORY_RESERVE_BYTES;
+}
+
+// Zeroed, cache-aligned array as from alloc_cache_aligned(); in the segment
+// if it is open. Fresh tmpfs pages read as zero, so nothing is cleared.
+static inline void* shared_alloc(size_t count, size_t element_size) {
+    if (shared_memory.base == NULL) {
+        return alloc_cache_aligned(count, element_size);
+    }
+    size_t bytes = count * element_size;
+    bytes = (bytes + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+    if (bytes > (size_t)SHARED_MEMORY_RESERVE_BYTES - shared_memory.used) {
+        fprintf(stderr, "Shared memory segment is full (%lld bytes)\n", SHARED_MEMORY_RESERVE_BYTES);
+        exit(1);
+    }
+    void* memory = shared_memory.base + shared_memory.used;
+    shared_memory.used += bytes;
+    return memory;
+}
+
+// Memory in the segment goes away with it
+static inline void shared_free(void* memory) {
+    if (!shared_memory_contains(memory)) {
+        free(memory);
+    }
+}
+
+static inline void shared_mutex_init(pthread_mutex_t* mutex) {
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    if (shared_memory.base != NULL) {
+        pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    }
+    pthread_mutex_init(mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+static inline void shared_memory_close(void) {
+    if (shared_memory.base != NULL) {
+        munmap(shared_memory.base, SHARED_MEMORY_RESERVE_BYTES);
+        shared_memory.base = NULL;
+    }
+}
+
+#endif // SHARED_MEMORY_H
@@ -0,0 +1,326 @@
+#ifndef SIM_CLOCK_H
+#define SIM_CLOCK_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "futex_handoff.h"
+
+// Simulation clock used for every think/eat delay and wait timeout.
+//
+// Real mode: time is CLOCK_MONOTONIC since clock_init() multiplied by a scale
+// factor, so -s 100 runs the simulation a hundred times faster.
+//
+// Virtual mode: a discrete-event clock. Time only moves when every registered
+// thread is asleep in clock_sleep_ns() (or has declared itself blocked); it
+// then jumps straight to the earliest wake-up, skipping all idle time.
+
+typedef struct Sleeper {
+    long long wake_ns;
+    unsigned long long order;  // FIFO among equal wake times keeps runs repeatable
+    pthread_cond_t cond;
+    int woken;
+} Sleeper;
+
+typedef struct {
+    int virtual_mode;
+    double scale;                // Simulated seconds per real second
+    long long start_real_ns;
+    atomic_int interrupted;      // Futex word: set once by clock_interrupt()
+    long long limit_ns;          // -d: the run never counts as longer (LLONG_MAX: none)
+    _Atomic long long stop_ns;   // When the run was stopped, -1 while it goes on
+    _Atomic long long stop_real_ns;
+
+    pthread_mutex_t lock;        // Virtual mode only
+    _Atomic long long now_ns;
+    int active;                  // Registered threads that are not asleep
+    unsigned long long next_order;
+    Sleeper** sleepers;          // Min-heap on (wake_ns, order)
+    int num_sleepers;
+    int sleeper_capacity;
+} SimClock;
+
+static SimClock sim_clock;
+
+// Record/replay (schedule_log.h) fixes the time one step of this thread sees
+static _Thread_local long long clock_pinned_ns = -1;
+
+static inline void clock_init(double scale, int virtual_mode) {
+    sim_clock.virtual_mode = virtual_mode;
+    sim_clock.scale = scale > 0 ? scale : 1.0;
+    sim_clock.start_real_ns = monotonic_ns();
+    atomic_init(&sim_clock.interrupted, 0);
+    sim_clock.limit_ns = LLONG_MAX;
+    atomic_init(&sim_clock.stop_ns, -1);
+    atomic_init(&sim_clock.stop_real_ns, 0);
+    pthread_mutex_init(&sim_clock.lock, NULL);
+    atomic_init(&sim_clock.now_ns, 0);
+    sim_clock.active = 0;
+    sim_clock.next_order = 0;
+    sim_clock.num_sleepers = 0;
+    sim_clock.sleeper_capacity = 64;
+    sim_clock.sleepers = malloc(sim_clock.sleeper_capacity * sizeof(Sleeper*));
+}
+
+static inline long long clock_now_ns(void) {
+    if (clock_pinned_ns >= 0) {
+        return clock_pinned_ns;
+    }
+    if (sim_clock.virtual_mode) {
+        return atomic_load(&sim_clock.now_ns);
+    }
+    return (long long)((monotonic_ns() - sim_clock.start_real_ns) * sim_clock.scale);
+}
+
+static inline void clock_pin(long long now_ns) {
+    clock_pinned_ns = now_ns;
+}
+
+static inline void clock_unpin(void) {
+    clock_pinned_ns = -1;
+}
+
+// Convert a simulated duration into a real timeout for futex waits
+static inline long long clock_real_timeout_ns(long long simulated_ns) {
+    return (long long)(simulated_ns / sim_clock.scale);
+}
+
+static inline int sleeper_before(const Sleeper* a, const Sleeper* b) {
+    return a->wake_ns < b->wake_ns || (a->wake_ns == b->wake_ns && a->order < b->order);
+}
+
+static inline void clock_push_sleeper(Sleeper* sleeper) {
+    if (sim_clock.num_sleepers == sim_clock.sleeper_capacity) {
+        sim_clock.sleeper_capacity *= 2;
+        sim_clock.sleepers = realloc(sim_clock.sleepers, sim_clock.sleeper_capacity * sizeof(Sleeper*));
+    }
+    int i = sim_clock.num_sleepers++;
+    while (i > 0 && sleeper_before(sleeper, sim_clock.sleepers[(i - 1) / 2])) {
+        sim_clock.sleepers[i] = sim_clock.sleepers[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    sim_clock.sleepers[i] = sleeper;
+}
+
+static inline Sleeper* clock_pop_sleeper(void) {
+    Sleeper* top = sim_clock.sleepers[0];
+    Sleeper* last = sim_clock.sleepers[--sim_clock.num_sleepers];
+    int i = 0;
+    while (2 * i + 1 < sim_clock.num_sleepers) {
+        int child = 2 * i + 1;
+        if (child + 1 < sim_clock.num_sleepers &&
+            sleeper_before(sim_clock.sleepers[child + 1], sim_clock.sleepers[child])) {
+            child++;
+        }
+        if (!sleeper_before(sim_clock.sleepers[child], last)) {
+            break;
+        }
+        sim_clock.sleepers[i] = sim_clock.sleepers[child];
+        i = child;
+    }
+    sim_clock.sleepers[i] = last;
+    return top;
+}
+
+static inline void clock_wake_sleeper(Sleeper* sleeper) {
+    sleeper->woken = 1;
+    sim_clock.active++;
+    pthread_cond_signal(&sleeper->cond);
+}
+
+static inline void clock_wake_all_locked(void) {
+    while (sim_clock.num_sleepers > 0) {
+        clock_wake_sleeper(clock_pop_sleeper());
+    }
+}
+
+// Everyone is asleep: jump to the earliest wake-up. Caller holds the lock.
+static inline void clock_advance_locked(void) {
+    if (sim_clock.active > 0 || sim_clock.num_sleepers == 0) {
+        return;
+    }
+    long long wake_ns = sim_clock.sleepers[0]->wake_ns;
+    if (wake_ns > atomic_load(&sim_clock.now_ns)) {
+        atomic_store(&sim_clock.now_ns, wake_ns);
+    }
+    while (sim_clock.num_sleepers > 0 && sim_clock.sleepers[0]->wake_ns <= wake_ns) {
+        clock_wake_sleeper(clock_pop_sleeper());
+    }
+}
+
+// Called by the creating thread before pthread_create(), so the new thread
+// counts as running before it has had a chance to start. main() registers
+// itself too while it starts the simulation; otherwise the first threads
+// would sleep, and time would run, while the rest are still being created.
+static inline void clock_register_thread(void) {
+    if (sim_clock.virtual_mode) {
+        pthread_mutex_lock(&sim_clock.lock);
+        sim_clock.active++;
+        pthread_mutex_unlock(&sim_clock.lock);
+    }
+}
+
+// Called by a registered thread when it stops taking part in the simulation
+static inline void clock_thread_exit(void) {
+    if (sim_clock.virtual_mode) {
+        pthread_mutex_lock(&sim_clock.lock);
+        sim_clock.active--;
+        clock_advance_locked();
+        pthread_mutex_unlock(&sim_clock.lock);
+    }
+}
+
+// A registered thread about to block on something other than the clock (a
+// condition variable) must bracket the wait with these. Whoever wakes it
+// calls clock_unblock_other() first, so time cannot run ahead of the handoff.
+static inline void clock_block_begin(void) {
+    clock_thread_exit();
+}
+
+static inline void clock_block_end(void) {
+    clock_register_thread();
+}
+
+static inline void clock_unblock_other(void) {
+    clock_register_thread();
+}
+
+static inline void clock_sleep_ns(long long duration_ns) {
+    if (atomic_load(&sim_clock.interrupted) || duration_ns <= 0) {
+        return;
+    }
+
+    if (!sim_clock.virtual_mode) {
+        // Sleep on the interrupt word so clock_interrupt() ends every sleep at once
+        long long deadline = monotonic_ns() + clock_real_timeout_ns(duration_ns);
+        long long remaining;
+        while ((remaining = deadline - monotonic_ns()) > 0 && !atomic_load(&sim_clock.interrupted)) {
+            futex_wait(&sim_clock.interrupted, 0, remaining);
+        }
+        return;
+    }
+
+    Sleeper sleeper;
+    pthread_cond_init(&sleeper.cond, NULL);
+    sleeper.woken = 0;
+
+    pthread_mutex_lock(&sim_clock.lock);
+    if (!atomic_load(&sim_clock.interrupted)) {
+        sleeper.wake_ns = atomic_load(&sim_clock.now_ns) + duration_ns;
+        sleeper.order = sim_clock.next_order++;
+        clock_push_sleeper(&sleeper);
+        sim_clock.active--;
+        clock_advance_locked();
+        while (!sleeper.woken) {
+            if (atomic_load(&sim_clock.interrupted)) {
+                // Set from a signal handler, which cannot take the lock
+                clock_wake_all_locked();
+                break;
+            }
+            struct timespec recheck;
+            clock_gettime(CLOCK_REALTIME, &recheck);
+            recheck.tv_nsec += 100 * NS_PER_MS;
+            if (recheck.tv_nsec >= NS_PER_SEC) {
+                recheck.tv_sec++;
+                recheck.tv_nsec -= NS_PER_SEC;
+            }
+            pthread_cond_timedwait(&sleeper.cond, &sim_clock.lock, &recheck);
+        }
+    }
+    pthread_mutex_unlock(&sim_clock.lock);
+    pthread_cond_destroy(&sleeper.cond);
+}
+
+// Record the end of the run the first time it is stopped, capped at -d. The
+// report reads it after the threads have been joined, which can take a
+// second of real time and, under -s, many simulated ones. Async-signal-safe.
+static inline void clock_mark_stop(void) {
+    long long now_real_ns = monotonic_ns();
+    long long now_ns = clock_now_ns();
+    if (now_ns > sim_clock.limit_ns) {
+        now_ns = sim_clock.limit_ns;
+        if (!sim_clock.virtual_mode) {
+            now_real_ns = sim_clock.start_real_ns + clock_real_timeout_ns(now_ns);
+        }
+    }
+    long long unset = -1;
+    if (atomic_compare_exchange_strong(&sim_clock.stop_ns, &unset, now_ns)) {
+        atomic_store(&sim_clock.stop_real_ns, now_real_ns);
+    }
+}
+
+// Simulated end of the run for the reports: when it was stopped, or now
+static inline long long clock_end_ns(void) {
+    long long stop_ns = atomic_load(&sim_clock.stop_ns);
+    return stop_ns >= 0 ? stop_ns : clock_now_ns();
+}
+
+// Real time the run took, up to the same point as clock_end_ns()
+static inline long long clock_real_elapsed_ns(void) {
+    long long end_real_ns = atomic_load(&sim_clock.stop_ns) >= 0 ? atomic_load(&sim_clock.stop_real_ns)
+                                                                 : monotonic_ns();
+    return end_real_ns - sim_clock.start_real_ns;
+}
+
+// End every current and future sleep immediately (used for shutdown)
+static inline void clock_interrupt(void) {
+    clock_mark_stop();
+    atomic_store(&sim_clock.interrupted, 1);
+    futex_wake(&sim_clock.interrupted, INT_MAX);
+    if (sim_clock.virtual_mode) {
+        pthread_mutex_lock(&sim_clock.lock);
+        clock_wake_all_locked();
+        pthread_mutex_unlock(&sim_clock.lock);
+    }
+}
+
+// Async-signal-safe part of clock_interrupt() for SIGINT: real-time sleeps
+// end at once and virtual-time sleepers finish the job on their next recheck
+static inline void clock_interrupt_from_signal(void) {
+    clock_mark_stop();
+    atomic_store(&sim_clock.interrupted, 1);
+    futex_wake(&sim_clock.interrupted, INT_MAX);
+}
+
+typedef struct {
+    long long duration_ns;
+    atomic_int* running;
+} StopTimer;
+
+static inline void* clock_stop_timer_routine(void* arg) {
+    StopTimer* timer = (StopTimer*)arg;
+    clock_sleep_ns(timer->duration_ns);
+    clock_mark_stop();
+    atomic_store(timer->running, 0);
+    clock_interrupt();
+    clock_thread_exit();
+    return NULL;
+}
+
+// Clear *running and interrupt all sleeps after a simulated duration
+static inline void clock_start_stop_timer(StopTimer* timer, int seconds, atomic_int* running) {
+    pthread_t thread;
+    timer->duration_ns = seconds * NS_PER_SEC;
+    sim_clock.limit_ns = timer->duration_ns;
+    timer->running = running;
+    clock_register_thread();
+    pthread_create(&thread, NULL, clock_stop_timer_routine, timer);
+    pthread_detach(thread);
+}
+
+// end_ns: clock_end_ns(), read once so every report divides by the same time
+static inline void print_meal_throughput(long long total_meals, long long end_ns) {
+    double simulated = (double)end_ns / NS_PER_SEC;
+    double real = (double)clock_real_elapsed_ns() / NS_PER_SEC;
+    printf("\nTotal meals: %lld in %.1f s (%.2f meals/sec)", total_meals, simulated,
+           simulated > 0 ? total_meals / simulated : 0.0);
+    if (sim_clock.virtual_mode || sim_clock.scale != 1.0) {
+        printf(", %.2f s real (%.2f meals/sec real)", real, real > 0 ? total_meals / real : 0.0);
+    }
+    printf("\n");
+}
+
+#endif // SIM_CLOCK_H
@@ -0,0 +1,69 @@
+#ifndef STATUS_SNAPSHOT_H
+#define STATUS_SNAPSHOT_H
+
+#include <stdatomic.h>
+
+#include "philo_common.h"
+
+#define HOLDS_LEFT 1
+#define HOLDS_RIGHT 2
+
+// What print_status() shows for one philosopher
+typedef struct {
+    int state;
+    int invoke_count;
+    int must_think;
+    int held;  // HOLDS_LEFT / HOLDS_RIGHT bits
+} StatusRecord;
+
+// Seqlock-protected copy of a StatusRecord. Philosophers publish after each
+// transition and the renderer copies without ever blocking them; the
+// sequence is odd while a publish is in progress.
+typedef struct {
+    _Alignas(CACHE_LINE_SIZE) atomic_uint seq;
+    atomic_int state;
+    atomic_int invoke_count;
+    atomic_int must_think;
+    atomic_int held;
+} StatusSlot;
+
+static inline void status_publish(StatusSlot* slot, const StatusRecord* record) {
+    // Writers are almost always the owning thread; the CAS only serialises
+    // the rare publish from another thread (e.g. the manager)
+    unsigned int seq = atomic_load_explicit(&slot->seq, memory_order_relaxed);
+    for (;;) {
+        if ((seq & 1) == 0 &&
+            atomic_compare_exchange_weak_explicit(&slot->seq, &seq, seq + 1,
+                                                  memory_order_relaxed, memory_order_relaxed)) {
+            break;
+        }
+        seq = atomic_load_explicit(&slot->seq, memory_order_relaxed);
+    }
+    atomic_thread_fence(memory_order_release);
+
+    atomic_store_explicit(&slot->state, record->state, memory_order_relaxed);
+    atomic_store_explicit(&slot->invoke_count, record->invoke_count, memory_order_relaxed);
+    atomic_store_explicit(&slot->must_think, record->must_think, memory_order_relaxed);
+    atomic_store_explicit(&slot->held, record->held, memory_order_relaxed);
+
+    atomic_store_explicit(&slot->seq, seq + 2, memory_order_release);
+}
+
+static inline void status_read(StatusSlot* slot, StatusRecord* record) {
+    for (;;) {
+        unsigned int before = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        if (before & 1) {
+            continue;
+        }
+        record->state = atomic_load_explicit(&slot->state, memory_order_relaxed);
+        record->invoke_count = atomic_load_explicit(&slot->invoke_count, memory_order_relaxed);
+        record->must_think = atomic_load_explicit(&slot->must_think, memory_order_relaxed);
+        record->held = atomic_load_explicit(&slot->held, memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&slot->seq, memory_order_relaxed) == before) {
+            return;
+        }
+    }
+}
+
+#endif // STATUS_SNAPSHOT_H
@@ -0,0 +1,162 @@
+#ifndef TASK_POOL_H
+#define TASK_POOL_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "philo_common.h"
+#include "sim_clock.h"
+#include "work_stealing.h"
+#include "numa_placement.h"
+
+// Runs N philosophers on a fixed set of worker threads. A philosopher is a
+// resumable task: each call of its step function runs it up to the point
+// where its thread would have slept and returns that sleep in simulated ns.
+//
+// Tasks are split statically across workers and each worker keeps its own
+// timer heap, so workers share no scheduler state; the tasks themselves
+// still contend on chopsticks and the clock as threads would.
+// A worker sleeps on the simulation clock until its earliest timer is due,
+// which also makes pool mode work with -s and -V.
+//
+// With -N (numa_placement.h) each worker steps a contiguous block of the
+// ring instead and runs on the node that holds the block's memory.
+//
+// With work_stealing set the pool delegates to work_stealing.h instead,
+// where tasks move between workers to balance bursts.
+
+typedef long long (*TaskStepFn)(void* task);
+
+typedef struct {
+    long long wake_ns;
+    int task;
+} PoolTimer;
+
+struct TaskPool;
+
+typedef struct {
+    _Alignas(CACHE_LINE_SIZE) PoolTimer* timers;  // Min-heap on wake_ns
+    int num_timers;
+    int index;
+    pthread_t thread;
+    struct TaskPool* pool;
+} PoolWorker;
+
+typedef struct TaskPool {
+    PoolWorker* workers;
+    int num_workers;
+    char* tasks;
+    size_t task_size;
+    TaskStepFn step;
+    atomic_int* running;
+    int work_stealing;
+    StealPool steal;
+} TaskPool;
+
+static inline void pool_timer_push(PoolWorker* worker, PoolTimer timer) {
+    int i = worker->num_timers++;
+    while (i > 0 && worker->timers[(i - 1) / 2].wake_ns > timer.wake_ns) {
+        worker->timers[i] = worker->timers[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    worker->timers[i] = timer;
+}
+
+static inline PoolTimer pool_timer_pop(PoolWorker* worker) {
+    PoolTimer top = worker->timers[0];
+    PoolTimer last = worker->timers[--worker->num_timers];
+    int i = 0;
+    while (2 * i + 1 < worker->num_timers) {
+        int child = 2 * i + 1;
+        if (child + 1 < worker->num_timers && worker->timers[child + 1].wake_ns < worker->timers[child].wake_ns) {
+            child++;
+        }
+        if (last.wake_ns <= worker->timers[child].wake_ns) {
+            break;
+        }
+        worker->timers[i] = worker->timers[child];
+        i = child;
+    }
+    worker->timers[i] = last;
+    return top;
+}
+
+static inline void* pool_worker_routine(void* arg) {
+    PoolWorker* worker = (PoolWorker*)arg;
+    TaskPool* pool = worker->pool;
+    if (numa_placement.enabled) {
+        numa_pin_worker(worker->index, pool->num_workers, 0);
+    }
+
+    while (atomic_load(pool->running) && worker->num_timers > 0) {
+        long long now = clock_now_ns();
+        if (worker->timers[0].wake_ns > now) {
+            clock_sleep_ns(worker->timers[0].wake_ns - now);
+            continue;
+        }
+        PoolTimer timer = pool_timer_pop(worker);
+        long long delay_ns = pool->step(pool->tasks + (size_t)timer.task * pool->task_size);
+        timer.wake_ns = clock_now_ns() + delay_ns;
+        pool_timer_push(worker, timer);
+    }
+    clock_thread_exit();
+    return NULL;
+}
+
+// Start num_workers threads stepping num_tasks tasks of task_size bytes each.
+// Task i starts on worker i % num_workers, or on the worker owning its
+// block under -N; all tasks are due immediately.
+static inline int task_pool_start(TaskPool* pool, int num_workers, int work_stealing, void* tasks,
+                                  size_t task_size, int num_tasks, TaskStepFn step, atomic_int* running) {
+    pool->work_stealing = work_stealing;
+    if (work_stealing) {
+        return steal_pool_start(&pool->steal, num_workers, tasks, task_size, num_tasks, step, running);
+    }
+    if (num_workers > num_tasks) {
+        num_workers = num_tasks;
+    }
+    pool->workers = alloc_cache_aligned(num_workers, sizeof(PoolWorker));
+    pool->num_workers = num_workers;
+    pool->tasks = tasks;
+    pool->task_size = task_size;
+    pool->step = step;
+    pool->running = running;
+
+    for (int w = 0; w < num_workers; w++) {
+        PoolWorker* worker = &pool->workers[w];
+        worker->timers = malloc(((num_tasks + num_workers - 1) / num_workers) * sizeof(PoolTimer));
+        worker->num_timers = 0;
+        worker->index = w;
+        worker->pool = pool;
+    }
+    for (int i = 0; i < num_tasks; i++) {
+        int w = numa_placement.enabled ? numa_task_worker(i, num_workers) : i % num_workers;
+        pool_timer_push(&pool->workers[w], (PoolTimer){0, i});
+    }
+
+    for (int w = 0; w < num_workers; w++) {
+        clock_register_thread();
+        if (pthread_create(&pool->workers[w].thread, NULL, pool_worker_routine, &pool->workers[w]) != 0) {
+            fprintf(stderr, "Failed to create pool worker %d\n", w);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static inline void task_pool_join(TaskPool* pool) {
+    if (pool->work_stealing) {
+        steal_pool_join(&pool->steal);
+        return;
+    }
+    for (int w = 0; w < pool->num_workers; w++) {
+        pthread_join(pool->workers[w].thread, NULL);
+        free(pool->workers[w].timers);
+    }
+    free(pool->workers);
+}
+
+#endif // TASK_POOL_H
@@ -0,0 +1,490 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "philo_common.h"
+#include "futex_handoff.h"
+#include "latency_histogram.h"
+#include "trace_log.h"
+
+// Offline analysis of a binary trace written with -t. TraceReader reads the
+// file in fixed-size blocks, so memory depends on the number of philosophers
+// and chopsticks, never on the length of the run. Each philosopher's records
+// are in time order (trace_log.h), which is all the per-philosopher and
+// per-chopstick bookkeeping below needs.
+//
+// Reports:
+//   utilisation   share of time each philosopher spent thinking, waiting
+//                 and eating, with meals, timeouts and the longest wait
+//   hold times    per chopstick: acquisitions, failed attempts, busy share,
+//                 mean and longest hold
+//   heatmaps      failed acquire attempts per chopstick over time, and the
+//                 share of time spent waiting per group of philosophers
+//   starvation    gaps between meals longer than a threshold
+//   promotions    how long the manager took to fill a free waiting slot
+
+#define MAX_HELD 4                      // Chopsticks one philosopher holds at once
+#define HEATMAP_ROWS 24
+#define DEFAULT_HEATMAP_COLUMNS 64
+#define DEFAULT_TABLE_ROWS 16
+#define STARVATION_LIST_LIMIT 10
+
+static const char heat_shades[] = " .:-=+*#%@";
+
+typedef struct {
+    int state;                // 1 thinking, 2 waiting, 3 eating
+    long long since_ns;       // When it entered state
+    long long time_ns[4];     // Time spent in each state
+    long long meals;
+    long long timeouts;
+    long long longest_wait_ns;
+    long long last_meal_ns;   // Start of the last meal, or the trace start
+    long long longest_gap_ns; // Longest span without starting a meal
+    int held[MAX_HELD];
+    long long held_since_ns[MAX_HELD];
+    int num_held;
+} PhilosopherStats;
+
+typedef struct {
+    long long acquisitions;
+    long long contended;
+    long long hold_total_ns;
+    long long hold_max_ns;
+} ChopstickStats;
+
+// One gap between meals longer than the threshold
+typedef struct {
+    int philosopher;
+    long long start_ns;
+    long long length_ns;
+    int open;  // Still going when the trace ended
+} Starvation;
+
+struct {
+    const char* path;
+    int table_rows;
+    int columns;
+    double starvation_seconds;  // 0: twice the program's MAX_WAIT_TIME
+} options;
+
+TraceHeader header;
+PhilosopherStats* philosophers;
+ChopstickStats* chopsticks;
+long long* contention_heat;  // HEATMAP_ROWS x columns, failed attempts
+long long* waiting_heat;     // HEATMAP_ROWS x columns, ns spent waiting
+int chopsticks_per_row;
+int philosophers_per_row;
+long long starvation_threshold_ns;
+Starvation longest_starvations[STARVATION_LIST_LIMIT];
+int num_starvations_listed = 0;
+long long starvation_count = 0;
+long long starvation_total_ns = 0;
+long long bad_records = 0;
+long long promotions = 0;
+long long promotion_delay_total_us = 0;
+long long promotion_delay_max_us = 0;
+
+void usage(const char* program) {
+    fprintf(stderr, "Usage: %s [-p rows] [-c columns] [-s seconds] trace_file\n", program);
+    fprintf(stderr, "  -p <rows>    philosophers and chopsticks listed in the tables (default %d);\n",
+            DEFAULT_TABLE_ROWS);
+    fprintf(stderr, "               past that, the hungriest and most contended are shown\n");
+    fprintf(stderr, "  -c <count>   time columns in the heatmaps (default %d)\n", DEFAULT_HEATMAP_COLUMNS);
+    fprintf(stderr, "  -s <seconds> report gaps between meals longer than this\n");
+    fprintf(stderr, "               (default: twice the program's MAX_WAIT_TIME)\n");
+}
+
+int time_column(long long timestamp_ns) {
+    long long span_ns = header.end_ns - header.start_ns + 1;
+    long long column = (timestamp_ns - header.start_ns) * options.columns / span_ns;
+    return column < 0 ? 0 : column >= options.columns ? options.columns - 1 : (int)column;
+}
+
+// Spread a waiting interval over the heatmap columns it overlaps
+void add_waiting(int philosopher, long long start_ns, long long end_ns) {
+    long long* row = &waiting_heat[(philosopher / philosophers_per_row) * options.columns];
+    long long span_ns = header.end_ns - header.start_ns + 1;
+    for (int column = time_column(start_ns); column <= time_column(end_ns); column++) {
+        long long column_start = header.start_ns + span_ns * column / options.columns;
+        long long column_end = header.start_ns + span_ns * (column + 1) / options.columns;
+        long long from = start_ns > column_start ? start_ns : column_start;
+        long long to = end_ns < column_end ? end_ns : column_end;
+        if (to > from) {
+            row[column] += to - from;
+        }
+    }
+}
+
+void note_gap(int philosopher, long long start_ns, long long end_ns, int open) {
+    long long length_ns = end_ns - start_ns;
+    PhilosopherStats* stats = &philosophers[philosopher];
+    if (length_ns > stats->longest_gap_ns) {
+        stats->longest_gap_ns = length_ns;
+    }
+    if (length_ns <= starvation_threshold_ns) {
+        return;
+    }
+    starvation_count++;
+    starvation_total_ns += length_ns;
+
+    // Keep the longest few, longest first
+    if (num_starvations_listed == STARVATION_LIST_LIMIT &&
+        length_ns <= longest_starvations[num_starvations_listed - 1].length_ns) {
+        return;
+    }
+    int slot = num_starvations_listed < STARVATION_LIST_LIMIT ? num_starvations_listed++ : num_starvations_listed - 1;
+    for (; slot > 0 && longest_starvations[slot - 1].length_ns < length_ns; slot--) {
+        longest_starvations[slot] = longest_starvations[slot - 1];
+    }
+    longest_starvations[slot] = (Starvation){philosopher, start_ns, length_ns, open};
+}
+
+// Close the philosopher's current state at time now_ns
+void leave_state(int philosopher, long long now_ns) {
+    PhilosopherStats* stats = &philosophers[philosopher];
+    long long length_ns = now_ns - stats->since_ns;
+    stats->time_ns[stats->state] += length_ns;
+    if (stats->state == 2) {
+        if (length_ns > stats->longest_wait_ns) {
+            stats->longest_wait_ns = length_ns;
+        }
+        add_waiting(philosopher, stats->since_ns, now_ns);
+    }
+}
+
+void apply_record(const TraceRecord* record) {
+    int type = trace_record_type(record);
+    int arg = trace_record_arg(record);
+    long long now_ns = record->timestamp_ns;
+    if (type == TRACE_NONE) {
+        return;
+    }
+    if (!trace_record_valid(&header, record)) {
+        bad_records++;
+        return;
+    }
+    if (now_ns > header.end_ns) {
+        now_ns = header.end_ns;
+    }
+    PhilosopherStats* stats = &philosophers[record->source];
+
+    switch (type) {
+        case TRACE_STATE:
+            if (arg == stats->state) {
+                break;
+            }
+            leave_state(record->source, now_ns);
+            if (arg == 3) {
+                stats->meals++;
+                note_gap(record->source, stats->last_meal_ns, now_ns, 0);
+                stats->last_meal_ns = now_ns;
+            }
+            stats->state = arg;
+            stats->since_ns = now_ns;
+            break;
+        case TRACE_ACQUIRE:
+            chopsticks[arg].acquisitions++;
+            if (stats->num_held < MAX_HELD) {
+                stats->held[stats->num_held] = arg;
+                stats->held_since_ns[stats->num_held] = now_ns;
+                stats->num_held++;
+            }
+            break;
+        case TRACE_RELEASE:
+            for (int i = 0; i < stats->num_held; i++) {
+                if (stats->held[i] == arg) {
+                    long long hold_ns = now_ns - stats->held_since_ns[i];
+                    chopsticks[arg].hold_total_ns += hold_ns;
+                    if (hold_ns > chopsticks[arg].hold_max_ns) {
+                        chopsticks[arg].hold_max_ns = hold_ns;
+                    }
+                    stats->num_held--;
+                    stats->held[i] = stats->held[stats->num_held];
+                    stats->held_since_ns[i] = stats->held_since_ns[stats->num_held];
+                    break;
+                }
+            }
+            break;
+        case TRACE_CONTENDED:
+            chopsticks[arg].contended++;
+            contention_heat[(arg / chopsticks_per_row) * options.columns + time_column(now_ns)]++;
+            break;
+        case TRACE_TIMEOUT:
+            stats->timeouts++;
+            break;
+        case TRACE_PROMOTED:
+            promotions++;
+            promotion_delay_total_us += arg;
+            if (arg > promotion_delay_max_us) {
+                promotion_delay_max_us = arg;
+            }
+            break;
+    }
+}
+
+// Account for whatever was still going on when the trace ended
+void finish_trace(void) {
+    for (int i = 0; i < header.num_philosophers; i++) {
+        PhilosopherStats* stats = &philosophers[i];
+        leave_state(i, header.end_ns);
+        note_gap(i, stats->last_meal_ns, header.end_ns, 1);
+        for (int j = 0; j < stats->num_held; j++) {
+            long long hold_ns = header.end_ns - stats->held_since_ns[j];
+            chopsticks[stats->held[j]].hold_total_ns += hold_ns;
+            if (hold_ns > chopsticks[stats->held[j]].hold_max_ns) {
+                chopsticks[stats->held[j]].hold_max_ns = hold_ns;
+            }
+        }
+    }
+}
+
+int read_trace(void) {
+    TraceReader reader;
+    if (trace_reader_open(&reader, options.path) != 0) {
+        trace_reader_close(&reader);
+        return -1;
+    }
+    header = reader.header;
+
+    philosophers = calloc(header.num_philosophers, sizeof(PhilosopherStats));
+    chopsticks = calloc(header.num_chopsticks > 0 ? header.num_chopsticks : 1, sizeof(ChopstickStats));
+    philosophers_per_row = (header.num_philosophers + HEATMAP_ROWS - 1) / HEATMAP_ROWS;
+    chopsticks_per_row = header.num_chopsticks > 0 ? (header.num_chopsticks + HEATMAP_ROWS - 1) / HEATMAP_ROWS : 1;
+    contention_heat = calloc(HEATMAP_ROWS * options.columns, sizeof(long long));
+    waiting_heat = calloc(HEATMAP_ROWS * options.columns, sizeof(long long));
+    for (int i = 0; i < header.num_philosophers; i++) {
+        philosophers[i].state = 1;
+        philosophers[i].since_ns = header.start_ns;
+        philosophers[i].last_meal_ns = header.start_ns;
+    }
+    starvation_threshold_ns = options.starvation_seconds > 0 ? (long long)(options.starvation_seconds * NS_PER_SEC)
+                                                             : 2 * header.timeout_ns;
+
+    const TraceRecord* record;
+    while ((record = trace_reader_next(&reader)) != NULL) {
+        apply_record(record);
+    }
+    trace_reader_close(&reader);
+    finish_trace();
+    return 0;
+}
+
+double share(long long part_ns) {
+    return 100.0 * part_ns / (header.end_ns - header.start_ns);
+}
+
+int compare_by_eating(const void* a, const void* b) {
+    long long left = philosophers[*(const int*)a].time_ns[3];
+    long long right = philosophers[*(const int*)b].time_ns[3];
+    return (left > right) - (left < right);
+}
+
+int compare_by_contention(const void* a, const void* b) {
+    long long left = chopsticks[*(const int*)a].contended;
+    long long right = chopsticks[*(const int*)b].contended;
+    return (left < right) - (left > right);
+}
+
+// Indices 0..count-1, or the first table_rows of them in the given order
+int select_rows(int* rows, int count, int (*compare)(const void*, const void*)) {
+    for (int i = 0; i < count; i++) {
+        rows[i] = i;
+    }
+    if (count <= options.table_rows) {
+        return count;
+    }
+    qsort(rows, count, sizeof(int), compare);
+    return options.table_rows;
+}
+
+void print_utilisation(void) {
+    int* rows = malloc(header.num_philosophers * sizeof(int));
+    int shown = select_rows(rows, header.num_philosophers, compare_by_eating);
+    printf("\nUtilisation%s:\n", shown < header.num_philosophers ? " (least time eating first)" : "");
+    printf("  %-8s %7s %7s %7s %8s %8s %9s %9s\n", "", "think", "wait", "eat", "meals", "timeouts",
+           "max wait", "max gap");
+    for (int i = 0; i < shown; i++) {
+        PhilosopherStats* stats = &philosophers[rows[i]];
+        char wait[16], gap[16];
+        latency_format(wait, sizeof(wait), stats->longest_wait_ns);
+        latency_format(gap, sizeof(gap), stats->longest_gap_ns);
+        printf("  P%-7d %6.1f%% %6.1f%% %6.1f%% %8lld %8lld %9s %9s\n", rows[i], share(stats->time_ns[1]),
+               share(stats->time_ns[2]), share(stats->time_ns[3]), stats->meals, stats->timeouts, wait, gap);
+    }
+
+    double eat_min = 100, eat_max = 0, eat_sum = 0;
+    long long meals = 0, timeouts = 0;
+    for (int i = 0; i < header.num_philosophers; i++) {
+        double eat = share(philosophers[i].time_ns[3]);
+        eat_min = eat < eat_min ? eat : eat_min;
+        eat_max = eat > eat_max ? eat : eat_max;
+        eat_sum += eat;
+        meals += philosophers[i].meals;
+        timeouts += philosophers[i].timeouts;
+    }
+    printf("  Eating share min/mean/max: %.1f%% / %.1f%% / %.1f%%, %lld meals, %lld timeouts\n", eat_min,
+           eat_sum / header.num_philosophers, eat_max, meals, timeouts);
+    free(rows);
+}
+
+void print_chopsticks(void) {
+    if (header.num_chopsticks == 0) {
+        return;
+    }
+    int* rows = malloc(header.num_chopsticks * sizeof(int));
+    int shown = select_rows(rows, header.num_chopsticks, compare_by_contention);
+    printf("\nChopsticks%s:\n", shown < header.num_chopsticks ? " (most contended first)" : "");
+    printf("  %-8s %9s %9s %7s %9s %9s\n", "", "acquired", "contended", "busy", "mean hold", "max hold");
+    for (int i = 0; i < shown; i++) {
+        ChopstickStats* stats = &chopsticks[rows[i]];
+        char mean[16], max[16];
+        latency_format(mean, sizeof(mean), stats->acquisitions > 0 ? stats->hold_total_ns / stats->acquisitions : 0);
+        latency_format(max, sizeof(max), stats->hold_max_ns);
+        printf("  C%-7d %9lld %9lld %6.1f%% %9s %9s\n", rows[i], stats->acquisitions, stats->contended,
+               share(stats->hold_total_ns), mean, max);
+    }
+    free(rows);
+}
+
+// One row per group of items; shades scale with value / full
+void print_heatmap(const char* title, const long long* heat, int items, int per_row, char label, double full) {
+    int num_rows = (items + per_row - 1) / per_row;
+    printf("\n%s\n", title);
+    for (int row = 0; row < num_rows; row++) {
+        int first = row * per_row;
+        int last = first + per_row - 1 < items - 1 ? first + per_row - 1 : items - 1;
+        char name[32];
+        if (first == last) {
+            snprintf(name, sizeof(name), "%c%d", label, first);
+        } else {
+            snprintf(name, sizeof(name), "%c%d-%d", label, first, last);
+        }
+        printf("  %-14s|", name);
+        for (int column = 0; column < options.columns; column++) {
+            long long value = heat[row * options.columns + column];
+            int level = full > 0 ? (int)(value * (sizeof(heat_shades) - 2) / full + 0.5) : 0;
+            if (value > 0 && level == 0) {
+                level = 1;
+            }
+            if (level > (int)sizeof(heat_shades) - 2) {
+                level = sizeof(heat_shades) - 2;
+            }
+            putchar(heat_shades[level]);
+        }
+        printf("|\n");
+    }
+    printf("  %-14s 0s%*.0fs\n", "", options.columns - 1,
+           (double)(header.end_ns - header.start_ns) / NS_PER_SEC);
+}
+
+void print_heatmaps(void) {
+    if (header.num_chopsticks > 0) {
+        long long busiest = 0;
+        for (int i = 0; i < HEATMAP_ROWS * options.columns; i++) {
+            busiest = contention_heat[i] > busiest ? contention_heat[i] : busiest;
+        }
+        char title[128];
+        snprintf(title, sizeof(title), "Failed acquire attempts per chopstick over time ('%c' = %lld):",
+                 heat_shades[sizeof(heat_shades) - 2], busiest);
+        print_heatmap(title, contention_heat, header.num_chopsticks, chopsticks_per_row, 'C', busiest);
+    }
+
+    // Full shade: every philosopher in the row waited for the whole column
+    double column_ns = (double)(header.end_ns - header.start_ns + 1) / options.columns;
+    for (int row = 0; row < HEATMAP_ROWS; row++) {
+        int first = row * philosophers_per_row;
+        int size = header.num_philosophers - first < philosophers_per_row ? header.num_philosophers - first
+                                                                          : philosophers_per_row;
+        for (int column = 0; size > 0 && column < options.columns; column++) {
+            waiting_heat[row * options.columns + column] =
+                (long long)(waiting_heat[row * options.columns + column] * 1000.0 / (size * column_ns));
+        }
+    }
+    print_heatmap("Share of time spent waiting over time ('@' = always waiting):", waiting_heat,
+                  header.num_philosophers, philosophers_per_row, 'P', 1000);
+}
+
+void print_promotions(void) {
+    if (promotions == 0) {
+        return;
+    }
+    char mean[16], max[16];
+    latency_format(mean, sizeof(mean), promotion_delay_total_us / promotions * 1000);
+    latency_format(max, sizeof(max), promotion_delay_max_us * 1000);
+    printf("\nManager promotions: %lld, slot free to promotion mean %s, max %s\n", promotions, mean, max);
+}
+
+void print_starvation(void) {
+    char threshold[16], total[16];
+    latency_format(threshold, sizeof(threshold), starvation_threshold_ns);
+    latency_format(total, sizeof(total), starvation_total_ns);
+    printf("\nStarvation: %lld gaps between meals longer than %s, %s in total\n", starvation_count, threshold, total);
+    for (int i = 0; i < num_starvations_listed; i++) {
+        Starvation* starvation = &longest_starvations[i];
+        char length[16];
+        latency_format(length, sizeof(length), starvation->length_ns);
+        printf("  P%-7d from %8.1fs for %8s%s\n", starvation->philosopher,
+               (double)(starvation->start_ns - header.start_ns) / NS_PER_SEC, length,
+               starvation->open ? " (still hungry at the end)" : "");
+    }
+}
+
+int main(int argc, char* argv[]) {
+    options.table_rows = DEFAULT_TABLE_ROWS;
+    options.columns = DEFAULT_HEATMAP_COLUMNS;
+    options.starvation_seconds = 0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "p:c:s:h")) != -1) {
+        switch (opt) {
+            case 'p':
+                options.table_rows = atoi(optarg);
+                break;
+            case 'c':
+                options.columns = atoi(optarg);
+                break;
+            case 's':
+                options.starvation_seconds = atof(optarg);
+                break;
+            case 'h':
+            default:
+                usage(argv[0]);
+                exit(opt == 'h' ? 0 : 1);
+        }
+    }
+    if (optind != argc - 1 || options.table_rows < 1 || options.columns < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+    options.path = argv[optind];
+
+    long long start_ns = monotonic_ns();
+    if (read_trace() != 0) {
+        return 1;
+    }
+
+    printf("Trace %s: %.*s, %d philosophers, %d chopsticks, %.1f s simulated, %lld records",
+           options.path, (int)sizeof(header.program), header.program, header.num_philosophers,
+           header.num_chopsticks, (double)(header.end_ns - header.start_ns) / NS_PER_SEC,
+           (long long)header.num_records);
+    if (header.dropped > 0) {
+        printf(", %lld dropped while recording", (long long)header.dropped);
+    }
+    if (bad_records > 0) {
+        printf(", %lld malformed skipped", bad_records);
+    }
+    printf(" (read in %.2f s)\n", (double)(monotonic_ns() - start_ns) / NS_PER_SEC);
+
+    print_utilisation();
+    print_chopsticks();
+    print_heatmaps();
+    print_promotions();
+    print_starvation();
+
+    free(philosophers);
+    free(chopsticks);
+    free(contention_heat);
+    free(waiting_heat);
+    return 0;
+}
@@ -0,0 +1,337 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "philo_common.h"
+#include "futex_handoff.h"
+#include "trace_log.h"
+
+// Turn a binary trace written with -t into Chrome Trace Event JSON, which
+// chrome://tracing and ui.perfetto.dev both open. Everything sits in one
+// process with the tracks interleaved around the table: P0, C0, P1, C1, ...
+// where Ci is the chopstick between Pi and Pi+1. A free chopstick next to a
+// waiting philosopher is then a gap right beside a "waiting" slice.
+//
+//   Pi        thinking / waiting / eating slices, timeout instants
+//   Ci        one slice per hold, named after the holder, plus "contended"
+//             instants for acquire attempts that found it taken
+//   manager   one slice per promotion, from the moment a waiting slot
+//             opened until the manager filled it, so late promotions show
+//             up as long bars (project_1_c only)
+//
+// Slices are written when they end, so the output is not sorted by time;
+// both viewers sort on load. -b/-e and -p cut the output down for long runs.
+
+#define MAX_HELD 4  // Chopsticks one philosopher holds at once
+
+static const char* const state_names[] = {"", "thinking", "waiting", "eating"};
+static const char* const state_colours[] = {"", "thread_state_sleeping", "bad", "good"};
+
+typedef struct {
+    int state;
+    long long since_ns;
+    int held[MAX_HELD];
+    long long held_since_ns[MAX_HELD];
+    int num_held;
+} TrackState;
+
+struct {
+    const char* path;
+    const char* output_path;
+    double begin_seconds;  // Window, relative to the trace start
+    double end_seconds;    // 0: until the end
+    int first;             // Philosophers (and their right chopsticks) exported
+    int last;
+    int contention;        // Export "contended" instants
+} options;
+
+TraceHeader header;
+TrackState* tracks;
+FILE* out;
+long long window_begin_ns;
+long long window_end_ns;
+long long events_written = 0;
+
+void usage(const char* program) {
+    fprintf(stderr, "Usage: %s [-b seconds] [-e seconds] [-p first-last] [-C] trace_file output.json\n", program);
+    fprintf(stderr, "  -b <seconds> start the export this far into the trace\n");
+    fprintf(stderr, "  -e <seconds> end it this far into the trace (default: the end)\n");
+    fprintf(stderr, "  -p <a-b>     only philosophers a to b and their right chopsticks\n");
+    fprintf(stderr, "  -C           leave out the \"contended\" instants, which every polling\n");
+    fprintf(stderr, "               retry produces\n");
+    fprintf(stderr, "Output \"-\" writes to stdout.\n");
+}
+
+int philosopher_tid(int philosopher) {
+    return 2 * philosopher + 1;
+}
+
+int chopstick_tid(int chopstick) {
+    return 2 * chopstick + 2;
+}
+
+// Also used for chopsticks: Ci is exported along with Pi
+int exported(int philosopher) {
+    return philosopher >= options.first && philosopher <= options.last;
+}
+
+// Trace Event timestamps are microseconds; keep the nanoseconds as decimals
+double event_us(long long timestamp_ns) {
+    return (double)(timestamp_ns - header.start_ns) / 1000;
+}
+
+void write_event_separator(void) {
+    fputs(events_written++ > 0 ? ",\n" : "\n", out);
+}
+
+// A complete ("X") slice, clipped to the window
+void write_slice(int tid, const char* name, const char* colour, long long start_ns, long long end_ns,
+                 const char* args) {
+    if (start_ns < window_begin_ns) {
+        start_ns = window_begin_ns;
+    }
+    if (end_ns > window_end_ns) {
+        end_ns = window_end_ns;
+    }
+    if (end_ns < start_ns) {
+        return;
+    }
+    write_event_separator();
+    fprintf(out, "{\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"name\":\"%s\",\"ts\":%.3f,\"dur\":%.3f", tid, name,
+            event_us(start_ns), (double)(end_ns - start_ns) / 1000);
+    if (colour != NULL) {
+        fprintf(out, ",\"cname\":\"%s\"", colour);
+    }
+    if (args != NULL) {
+        fprintf(out, ",\"args\":{%s}", args);
+    }
+    fputs("}", out);
+}
+
+void write_instant(int tid, const char* name, long long timestamp_ns, const char* args) {
+    if (timestamp_ns < window_begin_ns || timestamp_ns > window_end_ns) {
+        return;
+    }
+    write_event_separator();
+    fprintf(out, "{\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":%d,\"name\":\"%s\",\"ts\":%.3f", tid, name,
+            event_us(timestamp_ns));
+    if (args != NULL) {
+        fprintf(out, ",\"args\":{%s}", args);
+    }
+    fputs("}", out);
+}
+
+void write_track_name(int tid, const char* name) {
+    write_event_separator();
+    fprintf(out, "{\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"name\":\"thread_name\",\"args\":{\"name\":\"%s\"}}", tid,
+            name);
+    write_event_separator();
+    fprintf(out, "{\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"name\":\"thread_sort_index\",\"args\":{\"sort_index\":%d}}",
+            tid, tid);
+}
+
+void write_track_names(void) {
+    char name[32];
+    write_event_separator();
+    fprintf(out, "{\"ph\":\"M\",\"pid\":1,\"name\":\"process_name\",\"args\":{\"name\":\"%.*s\"}}",
+            (int)sizeof(header.program), header.program);
+    if (strncmp(header.program, "manager", sizeof(header.program)) == 0) {
+        write_track_name(0, "manager");
+    }
+    for (int i = options.first; i <= options.last; i++) {
+        snprintf(name, sizeof(name), "P%d", i);
+        write_track_name(philosopher_tid(i), name);
+        if (i < header.num_chopsticks) {
+            snprintf(name, sizeof(name), "C%d", i);
+            write_track_name(chopstick_tid(i), name);
+        }
+    }
+}
+
+void end_hold(int philosopher, int slot, long long now_ns) {
+    TrackState* track = &tracks[philosopher];
+    int chopstick = track->held[slot];
+    if (exported(chopstick)) {
+        char name[32], args[64];
+        snprintf(name, sizeof(name), "P%d", philosopher);
+        snprintf(args, sizeof(args), "\"holder\":%d", philosopher);
+        write_slice(chopstick_tid(chopstick), name, NULL, track->held_since_ns[slot], now_ns, args);
+    }
+    track->num_held--;
+    track->held[slot] = track->held[track->num_held];
+    track->held_since_ns[slot] = track->held_since_ns[track->num_held];
+}
+
+void apply_record(const TraceRecord* record) {
+    int type = trace_record_type(record);
+    int arg = trace_record_arg(record);
+    int philosopher = (int)record->source;
+    long long now_ns = record->timestamp_ns < header.end_ns ? record->timestamp_ns : header.end_ns;
+    TrackState* track = &tracks[philosopher];
+    char args[64];
+
+    switch (type) {
+        case TRACE_STATE:
+            if (arg == track->state) {
+                break;
+            }
+            if (exported(philosopher)) {
+                write_slice(philosopher_tid(philosopher), state_names[track->state], state_colours[track->state],
+                            track->since_ns, now_ns, NULL);
+            }
+            track->state = arg;
+            track->since_ns = now_ns;
+            break;
+        case TRACE_ACQUIRE:
+            if (track->num_held < MAX_HELD) {
+                track->held[track->num_held] = arg;
+                track->held_since_ns[track->num_held] = now_ns;
+                track->num_held++;
+            }
+            break;
+        case TRACE_RELEASE:
+            for (int i = 0; i < track->num_held; i++) {
+                if (track->held[i] == arg) {
+                    end_hold(philosopher, i, now_ns);
+                    break;
+                }
+            }
+            break;
+        case TRACE_CONTENDED:
+            if (options.contention && exported(arg)) {
+                snprintf(args, sizeof(args), "\"by\":%d", philosopher);
+                write_instant(chopstick_tid(arg), "contended", now_ns, args);
+            }
+            break;
+        case TRACE_TIMEOUT:
+            if (exported(philosopher)) {
+                write_instant(philosopher_tid(philosopher), "timeout", now_ns, NULL);
+            }
+            break;
+        case TRACE_PROMOTED:
+            if (exported(philosopher)) {
+                char name[32];
+                snprintf(name, sizeof(name), "promote P%d", philosopher);
+                snprintf(args, sizeof(args), "\"philosopher\":%d,\"delay_us\":%d", philosopher, arg);
+                write_slice(0, name, arg > 0 ? "bad" : NULL, now_ns - arg * 1000LL, now_ns, args);
+            }
+            break;
+    }
+}
+
+int export_trace(void) {
+    TraceReader reader;
+    if (trace_reader_open(&reader, options.path) != 0) {
+        trace_reader_close(&reader);
+        return -1;
+    }
+    header = reader.header;
+    if (options.last < 0 || options.last >= header.num_philosophers) {
+        options.last = header.num_philosophers - 1;
+    }
+    if (options.first > options.last) {
+        fprintf(stderr, "%s has philosophers 0-%d\n", options.path, header.num_philosophers - 1);
+        trace_reader_close(&reader);
+        return -1;
+    }
+    window_begin_ns = header.start_ns + (long long)(options.begin_seconds * NS_PER_SEC);
+    window_end_ns = options.end_seconds > 0 ? header.start_ns + (long long)(options.end_seconds * NS_PER_SEC)
+                                            : header.end_ns;
+    if (window_end_ns > header.end_ns) {
+        window_end_ns = header.end_ns;
+    }
+
+    tracks = calloc(header.num_philosophers, sizeof(TrackState));
+    for (int i = 0; i < header.num_philosophers; i++) {
+        tracks[i].state = 1;
+        tracks[i].since_ns = header.start_ns;
+    }
+
+    out = strcmp(options.output_path, "-") == 0 ? stdout : fopen(options.output_path, "w");
+    if (out == NULL) {
+        perror(options.output_path);
+        trace_reader_close(&reader);
+        return -1;
+    }
+    setvbuf(out, NULL, _IOFBF, 1 << 20);
+    fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", out);
+    write_track_names();
+
+    long long skipped = 0;
+    const TraceRecord* record;
+    while ((record = trace_reader_next(&reader)) != NULL) {
+        if (trace_record_type(record) == TRACE_NONE || !trace_record_valid(&header, record)) {
+            skipped += trace_record_type(record) != TRACE_NONE;
+            continue;
+        }
+        apply_record(record);
+    }
+    trace_reader_close(&reader);
+
+    // Close whatever was still open at the end
+    for (int i = 0; i < header.num_philosophers; i++) {
+        if (exported(i)) {
+            write_slice(philosopher_tid(i), state_names[tracks[i].state], state_colours[tracks[i].state],
+                        tracks[i].since_ns, header.end_ns, NULL);
+        }
+        while (tracks[i].num_held > 0) {
+            end_hold(i, 0, header.end_ns);
+        }
+    }
+    fputs("\n]}\n", out);
+    if (out != stdout) {
+        fclose(out);
+    } else {
+        fflush(out);
+    }
+    free(tracks);
+
+    fprintf(stderr, "Exported %lld events from %s", events_written, options.path);
+    if (skipped > 0) {
+        fprintf(stderr, ", %lld malformed records skipped", skipped);
+    }
+    fprintf(stderr, "\n");
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    options.begin_seconds = 0;
+    options.end_seconds = 0;
+    options.first = 0;
+    options.last = -1;
+    options.contention = 1;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "b:e:p:Ch")) != -1) {
+        switch (opt) {
+            case 'b':
+                options.begin_seconds = atof(optarg);
+                break;
+            case 'e':
+                options.end_seconds = atof(optarg);
+                break;
+            case 'p':
+                if (sscanf(optarg, "%d-%d", &options.first, &options.last) != 2 || options.first < 0 ||
+                    options.last < options.first) {
+                    fprintf(stderr, "Philosopher range must be first-last\n");
+                    exit(1);
+                }
+                break;
+            case 'C':
+                options.contention = 0;
+                break;
+            case 'h':
+            default:
+                usage(argv[0]);
+                exit(opt == 'h' ? 0 : 1);
+        }
+    }
+    if (optind != argc - 2) {
+        usage(argv[0]);
+        return 1;
+    }
+    options.path = argv[optind];
+    options.output_path = argv[optind + 1];
+    return export_trace() == 0 ? 0 : 1;
+}
@@ -0,0 +1,301 @@
+#ifndef TRACE_LOG_H
+#define TRACE_LOG_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+
+#include "philo_common.h"
+#include "sim_clock.h"
+
+// Binary state trace (-t FILE) for offline analysis with trace_analyze and
+// for timeline export with trace_export.
+//
+// The text event log formats one line per event, which at large N is more
+// output than anyone can read or store. The trace instead holds fixed
+// 16-byte records stamped with simulated nanoseconds: every state
+// transition, every chopstick acquire and release, every acquire attempt
+// that found the chopstick taken, every MAX_WAIT_TIME timeout and, in the
+// manager variant, every promotion of a thinker to waiting.
+//
+// The file is memory-mapped over a large sparse reservation. Each
+// philosopher owns a chunk of TRACE_CHUNK_RECORDS records (one page) and
+// claims the next free chunk with a single fetch-add when it fills up, so
+// recording an event is a store into the page cache with no lock, no
+// system call and no writer thread. A philosopher's records are therefore
+// in time order in the file, though chunks of different philosophers
+// interleave. trace_close() squeezes out the unused tails of the last
+// chunks, fills in the header and truncates the file.
+//
+// Only a philosopher's own thread (or, where a program serialises all
+// transitions under a mutex, whoever holds it) may record for it.
+
+#define TRACE_MAGIC "PHTRACE1"
+#define TRACE_DATA_OFFSET 4096                   // Records start on the second page
+#define TRACE_CHUNK_RECORDS 256                  // One page per claim
+#define TRACE_RESERVE_BYTES (16LL << 30)         // Sparse; only written pages use disk
+#define TRACE_READ_BLOCK 65536                   // Records per read in TraceReader
+#define TRACE_MAX_ARG 0xffffff
+
+enum {
+    TRACE_NONE,         // Unused slot
+    TRACE_STATE,        // arg: new state (1 thinking, 2 waiting, 3 eating)
+    TRACE_ACQUIRE,      // arg: chopstick
+    TRACE_RELEASE,      // arg: chopstick
+    TRACE_CONTENDED,    // arg: chopstick that was taken on an acquire attempt
+    TRACE_TIMEOUT,      // Waited past MAX_WAIT_TIME and went back to thinking
+    TRACE_PROMOTED,     // arg: us since a waiting slot opened (manager only)
+    TRACE_NUM_TYPES,
+};
+
+typedef struct {
+    int64_t timestamp_ns;  // Simulated time
+    uint32_t source;       // Philosopher
+    uint32_t detail;       // type | arg << 8
+} TraceRecord;
+
+// Every philosopher is thinking at start_ns; records refine that
+typedef struct {
+    char magic[8];
+    char program[24];
+    int32_t record_size;
+    int32_t num_philosophers;
+    int32_t num_chopsticks;
+    int32_t reserved;
+    int64_t timeout_ns;  // MAX_WAIT_TIME of the program
+    int64_t start_ns;
+    int64_t end_ns;
+    int64_t num_records;
+    int64_t dropped;     // Records lost because the reservation was full
+} TraceHeader;
+
+static inline int trace_record_type(const TraceRecord* record) {
+    return (int)(record->detail & 0xff);
+}
+
+static inline int trace_record_arg(const TraceRecord* record) {
+    return (int)(record->detail >> 8);
+}
+
+// Where a philosopher's next record goes
+typedef struct {
+    _Alignas(CACHE_LINE_SIZE) TraceRecord* next;
+    TraceRecord* end;
+} TraceCursor;
+
+typedef struct {
+    int enabled;
+    const char* path;
+    int fd;
+    char* map;
+    TraceRecord* records;
+    long long capacity;            // Whole chunks that fit in the reservation
+    atomic_llong next_chunk;
+    atomic_llong dropped;
+    TraceCursor* cursors;
+    TraceHeader header;
+} TraceLog;
+
+static TraceLog trace_log;
+
+static inline void trace_event(int source, int type, int arg) {
+    TraceLog* log = &trace_log;
+    if (!log->enabled) {
+        return;
+    }
+    if (source < 0 || source >= log->header.num_philosophers) {
+        return;  // Only philosophers have cursors
+    }
+    TraceCursor* cursor = &log->cursors[source];
+    if (cursor->next == cursor->end) {
+        long long chunk = atomic_fetch_add_explicit(&log->next_chunk, 1, memory_order_relaxed);
+        if (chunk >= log->capacity) {
+            atomic_fetch_add_explicit(&log->dropped, 1, memory_order_relaxed);
+            return;
+        }
+        cursor->next = log->records + chunk * TRACE_CHUNK_RECORDS;
+        cursor->end = cursor->next + TRACE_CHUNK_RECORDS;
+    }
+    TraceRecord* record = cursor->next++;
+    record->timestamp_ns = clock_now_ns();
+    record->source = (uint32_t)source;
+    record->detail = (uint32_t)type | (uint32_t)(arg < TRACE_MAX_ARG ? arg : TRACE_MAX_ARG) << 8;
+}
+
+// Start tracing to path (NULL: tracing stays off). Call after clock_init()
+// and before any philosopher runs. Returns 0 on success.
+static inline int trace_open(const char* path, const char* program, int num_philosophers, int num_chopsticks,
+                             long long timeout_ns) {
+    TraceLog* log = &trace_log;
+    memset(log, 0, sizeof(*log));
+    if (path == NULL) {
+        return 0;
+    }
+    log->path = path;
+    log->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (log->fd < 0 || ftruncate(log->fd, TRACE_RESERVE_BYTES) != 0) {
+        perror(path);
+        return -1;
+    }
+    log->map = mmap(NULL, TRACE_RESERVE_BYTES, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_NORESERVE, log->fd, 0);
+    if (log->map == MAP_FAILED) {
+        perror("mmap");
+        return -1;
+    }
+    log->records = (TraceRecord*)(log->map + TRACE_DATA_OFFSET);
+    log->capacity = (TRACE_RESERVE_BYTES - TRACE_DATA_OFFSET) / (TRACE_CHUNK_RECORDS * (long long)sizeof(TraceRecord));
+    atomic_init(&log->next_chunk, 0);
+    atomic_init(&log->dropped, 0);
+    log->cursors = alloc_cache_aligned(num_philosophers, sizeof(TraceCursor));
+
+    TraceHeader* header = &log->header;
+    memcpy(header->magic, TRACE_MAGIC, sizeof(header->magic));
+    strncpy(header->program, program, sizeof(header->program) - 1);
+    header->record_size = sizeof(TraceRecord);
+    header->num_philosophers = num_philosophers;
+    header->num_chopsticks = num_chopsticks;
+    header->timeout_ns = timeout_ns;
+    header->start_ns = clock_now_ns();
+    log->enabled = 1;
+    return 0;
+}
+
+// Stop tracing once every philosopher has stopped: compact, write the
+// header and cut the file to its used length
+static inline void trace_close(void) {
+    TraceLog* log = &trace_log;
+    if (!log->enabled) {
+        return;
+    }
+    log->enabled = 0;
+    long long chunks = atomic_load(&log->next_chunk);
+    if (chunks > log->capacity) {
+        chunks = log->capacity;
+    }
+
+    // Unused slots only sit at the ends of the chunks claimed last; sliding
+    // records down keeps each philosopher's records in order
+    long long used = 0;
+    for (long long i = 0; i < chunks * TRACE_CHUNK_RECORDS; i++) {
+        if (trace_record_type(&log->records[i]) != TRACE_NONE) {
+            log->records[used++] = log->records[i];
+        }
+    }
+
+    TraceHeader* header = &log->header;
+    header->end_ns = clock_end_ns();  // When the run stopped, not when the joins ended
+    header->num_records = used;
+    header->dropped = atomic_load(&log->dropped);
+    memcpy(log->map, header, sizeof(*header));
+    munmap(log->map, TRACE_RESERVE_BYTES);
+    if (ftruncate(log->fd, TRACE_DATA_OFFSET + used * (long long)sizeof(TraceRecord)) != 0) {
+        perror("ftruncate");
+    }
+    close(log->fd);
+    free(log->cursors);
+
+    printf("Trace: %lld records (%.1f MB) in %s", used, (double)used * sizeof(TraceRecord) / (1 << 20), log->path);
+    if (header->dropped > 0) {
+        printf(", %lld dropped", (long long)header->dropped);
+    }
+    printf("\n");
+}
+
+// Sequential reader for the offline tools: a block of records at a time,
+// so memory does not grow with the length of the trace
+typedef struct {
+    const char* path;
+    FILE* file;
+    TraceHeader header;
+    TraceRecord* block;
+    size_t count;
+    size_t position;
+    long long remaining;  // Records not yet read from the file
+} TraceReader;
+
+// Returns 0 on success; the header is valid and end_ns > start_ns
+static inline int trace_reader_open(TraceReader* reader, const char* path) {
+    memset(reader, 0, sizeof(*reader));
+    reader->path = path;
+    reader->file = fopen(path, "rb");
+    if (reader->file == NULL) {
+        perror(path);
+        return -1;
+    }
+    TraceHeader* header = &reader->header;
+    if (fread(header, sizeof(*header), 1, reader->file) != 1 ||
+        memcmp(header->magic, TRACE_MAGIC, sizeof(header->magic)) != 0) {
+        fprintf(stderr, "%s: not a philosopher trace\n", path);
+        return -1;
+    }
+    if (header->record_size != (int)sizeof(TraceRecord) || header->num_philosophers < 1 ||
+        header->num_chopsticks < 0) {
+        fprintf(stderr, "%s: unsupported trace layout\n", path);
+        return -1;
+    }
+    if (header->end_ns == 0 && header->num_records == 0) {
+        fprintf(stderr, "%s: the program did not finish writing this trace\n", path);
+        return -1;
+    }
+    if (header->end_ns <= header->start_ns) {
+        header->end_ns = header->start_ns + 1;
+    }
+    if (fseek(reader->file, TRACE_DATA_OFFSET, SEEK_SET) != 0) {
+        perror(path);
+        return -1;
+    }
+    reader->block = malloc(TRACE_READ_BLOCK * sizeof(TraceRecord));
+    reader->remaining = header->num_records;
+    return 0;
+}
+
+// Next record in file order, or NULL at the end
+static inline const TraceRecord* trace_reader_next(TraceReader* reader) {
+    if (reader->position == reader->count) {
+        if (reader->remaining <= 0) {
+            return NULL;
+        }
+        size_t wanted = reader->remaining < TRACE_READ_BLOCK ? (size_t)reader->remaining : TRACE_READ_BLOCK;
+        reader->count = fread(reader->block, sizeof(TraceRecord), wanted, reader->file);
+        reader->position = 0;
+        reader->remaining -= reader->count;
+        if (reader->count < wanted) {
+            fprintf(stderr, "%s: truncated, %lld records missing\n", reader->path, reader->remaining);
+            reader->remaining = 0;
+        }
+        if (reader->count == 0) {
+            return NULL;
+        }
+    }
+    return &reader->block[reader->position++];
+}
+
+// Whether the record's fields fit the header
+static inline int trace_record_valid(const TraceHeader* header, const TraceRecord* record) {
+    int type = trace_record_type(record);
+    int arg = trace_record_arg(record);
+    if (record->source >= (uint32_t)header->num_philosophers || type >= TRACE_NUM_TYPES) {
+        return 0;
+    }
+    if (type == TRACE_STATE) {
+        return arg >= 1 && arg <= 3;
+    }
+    if (type == TRACE_ACQUIRE || type == TRACE_RELEASE || type == TRACE_CONTENDED) {
+        return arg < header->num_chopsticks;
+    }
+    return 1;
+}
+
+static inline void trace_reader_close(TraceReader* reader) {
+    if (reader->file != NULL) {
+        fclose(reader->file);
+    }
+    free(reader->block);
+}
+
+#endif // TRACE_LOG_H
@@ -0,0 +1,61 @@
+#ifndef WAIT_FOR_GRAPH_H
+#define WAIT_FOR_GRAPH_H
+
+#include <stdlib.h>
+
+// Wait-for graph in which every node waits for at most one other: a waiting
+// philosopher wants one chopstick and a chopstick has one owner. In such a
+// graph each component holds at most one cycle, and walking every chain
+// until it reaches a visited node finds it with each node visited once, so
+// a full scan is O(N) with no allocation.
+typedef struct {
+    int* waits_for;    // Node each node waits for, -1 if it is not waiting
+    int* visited_by;   // Start of the walk that first reached each node, -1 if none
+    int* cycle;        // Members of the last cycle found, each waiting for the next
+    int cycle_length;
+    int num_nodes;
+} WaitForGraph;
+
+static inline void wait_for_graph_init(WaitForGraph* graph, int num_nodes) {
+    graph->waits_for = malloc(num_nodes * sizeof(int));
+    graph->visited_by = malloc(num_nodes * sizeof(int));
+    graph->cycle = malloc(num_nodes * sizeof(int));
+    graph->cycle_length = 0;
+    graph->num_nodes = num_nodes;
+}
+
+static inline void wait_for_graph_destroy(WaitForGraph* graph) {
+    free(graph->waits_for);
+    free(graph->visited_by);
+    free(graph->cycle);
+}
+
+// Fill graph->cycle with the first cycle found and return its length, or 0
+// if nobody waits in a circle. waits_for[] must be filled in by the caller.
+static inline int wait_for_graph_find_cycle(WaitForGraph* graph) {
+    for (int node = 0; node < graph->num_nodes; node++) {
+        graph->visited_by[node] = -1;
+    }
+    graph->cycle_length = 0;
+
+    for (int start = 0; start < graph->num_nodes; start++) {
+        int node = start;
+        while (node != -1 && graph->visited_by[node] == -1) {
+            graph->visited_by[node] = start;
+            node = graph->waits_for[node];
+        }
+        // Reaching a node from an earlier walk means this chain drains into
+        // an already explored component; reaching one from this walk closes a loop
+        if (node != -1 && graph->visited_by[node] == start) {
+            int member = node;
+            do {
+                graph->cycle[graph->cycle_length++] = member;
+                member = graph->waits_for[member];
+            } while (member != node);
+            return graph->cycle_length;
+        }
+    }
+    return 0;
+}
+
+#endif // WAIT_FOR_GRAPH_H
@@ -0,0 +1,307 @@
+#ifndef WORK_STEALING_H
+#define WORK_STEALING_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#include "philo_common.h"
+#include "sim_clock.h"
+#include "numa_placement.h"
+
+// Work-stealing runtime for resumable philosopher tasks. Each worker is
+// pinned to a core and owns
+//   - a Chase-Lev deque of runnable tasks: the owner pushes and pops at the
+//     bottom, idle workers steal from the top, and
+//   - a hashed timer wheel holding its tasks' think/eat/poll delays.
+// A task runs on whichever worker dequeued it and is re-armed in that
+// worker's wheel, so bursts of tasks that become due together (both
+// neighbours of a philosopher that just finished eating) spread across idle
+// cores instead of queueing behind one thread.
+
+#define WHEEL_SLOTS 8192                // Power of two; one lap covers 8.192 s
+#define WHEEL_TICK_NS NS_PER_MS
+#define STEAL_IDLE_NS (1 * NS_PER_MS)   // Real time an idle worker waits before retrying
+#define TASK_EMPTY -1
+
+typedef long long (*StealStepFn)(void* task);
+
+// Chase-Lev deque (Le et al., "Correct and Efficient Work-Stealing for Weak
+// Memory Models"). A task is in at most one deque or wheel at a time, so a
+// buffer of at least num_tasks entries never needs to grow.
+typedef struct {
+    _Alignas(CACHE_LINE_SIZE) atomic_llong top;
+    _Alignas(CACHE_LINE_SIZE) atomic_llong bottom;
+    atomic_int* buffer;
+    long long mask;
+} TaskDeque;
+
+static inline void task_deque_init(TaskDeque* deque, int capacity) {
+    long long size = 1;
+    while (size < capacity) {
+        size <<= 1;
+    }
+    deque->buffer = calloc(size, sizeof(atomic_int));
+    deque->mask = size - 1;
+    atomic_init(&deque->top, 0);
+    atomic_init(&deque->bottom, 0);
+}
+
+static inline void task_deque_push(TaskDeque* deque, int task) {
+    long long bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+    atomic_store_explicit(&deque->buffer[bottom & deque->mask], task, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+}
+
+static inline int task_deque_pop(TaskDeque* deque) {
+    long long bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&deque->bottom, bottom, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    long long top = atomic_load_explicit(&deque->top, memory_order_relaxed);
+
+    int task = TASK_EMPTY;
+    if (top <= bottom) {
+        task = atomic_load_explicit(&deque->buffer[bottom & deque->mask], memory_order_relaxed);
+        if (top == bottom) {
+            // Last element: race any thief for it
+            if (!atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1,
+                                                         memory_order_seq_cst, memory_order_relaxed)) {
+                task = TASK_EMPTY;
+            }
+            atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+        }
+    } else {
+        atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+    }
+    return task;
+}
+
+static inline int task_deque_steal(TaskDeque* deque) {
+    long long top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    long long bottom = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+    if (top >= bottom) {
+        return TASK_EMPTY;
+    }
+    int task = atomic_load_explicit(&deque->buffer[top & deque->mask], memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1,
+                                                 memory_order_seq_cst, memory_order_relaxed)) {
+        return TASK_EMPTY;  // Lost the race; the caller moves on to another victim
+    }
+    return task;
+}
+
+struct StealPool;
+
+typedef struct {
+    _Alignas(CACHE_LINE_SIZE) TaskDeque deque;
+    int* wheel;               // Head task of each slot's list, TASK_EMPTY if none
+    long long current_tick;   // Next wheel tick to expire
+    int pending;              // Tasks in the wheel
+    int index;
+    int steal_cursor;         // Next victim to try
+    long long steps;
+    long long stolen;
+    pthread_t thread;
+    struct StealPool* pool;
+} StealWorker;
+
+typedef struct StealPool {
+    StealWorker* workers;
+    int num_workers;
+    char* tasks;
+    size_t task_size;
+    StealStepFn step;
+    atomic_int* running;
+    int* timer_next;          // Intrusive wheel lists, indexed by task
+    long long* timer_tick;    // Tick each task is due at
+} StealPool;
+
+static inline void wheel_insert(StealWorker* worker, int task, long long tick) {
+    StealPool* pool = worker->pool;
+    if (tick < worker->current_tick) {
+        tick = worker->current_tick;
+    }
+    int slot = tick & (WHEEL_SLOTS - 1);
+    pool->timer_tick[task] = tick;
+    pool->timer_next[task] = worker->wheel[slot];
+    worker->wheel[slot] = task;
+    worker->pending++;
+}
+
+// Move every task due by now_tick onto the worker's deque. Entries for a
+// later lap of the wheel stay in their slot.
+static inline void wheel_expire(StealWorker* worker, long long now_tick) {
+    StealPool* pool = worker->pool;
+    if (worker->pending == 0) {
+        worker->current_tick = now_tick + 1;
+        return;
+    }
+    long long last = now_tick;
+    if (last - worker->current_tick >= WHEEL_SLOTS) {
+        worker->current_tick = last - WHEEL_SLOTS + 1;  // One full lap visits every slot
+    }
+    for (; worker->current_tick <= last; worker->current_tick++) {
+        int slot = worker->current_tick & (WHEEL_SLOTS - 1);
+        int task = worker->wheel[slot];
+        worker->wheel[slot] = TASK_EMPTY;
+        while (task != TASK_EMPTY) {
+            int next = pool->timer_next[task];
+            if (pool->timer_tick[task] <= now_tick) {
+                worker->pending--;
+                task_deque_push(&worker->deque, task);
+            } else {
+                pool->timer_next[task] = worker->wheel[slot];
+                worker->wheel[slot] = task;
+            }
+            task = next;
+        }
+    }
+}
+
+// First tick with a non-empty slot within one lap, or -1 if the wheel is empty
+static inline long long wheel_next_tick(StealWorker* worker) {
+    if (worker->pending == 0) {
+        return -1;
+    }
+    for (long long tick = worker->current_tick; tick < worker->current_tick + WHEEL_SLOTS; tick++) {
+        if (worker->wheel[tick & (WHEEL_SLOTS - 1)] != TASK_EMPTY) {
+            return tick;
+        }
+    }
+    return worker->current_tick + WHEEL_SLOTS;
+}
+
+static inline int steal_task(StealWorker* worker) {
+    StealPool* pool = worker->pool;
+    for (int attempt = 0; attempt < pool->num_workers; attempt++) {
+        int victim = (worker->steal_cursor + attempt) % pool->num_workers;
+        if (victim == worker->index) {
+            continue;
+        }
+        // Under -N a task stays on the node that holds its memory
+        if (numa_placement.enabled &&
+            numa_worker_node(victim, pool->num_workers) != numa_worker_node(worker->index, pool->num_workers)) {
+            continue;
+        }
+        int task = task_deque_steal(&pool->workers[victim].deque);
+        if (task != TASK_EMPTY) {
+            worker->steal_cursor = victim;  // Come back to a victim that had work
+            worker->stolen++;
+            return task;
+        }
+    }
+    return TASK_EMPTY;
+}
+
+static inline void pin_to_cpu(int cpu) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu % (cpus > 0 ? cpus : 1), &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+static inline void* steal_worker_routine(void* arg) {
+    StealWorker* worker = (StealWorker*)arg;
+    StealPool* pool = worker->pool;
+    if (numa_placement.enabled) {
+        numa_pin_worker(worker->index, pool->num_workers, 1);
+    } else {
+        pin_to_cpu(worker->index);
+    }
+
+    while (atomic_load(pool->running)) {
+        wheel_expire(worker, clock_now_ns() / WHEEL_TICK_NS);
+
+        int task = task_deque_pop(&worker->deque);
+        if (task == TASK_EMPTY) {
+            task = steal_task(worker);
+        }
+        if (task != TASK_EMPTY) {
+            long long delay_ns = pool->step(pool->tasks + (size_t)task * pool->task_size);
+            worker->steps++;
+            // Round up so a task never runs before its delay is over
+            wheel_insert(worker, task, (clock_now_ns() + delay_ns + WHEEL_TICK_NS - 1) / WHEEL_TICK_NS);
+            continue;
+        }
+
+        // Idle: sleep until the next own timer, but come back soon to look
+        // for work to steal. Virtual time only moves while everyone sleeps,
+        // so there the next own timer is the only wake-up needed.
+        long long now = clock_now_ns();
+        long long next_tick = wheel_next_tick(worker);
+        long long until_timer = next_tick >= 0 ? next_tick * WHEEL_TICK_NS - now : NS_PER_SEC;
+        long long idle_ns = sim_clock.virtual_mode ? until_timer : (long long)(STEAL_IDLE_NS * sim_clock.scale);
+        clock_sleep_ns(until_timer < idle_ns ? until_timer : idle_ns);
+    }
+    clock_thread_exit();
+    return NULL;
+}
+
+// Start num_workers pinned workers; task i starts on worker i % num_workers,
+// or on the worker owning its block under -N
+static inline int steal_pool_start(StealPool* pool, int num_workers, void* tasks, size_t task_size, int num_tasks,
+                                   StealStepFn step, atomic_int* running) {
+    if (num_workers > num_tasks) {
+        num_workers = num_tasks;
+    }
+    pool->workers = alloc_cache_aligned(num_workers, sizeof(StealWorker));
+    pool->num_workers = num_workers;
+    pool->tasks = tasks;
+    pool->task_size = task_size;
+    pool->step = step;
+    pool->running = running;
+    pool->timer_next = malloc(num_tasks * sizeof(int));
+    pool->timer_tick = malloc(num_tasks * sizeof(long long));
+
+    for (int w = 0; w < num_workers; w++) {
+        StealWorker* worker = &pool->workers[w];
+        task_deque_init(&worker->deque, num_tasks);
+        worker->wheel = malloc(WHEEL_SLOTS * sizeof(int));
+        for (int slot = 0; slot < WHEEL_SLOTS; slot++) {
+            worker->wheel[slot] = TASK_EMPTY;
+        }
+        worker->current_tick = 0;
+        worker->index = w;
+        worker->steal_cursor = w + 1;
+        worker->pool = pool;
+    }
+    for (int i = 0; i < num_tasks; i++) {
+        int w = numa_placement.enabled ? numa_task_worker(i, num_workers) : i % num_workers;
+        wheel_insert(&pool->workers[w], i, 0);
+    }
+
+    for (int w = 0; w < num_workers; w++) {
+        clock_register_thread();
+        if (pthread_create(&pool->workers[w].thread, NULL, steal_worker_routine, &pool->workers[w]) != 0) {
+            fprintf(stderr, "Failed to create worker %d\n", w);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Join the workers and report how much of the work moved between them
+static inline void steal_pool_join(StealPool* pool) {
+    long long steps = 0;
+    long long stolen = 0;
+    for (int w = 0; w < pool->num_workers; w++) {
+        pthread_join(pool->workers[w].thread, NULL);
+        steps += pool->workers[w].steps;
+        stolen += pool->workers[w].stolen;
+        free(pool->workers[w].deque.buffer);
+        free(pool->workers[w].wheel);
+    }
+    printf("\nWork stealing: %d workers, %lld steps, %lld stolen (%.1f%%)\n",
+           pool->num_workers, steps, stolen, steps > 0 ? 100.0 * stolen / steps : 0.0);
+    free(pool->timer_next);
+    free(pool->timer_tick);
+    free(pool->workers);
+}
+
+#endif // WORK_STEALING_H